@@ -9,6 +9,7 @@
 #include <cfloat>
 #include <optional>
 #include <random>
+#include <format>
 #include <print>
 #include <chrono>
 #include <cmath>
@@ -17,6 +18,7 @@
 
 #include "image.h"
 #include "random.h"
+#include "render_stats.h"
 #include "types.h"
 
 namespace {
@@ -36,13 +38,13 @@ constexpr const char* FragmentShaderSrc = R"(
 } // namespace
 
 Window::Window(int width, int height, std::string_view title)
-        : _width(width), _height(height) {
+        : _title(title), _width(width), _height(height) {
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW." << std::endl;
         std::exit(-1);
     }
     glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
-    _handle = glfwCreateWindow(_width, _height, title.data(), nullptr, nullptr);
+    _handle = glfwCreateWindow(_width, _height, _title.c_str(), nullptr, nullptr);
     if (!_handle) {
         std::cerr << "Failed to open GLFW window." << std::endl;
         glfwTerminate();
@@ -76,8 +78,16 @@ void Window::setEventHandler(IEventHandler* handler) {
 }
 
 void Window::setTitle(std::string_view title) {
+    _title = title;
     if (_handle) {
-        glfwSetWindowTitle(_handle, title.data());
+        glfwSetWindowTitle(_handle, _title.c_str());
+    }
+}
+
+void Window::setStatus(std::string_view status) {
+    if (_handle) {
+        const std::string title = std::format("{} | {}", _title, status);
+        glfwSetWindowTitle(_handle, title.c_str());
     }
 }
 
@@ -188,12 +198,18 @@ Application::Application(
       _isMousePressed(false),
       _saveNextFrameToDisk(false) {}
 
-void Application::run(IRenderer& renderer, int numJobs) {
+void Application::run(IRenderer& renderer, const RunOptions& options) {
+    LiveBuffer liveBuffer;
+    if (options.liveBufferPath)
+        liveBuffer.open(*options.liveBufferPath, _window.width(), _window.height(), 3);
     RenderProcess renderProcess(
-        renderer, _scene, _window.width(), _window.height(), numJobs);
+        renderer, _scene, _window.width(), _window.height(), options.numJobs,
+        liveBuffer.isOpen() ? &liveBuffer : nullptr);
     _window.setEventHandler(this);
+    RenderStats::Monitor statsMonitor;
     auto lastTime = std::chrono::high_resolution_clock::now();
     constexpr auto FrameTime = std::chrono::duration<float>(std::chrono::seconds(1)) / 20;
+    constexpr auto StatusInterval = std::chrono::seconds(1);
     while (!_window.shouldClose()) {
         const auto startTime = std::chrono::high_resolution_clock::now();
         const Image& frameBuffer = renderProcess.frameBuffer();
@@ -204,14 +220,19 @@ void Application::run(IRenderer& renderer, int numJobs) {
             std::tm* tm = std::localtime(&t);
             if (tm) {
                 std::ostringstream oss;
-                oss << "screenshot_" << std::put_time(tm, "%Y_%m_%d_%H_%M_%S") << ".png";
-                frameBuffer.save(oss.str());
+                oss << "screenshot_" << std::put_time(tm, "%Y_%m_%d_%H_%M_%S");
+                std::optional<std::filesystem::path> linearFileName;
+                if (options.hdrExtension)
+                    linearFileName = oss.str() + "." + *options.hdrExtension;
+                renderProcess.saveFrame(oss.str() + ".png", linearFileName);
             }
             _saveNextFrameToDisk = false;
         }
 
         _graphicsContext.drawImage(frameBuffer);
         _window.swapBuffers();
+        if (const auto summary = statsMonitor.update(StatusInterval))
+            _window.setStatus(summary->toString());
 
         const auto currentTime = std::chrono::high_resolution_clock::now();
         const float deltaTime = std::chrono::duration<float>(currentTime - lastTime).count();
@@ -233,6 +254,14 @@ void Application::run(IRenderer& renderer, int numJobs) {
             renderNeedsReset = true;
         }
 
+        if (options.sceneWatcher) {
+            options.sceneWatcher->applyReload([&](Scene&& reloadedScene) {
+                renderProcess.stop();
+                _scene.replaceContents(std::move(reloadedScene));
+                renderProcess.start();
+                renderNeedsReset = false;
+            });
+        }
         if (renderNeedsReset)
             renderProcess.reset();
 
@@ -284,53 +313,3 @@ void Application::onMouseButton(int button, int action, int mods) {
             _isMousePressed = false;
     }
 }
-
-RenderProcess::RenderProcess(
-        IRenderer& renderer, Scene& scene, int width, int height, int numJobs)
-    : _renderer(renderer),
-      _scene(scene),
-      _frameBuffers{Image(width, height, 3), Image(width, height, 3)},
-      _frontBuffer(&_frameBuffers[0]),
-      _backBuffer(&_frameBuffers[1]) {
-    if (numJobs > 1)
-        _threadPool.emplace(numJobs);
-    _thread = std::thread(std::bind_front(&RenderProcess::renderLoop, this));
-}
-
-RenderProcess::~RenderProcess() {
-    _renderer.stop();
-    _thread.join();
-}
-
-void RenderProcess::reset() {
-    _renderer.stop();
-    _thread.join();
-    _renderer.reset();
-    _thread = std::thread(std::bind_front(&RenderProcess::renderLoop, this));
-}
-
-void RenderProcess::renderLoop() {
-    tracy::SetThreadName("Render Thread");
-    constexpr int NumSamplesToTake = 16384;
-    constexpr int MaxNumSamplesPerStep = 128;
-    int sampleStepSize = 1;
-    const auto startTime = std::chrono::high_resolution_clock::now();
-    while (_renderer.numSamplesPerPixel() < NumSamplesToTake) {
-        FrameMark;
-        _renderer.accumulate(
-            _scene, sampleStepSize,
-            _threadPool ? &_threadPool.value() : nullptr);
-        if (_renderer.isStopping())
-            break;
-        if (sampleStepSize < MaxNumSamplesPerStep) {
-            sampleStepSize *= 2;
-        } else {
-            const auto currentTime = std::chrono::high_resolution_clock::now();
-            std::chrono::duration<double> elapsed = currentTime - startTime;
-            std::println("Samples per pixel: {}, Time: {:.3f}s",
-                _renderer.numSamplesPerPixel(), elapsed.count());
-        }
-        _renderer.updateFrameBuffer(*_backBuffer);
-        std::swap(_frontBuffer, _backBuffer);
-    }
-}
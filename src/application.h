@@ -5,7 +5,11 @@
 #pragma once
 
 #include <chrono>
+#include <filesystem>
 #include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
 #include <string_view>
 
 #include "GL/glew.h"
@@ -13,6 +17,11 @@
 #include "GLFW/glfw3.h"
 
 #include "image.h"
+#include "image_writer.h"
+#include "live_buffer.h"
+#include "render_process.h"
+#include "run_options.h"
+#include "scene_watcher.h"
 #include "renderer.h"
 #include "scene.h"
 #include "types.h"
@@ -40,9 +49,12 @@ public:
     void setEventHandler(IEventHandler* handler);
     float getDeltaTime() const { return _deltaTime; }
     void setTitle(std::string_view title);
+    /// Shows `status` after the title, replacing the previous status.
+    void setStatus(std::string_view status);
 
 private:
     GLFWwindow* _handle = nullptr;
+    std::string _title;
     int _width;
     int _height;
     IEventHandler* _eventHandler = nullptr;
@@ -65,42 +77,16 @@ private:
     GLuint _fragmentShaderProgram = 0;
 };
 
-class RenderProcess {
-public:
-    RenderProcess(
-        IRenderer& renderer, Scene& scene, int width, int height, int numJobs);
-    ~RenderProcess();
-
-    /// Live converging frame buffer for presentation.
-    /// @warning
-    ///     This frame buffer may be invalidated at any point in the future;
-    ///     there is no lock for access.
-    const Image& frameBuffer() const { return *_frontBuffer; }
-
-    /// Should be called when the scene changes.
-    void reset();
-
-private:
-    void renderLoop();
-
-    IRenderer& _renderer;
-    Scene& _scene;
-
-    std::array<Image, 2> _frameBuffers;
-    Image* _frontBuffer;
-    Image* _backBuffer;
-
-    std::thread _thread;
-    std::optional<ThreadPool> _threadPool;
-};
-
 class Application : public IEventHandler {
 public:
     static constexpr float MouseSensitivity = 0.005f;
     static constexpr float MovementSpeed = 2.0f;
 
     Application(Window& window, GraphicsContext& graphicsContext, Scene& scene);
-    void run(IRenderer& renderer, int numJobs);
+    using RunOptions = ::RunOptions;
+
+    /// Runs until the window is closed.
+    void run(IRenderer& renderer, const RunOptions& options);
 
     void onKey(int key, int scancode, int action, int mods) override;
     void onMouseMove(double xpos, double ypos) override;
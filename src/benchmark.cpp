@@ -0,0 +1,274 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <print>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "argparse/argparse.hpp"
+
+#include "json.h"
+#include "mlt.h"
+#include "path_tracer.h"
+#include "random.h"
+#include "render_stats.h"
+#include "scene.h"
+#include "startup_report.h"
+#include "threadpool.h"
+
+constexpr const char* ApplicationName = "MLTBenchmark";
+
+namespace {
+
+struct RendererResult {
+    std::string name;
+    double seconds = 0.0;
+    int samplesPerPixel = 0;
+    std::uint64_t numRays = 0;
+    /// Only set for MLT.
+    std::optional<std::array<MutationStats, MLTProcess::NumMutationTypes>> mutationStats;
+};
+
+struct SceneResult {
+    std::string name;
+    double loadSeconds = 0.0;
+    /// Summed over the BVH build tasks.
+    double bvhBuildSeconds = 0.0;
+    std::size_t numTriangles = 0;
+    std::vector<RendererResult> renderers;
+    std::optional<StartupReport::ProcessMemory> memory;
+};
+
+/// Renders `numSamples` samples per pixel from a fixed seed and counts the
+/// rays traced along the way.
+RendererResult runRenderer(
+        std::string name, IRenderer& renderer, const Scene& scene,
+        int numSamples, std::uint64_t seed, ThreadPool* pool) {
+    PCG32::setSeed(seed);
+    renderer.reset();
+    const RenderStats::Totals statsBefore = RenderStats::total();
+    const auto startTime = std::chrono::steady_clock::now();
+    renderer.accumulate(scene, numSamples, pool);
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - startTime;
+    const RenderStats::Totals work = RenderStats::total() - statsBefore;
+    return RendererResult{
+        .name = std::move(name),
+        .seconds = elapsed.count(),
+        .samplesPerPixel = renderer.numSamplesPerPixel(),
+        .numRays = work.totalRays()};
+}
+
+double perSecond(double count, double seconds) {
+    return seconds > 0.0 ? count / seconds : 0.0;
+}
+
+std::string toJson(const RendererResult& result) {
+    std::string json = std::format(
+        "{{\"name\": {}, \"seconds\": {:.6f}, \"samplesPerPixel\": {}, "
+        "\"rays\": {}, \"mraysPerSecond\": {:.3f}",
+        jsonString(result.name), result.seconds, result.samplesPerPixel, result.numRays,
+        perSecond(result.numRays, result.seconds) * 1e-6);
+    if (result.mutationStats) {
+        std::uint64_t numMutations = 0;
+        json += ", \"mutations\": {";
+        for (std::size_t i = 0; i < result.mutationStats->size(); ++i) {
+            const MutationStats& stats = (*result.mutationStats)[i];
+            numMutations += stats.numProposed;
+            json += std::format(
+                "{}{}: {{\"proposed\": {}, \"accepted\": {}, "
+                "\"acceptanceRate\": {:.6f}}}",
+                i > 0 ? ", " : "", jsonString(MLT::MutationNames[i]),
+                stats.numProposed, stats.numAccepted,
+                perSecond(stats.numAccepted, stats.numProposed));
+        }
+        json += std::format(
+            "}}, \"mutationsPerSecond\": {:.1f}",
+            perSecond(numMutations, result.seconds));
+    }
+    return json + "}";
+}
+
+std::string toJson(const SceneResult& result) {
+    std::string json = std::format(
+        "{{\"name\": {}, \"loadSeconds\": {:.6f}, "
+        "\"bvhBuildSeconds\": {:.6f}, \"triangles\": {}",
+        jsonString(result.name), result.loadSeconds, result.bvhBuildSeconds,
+        result.numTriangles);
+    if (result.memory) {
+        json += std::format(
+            ", \"residentBytes\": {}, \"peakResidentBytes\": {}",
+            result.memory->residentBytes, result.memory->peakResidentBytes);
+    }
+    json += ", \"renderers\": [";
+    for (std::size_t i = 0; i < result.renderers.size(); ++i)
+        json += (i > 0 ? ",\n            " : "\n            ") + toJson(result.renderers[i]);
+    return json + "\n        ]}";
+}
+
+} // namespace
+
+int main(int argc, const char* argv[]) {
+    argparse::ArgumentParser parser(
+        ApplicationName, "", argparse::default_arguments::help);
+
+    std::filesystem::path mediaDirectory = "../media";
+    parser.add_argument("--media")
+        .metavar("DIR")
+        .help("The directory of .glb scenes to render. Defaults to ../media.")
+        .store_into(mediaDirectory);
+
+    std::string sceneNamesString;
+    parser.add_argument("--scenes")
+        .metavar("NAMES")
+        .help("Comma-separated names of the scenes to render, without the "
+            "extension. By default every scene is rendered.")
+        .store_into(sceneNamesString);
+
+    int numJobs = std::thread::hardware_concurrency();
+    parser.add_argument("-j", "--jobs")
+        .metavar("NUM_JOBS")
+        .help("The size of the thread pool, and the number of MLT processes.")
+        .store_into(numJobs);
+
+    int numSamples = 16;
+    parser.add_argument("--spp")
+        .metavar("NUM_SAMPLES")
+        .help("Samples per pixel for the path tracer, and mutations per pixel "
+            "for MLT. Defaults to 16.")
+        .store_into(numSamples);
+
+    int width = 512;
+    parser.add_argument("--width")
+        .help("Width of the rendered image. Defaults to 512.")
+        .store_into(width);
+    int height = 384;
+    parser.add_argument("--height")
+        .help("Height of the rendered image. Defaults to 384.")
+        .store_into(height);
+
+    int seed = 1;
+    parser.add_argument("--seed")
+        .help("Seed of the random numbers. Defaults to 1.")
+        .store_into(seed);
+
+    std::filesystem::path outputPath = "benchmark.json";
+    parser.add_argument("-o", "--output")
+        .metavar("PATH")
+        .help("Where to write the results as JSON. Defaults to benchmark.json.")
+        .store_into(outputPath);
+
+    try {
+        parser.parse_args(argc, argv);
+    } catch (const std::exception& err) {
+        std::cerr << err.what() << std::endl;
+        std::cerr << parser;
+        std::exit(1);
+    }
+
+    std::vector<std::filesystem::path> sceneFiles;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(mediaDirectory, error)) {
+        if (entry.path().extension() == ".glb")
+            sceneFiles.push_back(entry.path());
+    }
+    if (!sceneNamesString.empty()) {
+        std::vector<std::string> sceneNames;
+        std::stringstream ss(sceneNamesString);
+        std::string name;
+        while (std::getline(ss, name, ','))
+            sceneNames.push_back(name);
+        std::erase_if(sceneFiles, [&](const std::filesystem::path& file) {
+            return std::ranges::find(sceneNames, file.stem().string()) == sceneNames.end();
+        });
+    }
+    std::ranges::sort(sceneFiles);
+    if (sceneFiles.empty()) {
+        std::println(stderr, "No scenes found in {}", mediaDirectory.string());
+        return 1;
+    }
+
+    std::optional<ThreadPool> pool;
+    if (numJobs > 1)
+        pool.emplace(numJobs);
+    ThreadPool* poolPtr = pool ? &pool.value() : nullptr;
+
+    std::vector<SceneResult> results;
+    for (const std::filesystem::path& sceneFile : sceneFiles) {
+        StartupReport::resetPeakResident();
+        SceneResult& result = results.emplace_back();
+        result.name = sceneFile.stem().string();
+
+        Camera camera(
+            width, height, 45.0f, 0.032f,
+            Vec3(0.0f, 0.0f, 1.5f),
+            Vec3(0.0f, 0.0f, -1.0f),
+            Vec3(0.0f, 1.0f, 0.0f));
+        Scene scene(camera);
+        StartupReport report;
+        Scene::LoadOptions loadOptions;
+        loadOptions.pool = poolPtr;
+        loadOptions.report = &report;
+        const auto loadStartTime = std::chrono::steady_clock::now();
+        if (!scene.load(sceneFile, loadOptions))
+            return 1;
+        const std::chrono::duration<double> loadTime =
+            std::chrono::steady_clock::now() - loadStartTime;
+        result.loadSeconds = loadTime.count();
+        result.bvhBuildSeconds = report.phaseSeconds("bvh build");
+        for (const Mesh& mesh : scene.meshes)
+            result.numTriangles += mesh.triangles.size();
+
+        {
+            PathTracer pathTracer(width, height);
+            result.renderers.push_back(runRenderer(
+                "pathTracer", pathTracer, scene, numSamples, seed, poolPtr));
+        }
+        {
+            MLT::EnabledMutations enabledMutations{
+                .newPathMutation = true,
+                .lensPerturbation = true,
+                .multiChainPerturbation = true,
+                .bidirectionalMutation = true};
+            MLT mlt(enabledMutations, width, height, numJobs);
+            RendererResult& mltResult = result.renderers.emplace_back(runRenderer(
+                "mlt", mlt, scene, numSamples, seed, poolPtr));
+            mltResult.mutationStats = mlt.mutationStats();
+        }
+        result.memory = StartupReport::processMemory();
+
+        for (const RendererResult& rendererResult : result.renderers) {
+            std::println(
+                "{:<48} {:<10} {:8.3f}s {:8.2f} Mrays/s",
+                result.name, rendererResult.name, rendererResult.seconds,
+                perSecond(rendererResult.numRays, rendererResult.seconds) * 1e-6);
+        }
+    }
+
+    std::ofstream file(outputPath);
+    file << std::format(
+        "{{\n    \"threads\": {},\n    \"width\": {},\n    \"height\": {},\n"
+        "    \"samplesPerPixel\": {},\n    \"seed\": {},\n    \"scenes\": [",
+        numJobs, width, height, numSamples, seed);
+    for (std::size_t i = 0; i < results.size(); ++i)
+        file << (i > 0 ? ",\n        " : "\n        ") << toJson(results[i]);
+    file << "\n    ]\n}\n";
+    if (!file) {
+        std::println(stderr, "Failed to write {}", outputPath.string());
+        return 1;
+    }
+    std::println("Wrote {}", outputPath.string());
+}
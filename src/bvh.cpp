@@ -9,6 +9,8 @@
 #include "aabb.h"
 #include "aabb4.h"
 #include "mesh.h"
+#include "render_stats.h"
+#include "sampling.h"
 #include "types.h"
 
 namespace {
@@ -45,39 +47,6 @@ SplitInfo evaluateSplit(
     return info;
 }
 
-std::optional<BVH::HitInfo> doesRayIntersectTriangle(
-        const Ray& ray, const BVH::Triangle& triangle,
-        float minDistance, float maxDistance) {
-    constexpr float Epsilon = 5e-7f;
-    const Vec3 ab = triangle.positions[0] - triangle.positions[1];
-    const Vec3 ac = triangle.positions[0] - triangle.positions[2];
-    const Vec3 ao = triangle.positions[0] - ray.o;
-    const Vec3 geometricNormal = cross(ab, ac);
-    const float determinant = dot(geometricNormal, ray.d);
-
-    if (std::abs(determinant) < Epsilon)
-        return std::nullopt; // The ray is parallel to the triangle.
-
-    const float invDeterminant = 1 / determinant;
-
-    const float beta = dot(cross(ao, ac), ray.d) * invDeterminant;
-    if (beta < 0 || beta > 1)
-        return std::nullopt;
-
-    const float gamma = dot(cross(ab, ao), ray.d) * invDeterminant;
-    if (gamma < 0 || beta + gamma > 1)
-        return std::nullopt;
-
-    const float alpha = 1 - beta - gamma;
-
-    const float t = dot(geometricNormal, ao) * invDeterminant;
-    if (t < minDistance || t > maxDistance)
-        return std::nullopt;
-
-    return BVH::HitInfo {
-        triangle.idx, t, ray.o + ray.d * t, {alpha, beta, gamma}};
-}
-
 /// Try to find an optimal two-way split using SAH.
 template<int NumSplits, typename GetBoundsSizeFn, typename GetBoundsMinFn>
 std::optional<SplitInfo> trySplitAndPartition(
@@ -155,6 +124,38 @@ private:
 
 } // namespace
 
+std::optional<BVH::HitInfo> doesRayIntersectTriangle(
+        const Ray& ray, const BVH::Triangle& triangle,
+        float minDistance, float maxDistance) {
+    constexpr float Epsilon = 5e-7f;
+    const Vec3 ab = triangle.positions[0] - triangle.positions[1];
+    const Vec3 ac = triangle.positions[0] - triangle.positions[2];
+    const Vec3 ao = triangle.positions[0] - ray.o;
+    const Vec3 geometricNormal = cross(ab, ac);
+    const float determinant = dot(geometricNormal, ray.d);
+
+    if (std::abs(determinant) < Epsilon)
+        return std::nullopt; // The ray is parallel to the triangle.
+
+    const float invDeterminant = 1 / determinant;
+
+    const float beta = dot(cross(ao, ac), ray.d) * invDeterminant;
+    if (beta < 0 || beta > 1)
+        return std::nullopt;
+
+    const float gamma = dot(cross(ab, ao), ray.d) * invDeterminant;
+    if (gamma < 0 || beta + gamma > 1)
+        return std::nullopt;
+
+    const float alpha = 1 - beta - gamma;
+
+    const float t = dot(geometricNormal, ao) * invDeterminant;
+    if (t < minDistance || t > maxDistance)
+        return std::nullopt;
+
+    return BVH::HitInfo {
+        triangle.idx, t, ray.o + ray.d * t, {alpha, beta, gamma}};
+}
 
 BVH::BVH(const Mesh& mesh, const std::size_t startIdx, const std::size_t count) {
     ZoneScopedN("Building BVH");
@@ -173,6 +174,23 @@ BVH::BVH(const Mesh& mesh, const std::size_t startIdx, const std::size_t count)
         triangleCenters);
 }
 
+BVH::BVH(
+        const Mesh& mesh, const std::size_t startIdx, const std::size_t count,
+        const AnalyticShape& shape)
+        : shape(shape) {
+    ZoneScopedN("Building analytic BVH");
+    std::visit(Visitor{
+        [&](const Sphere& sphere) {
+            rootBounds = sphere.bounds();
+        },
+        [&](const Quad& quad) {
+            rootBounds = quad.bounds();
+            for (std::size_t i = startIdx; i < startIdx + count; ++i)
+                triangles.emplace_back(mesh.triangles[i].positions, i);
+        }},
+        shape);
+}
+
 std::optional<BVH::HitInfo> BVH::intersect(
         const Ray& ray,
         float minDistance,
@@ -181,7 +199,15 @@ std::optional<BVH::HitInfo> BVH::intersect(
     std::optional<float> rootIntersection = rootBounds.intersect(ray);
     if (!rootIntersection)
         return std::nullopt;
+    RenderStats::Counters& stats = RenderStats::local();
+    if (shape) {
+        RenderStats::add(stats.numTriangleTests);
+        return intersectShape(ray, minDistance, maxDistance);
+    }
 
+    // Counted locally and added once, to keep the traversal loop tight.
+    std::uint64_t numNodeVisits = 0;
+    std::uint64_t numTriangleTests = 0;
     std::optional<HitInfo> closestHit;
     thread_local TraversalStack stack;
     stack.push(TraversalStack::StackInfo(rootNodeIdx, *rootIntersection));
@@ -192,6 +218,7 @@ std::optional<BVH::HitInfo> BVH::intersect(
             continue;
         const Node& node = nodes[index];
         if (node.isLeaf()) {
+            numTriangleTests += node.numTriangles;
             for (std::uint32_t i = node.idx; i < node.idx + node.numTriangles; ++i) {
                 std::optional<HitInfo> hitInfo = doesRayIntersectTriangle(
                     ray, triangles[i], minDistance, maxDistance);
@@ -199,6 +226,7 @@ std::optional<BVH::HitInfo> BVH::intersect(
                     closestHit = hitInfo;
             }
         } else {
+            ++numNodeVisits;
             AABB4::HitInfo hitInfo = node.childBounds.intersect(ray);
             for (int i = 0; i < 4; ++i) {
                 std::optional<int> bestIdx;
@@ -220,9 +248,52 @@ std::optional<BVH::HitInfo> BVH::intersect(
         }
     }
 
+    RenderStats::add(stats.numNodeVisits, numNodeVisits);
+    RenderStats::add(stats.numTriangleTests, numTriangleTests);
     return closestHit;
 }
 
+std::optional<BVH::HitInfo> BVH::intersectShape(
+        const Ray& ray,
+        float minDistance,
+        float maxDistance) const {
+    return std::visit(Visitor{
+        [&](const Sphere& sphere) -> std::optional<HitInfo> {
+            const std::optional<float> distance =
+                sphere.intersect(ray, minDistance, maxDistance);
+            if (!distance)
+                return std::nullopt;
+            return HitInfo{
+                .triangleIdx = 0,
+                .distance = *distance,
+                .position = ray.o + ray.d * *distance,
+                .barycentricCoords = Vec3(0.0f),
+                .shapeType = ShapeType::Sphere};
+        },
+        [&](const Quad& quad) -> std::optional<HitInfo> {
+            const std::optional<float> distance =
+                quad.intersect(ray, minDistance, maxDistance);
+            if (!distance)
+                return std::nullopt;
+            // Attributes are interpolated over whichever of the two
+            // triangles contains the hit point.
+            const Vec3 position = ray.o + ray.d * *distance;
+            const Triangle* triangle = &triangles[0];
+            Vec3 barycentrics = computeBarycentrics(triangle->positions, position);
+            if (barycentrics[0] < 0.0f || barycentrics[1] < 0.0f || barycentrics[2] < 0.0f) {
+                triangle = &triangles[1];
+                barycentrics = computeBarycentrics(triangle->positions, position);
+            }
+            return HitInfo{
+                .triangleIdx = triangle->idx,
+                .distance = *distance,
+                .position = position,
+                .barycentricCoords = glm::clamp(barycentrics, 0.0f, 1.0f),
+                .shapeType = ShapeType::Quad};
+        }},
+        *shape);
+}
+
 void BVH::split(
         std::optional<std::uint32_t> parentNodeIdx, int childIdx,
          float nodeCost, std::span<Vec3> triangleCenters) {
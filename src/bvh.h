@@ -13,6 +13,7 @@
 #include "aabb.h"
 #include "aabb4.h"
 #include "ray.h"
+#include "shapes.h"
 #include "types.h"
 
 class Mesh;
@@ -41,17 +42,34 @@ public:
         Vec3 center() const;
     };
 
+    /// A closed-form shape standing in for the triangles of a primitive.
+    using AnalyticShape = std::variant<Sphere, Quad>;
+
+    enum class ShapeType {
+        Triangle,
+        Sphere,
+        Quad
+    };
+
     std::vector<Triangle> triangles;
     std::vector<Node> nodes;
     AABB rootBounds;
+    /// If set, the BVH is a single leaf holding this shape and `nodes` is
+    /// empty. Quads keep their two triangles to interpolate vertex
+    /// attributes.
+    std::optional<AnalyticShape> shape;
 
     BVH(const Mesh& mesh, std::size_t startIdx, std::size_t count);
+    BVH(const Mesh& mesh, std::size_t startIdx, std::size_t count,
+        const AnalyticShape& shape);
 
     struct HitInfo {
         std::size_t triangleIdx;
         float distance;
         Vec3 position;
+        /// Unused for spheres.
         Vec3 barycentricCoords;
+        ShapeType shapeType = ShapeType::Triangle;
     };
 
     std::optional<HitInfo> intersect(
@@ -59,10 +77,31 @@ public:
         float minDistance,
         float maxDistance) const;
 
+    /// Number of bytes used by the nodes and the triangle copies.
+    std::size_t memoryUsage() const {
+        return nodes.capacity() * sizeof(Node) +
+            triangles.capacity() * sizeof(Triangle);
+    }
+
 private:
+    friend class SceneCache;
+    /// Used to restore a BVH that was built before.
+    BVH() = default;
+
+    std::optional<HitInfo> intersectShape(
+        const Ray& ray,
+        float minDistance,
+        float maxDistance) const;
+
     static constexpr int NumSplits = 5;
     static constexpr int MaxNumTrianglesInLeaf = 4;
     void split(
         std::optional<std::uint32_t> parentNodeIdx, int childIdx,
         float nodeCost, std::span<Vec3> triangleCenters);
 };
+
+/// Intersects a ray with a single triangle, returning the hit if it lies
+/// between `minDistance` and `maxDistance`.
+std::optional<BVH::HitInfo> doesRayIntersectTriangle(
+    const Ray& ray, const BVH::Triangle& triangle,
+    float minDistance, float maxDistance);
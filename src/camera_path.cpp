@@ -0,0 +1,315 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#include "camera_path.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <print>
+#include <sstream>
+#include <string>
+
+#include "tracy/Tracy.hpp"
+#include "fastgltf/core.hpp"
+#include "fastgltf/tools.hpp"
+#include "fastgltf/glm_element_traits.hpp"
+
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/type_ptr.hpp"
+
+namespace {
+
+/// Keyframes of one animated property of a glTF node.
+template<typename T>
+struct Track {
+    std::vector<float> times;
+    std::vector<T> values;
+    bool isStep = false;
+
+    /// The value at `time`, clamped to the keyframes. `interpolate` blends
+    /// two values.
+    template<typename F>
+    T sample(float time, const F& interpolate) const {
+        const auto next = std::ranges::upper_bound(times, time);
+        if (next == times.begin())
+            return values.front();
+        if (next == times.end())
+            return values.back();
+        const std::size_t i = next - times.begin();
+        if (isStep)
+            return values[i - 1];
+        const float t = (time - times[i - 1]) / (times[i] - times[i - 1]);
+        return interpolate(values[i - 1], values[i], t);
+    }
+};
+
+/// Reads a sampler's keyframes. Cubic spline samplers store an in-tangent,
+/// value and out-tangent per keyframe, of which only the value is kept.
+template<typename T>
+Track<T> readTrack(const fastgltf::Asset& asset, const fastgltf::AnimationSampler& sampler) {
+    Track<T> track;
+    fastgltf::iterateAccessor<float>(
+        asset, asset.accessors[sampler.inputAccessor],
+        [&](float time) { track.times.push_back(time); });
+    std::vector<T> outputs;
+    fastgltf::iterateAccessor<T>(
+        asset, asset.accessors[sampler.outputAccessor],
+        [&](const T& value) { outputs.push_back(value); });
+    if (sampler.interpolation == fastgltf::AnimationInterpolation::CubicSpline) {
+        for (std::size_t i = 1; i < outputs.size(); i += 3)
+            track.values.push_back(outputs[i]);
+    } else {
+        track.values = std::move(outputs);
+    }
+    track.isStep = sampler.interpolation == fastgltf::AnimationInterpolation::Step;
+    const std::size_t size = std::min(track.times.size(), track.values.size());
+    track.times.resize(size);
+    track.values.resize(size);
+    return track;
+}
+
+/// The local transform of a glTF node over time.
+struct NodeTracks {
+    Track<Vec3> translation;
+    /// Quaternions as x, y, z, w, the order glTF stores them in.
+    Track<Vec4> rotation;
+    Track<Vec3> scale;
+
+    glm::mat4 sample(float time) const {
+        const auto lerp = [](const Vec3& a, const Vec3& b, float t) { return a + (b - a) * t; };
+        const Vec4 q = rotation.sample(time, [](const Vec4& a, const Vec4& b, float t) {
+            const glm::quat q = glm::slerp(
+                glm::quat(a.w, a.x, a.y, a.z), glm::quat(b.w, b.x, b.y, b.z), t);
+            return Vec4(q.x, q.y, q.z, q.w);
+        });
+        return glm::translate(glm::mat4(1.0f), translation.sample(time, lerp)) *
+            glm::mat4_cast(glm::normalize(glm::quat(q.w, q.x, q.y, q.z))) *
+            glm::scale(glm::mat4(1.0f), scale.sample(time, lerp));
+    }
+};
+
+/// A single keyframe per track holding the node's own transform. Matrices
+/// are split into translation, rotation and scale, as glTF requires of
+/// animated nodes; any shear is dropped.
+NodeTracks staticTracks(const fastgltf::Node& node) {
+    NodeTracks tracks;
+    tracks.translation.times = tracks.rotation.times = tracks.scale.times = {0.0f};
+    if (const auto* trs = std::get_if<fastgltf::TRS>(&node.transform)) {
+        tracks.translation.values = {glm::make_vec3(trs->translation.data())};
+        tracks.rotation.values = {glm::make_vec4(trs->rotation.data())};
+        tracks.scale.values = {glm::make_vec3(trs->scale.data())};
+        return tracks;
+    }
+    const glm::mat4 matrix = glm::make_mat4(
+        std::get<fastgltf::math::fmat4x4>(node.transform).data());
+    glm::mat3 axes(matrix);
+    Vec3 scale(length(axes[0]), length(axes[1]), length(axes[2]));
+    if (glm::determinant(axes) < 0.0f)
+        scale.x = -scale.x;
+    for (int i = 0; i < 3; ++i)
+        axes[i] = scale[i] != 0.0f ? axes[i] / scale[i] : Vec3(0.0f);
+    const glm::quat rotation = glm::normalize(glm::quat_cast(axes));
+    tracks.translation.values = {Vec3(matrix[3])};
+    tracks.rotation.values = {Vec4(rotation.x, rotation.y, rotation.z, rotation.w)};
+    tracks.scale.values = {scale};
+    return tracks;
+}
+
+} // namespace
+
+std::optional<CameraPath> CameraPath::load(const std::filesystem::path& fileName) {
+    std::string extension = fileName.extension().string();
+    std::ranges::transform(extension, extension.begin(), [](unsigned char c) {
+        return std::tolower(c);
+    });
+    std::optional<CameraPath> path = extension == ".glb" || extension == ".gltf"
+        ? loadGltfAnimation(fileName)
+        : loadKeyframes(fileName);
+    if (path)
+        std::ranges::stable_sort(path->_keyframes, {}, &Keyframe::time);
+    return path;
+}
+
+std::optional<CameraPath> CameraPath::loadKeyframes(const std::filesystem::path& fileName) {
+    std::ifstream file(fileName);
+    if (!file) {
+        std::println(stderr, "Failed to open {}", fileName.string());
+        return std::nullopt;
+    }
+    CameraPath path;
+    std::string line;
+    for (int lineNumber = 1; std::getline(file, line); ++lineNumber) {
+        std::istringstream ss(line);
+        std::string first;
+        if (!(ss >> first) || first.starts_with('#'))
+            continue;
+        ss.str(line);
+        ss.clear();
+        Keyframe keyframe;
+        Vec3 target;
+        Vec3 up(0.0f, 1.0f, 0.0f);
+        if (!(ss >> keyframe.time >>
+                keyframe.position.x >> keyframe.position.y >> keyframe.position.z >>
+                target.x >> target.y >> target.z)) {
+            std::println(stderr, "{}:{}: Expected a time, position and target",
+                fileName.string(), lineNumber);
+            return std::nullopt;
+        }
+        if (Vec3 givenUp; ss >> givenUp.x >> givenUp.y >> givenUp.z)
+            up = givenUp;
+        const Vec3 forward = target - keyframe.position;
+        if (length2(forward) == 0.0f || length2(cross(forward, up)) == 0.0f) {
+            std::println(stderr, "{}:{}: The camera must look away from its position and "
+                "not along its up direction", fileName.string(), lineNumber);
+            return std::nullopt;
+        }
+        keyframe.rotation = glm::quatLookAt(normalize(forward), normalize(up));
+        path._keyframes.push_back(keyframe);
+    }
+    if (path._keyframes.empty()) {
+        std::println(stderr, "No keyframes in {}", fileName.string());
+        return std::nullopt;
+    }
+    return path;
+}
+
+std::optional<CameraPath> CameraPath::loadGltfAnimation(const std::filesystem::path& fileName) {
+    ZoneScoped;
+    fastgltf::Expected<fastgltf::GltfDataBuffer> data =
+        fastgltf::GltfDataBuffer::FromPath(fileName);
+    if (!data) {
+        std::println(
+            stderr, "Failed to load GLTF: error={}",
+            fastgltf::to_underlying(data.error()));
+        return std::nullopt;
+    }
+    // The extensions the scene loader accepts, so files it reads parse here.
+    constexpr auto extensionsToLoad =
+        fastgltf::Extensions::KHR_materials_transmission |
+        fastgltf::Extensions::KHR_materials_emissive_strength |
+        fastgltf::Extensions::KHR_materials_ior |
+        fastgltf::Extensions::KHR_lights_punctual;
+    fastgltf::Parser parser(extensionsToLoad);
+    fastgltf::Expected<fastgltf::Asset> asset = parser.loadGltf(
+        data.get(), fileName.parent_path(), fastgltf::Options::LoadExternalBuffers);
+    if (!asset) {
+        std::println(
+            stderr, "Failed to load GLTF: error={}",
+            fastgltf::to_underlying(asset.error()));
+        return std::nullopt;
+    }
+
+    // The scene loader places the camera at the node of the first camera.
+    const auto cameraNode = std::ranges::find_if(
+        asset->nodes, [](const fastgltf::Node& node) { return node.cameraIndex == 0; });
+    if (cameraNode == asset->nodes.end()) {
+        std::println(stderr, "{} has no camera", fileName.string());
+        return std::nullopt;
+    }
+
+    // The camera's world transform is that of every node from the root down
+    // to the camera node, any of which may be animated.
+    std::vector<std::optional<std::size_t>> parents(asset->nodes.size());
+    for (std::size_t nodeIdx = 0; nodeIdx < asset->nodes.size(); ++nodeIdx) {
+        for (const std::size_t childIdx : asset->nodes[nodeIdx].children) {
+            if (childIdx < parents.size())
+                parents[childIdx] = nodeIdx;
+        }
+    }
+    std::vector<std::size_t> chain;
+    for (std::optional<std::size_t> nodeIdx = static_cast<std::size_t>(
+            cameraNode - asset->nodes.begin());
+            nodeIdx; nodeIdx = parents[*nodeIdx]) {
+        if (chain.size() == asset->nodes.size()) {
+            std::println(stderr, "The nodes of {} form a cycle", fileName.string());
+            return std::nullopt;
+        }
+        chain.push_back(*nodeIdx);
+    }
+
+    std::vector<NodeTracks> tracks;
+    for (const std::size_t nodeIdx : chain)
+        tracks.push_back(staticTracks(asset->nodes[nodeIdx]));
+    bool isAnimated = false;
+    for (const fastgltf::Animation& animation : asset->animations) {
+        for (const fastgltf::AnimationChannel& channel : animation.channels) {
+            const auto link = channel.nodeIndex
+                ? std::ranges::find(chain, *channel.nodeIndex) : chain.end();
+            if (link == chain.end())
+                continue;
+            NodeTracks& node = tracks[link - chain.begin()];
+            const fastgltf::AnimationSampler& sampler = animation.samplers[channel.samplerIndex];
+            if (channel.path == fastgltf::AnimationPath::Translation) {
+                node.translation = readTrack<Vec3>(asset.get(), sampler);
+                isAnimated = true;
+            } else if (channel.path == fastgltf::AnimationPath::Rotation) {
+                node.rotation = readTrack<Vec4>(asset.get(), sampler);
+                isAnimated = true;
+            } else if (channel.path == fastgltf::AnimationPath::Scale) {
+                node.scale = readTrack<Vec3>(asset.get(), sampler);
+                isAnimated = true;
+            }
+        }
+    }
+    const bool hasEmptyTrack = std::ranges::any_of(tracks, [](const NodeTracks& node) {
+        return node.translation.times.empty() || node.rotation.times.empty() ||
+            node.scale.times.empty();
+    });
+    if (!isAnimated || hasEmptyTrack) {
+        std::println(stderr, "The camera of {} is not animated", fileName.string());
+        return std::nullopt;
+    }
+
+    // Interpolating between the keyframes of every track reproduces linear
+    // and spherical interpolation within each track exactly, as long as the
+    // parents only translate and rotate.
+    std::vector<float> times;
+    for (const NodeTracks& node : tracks) {
+        for (const auto* nodeTimes :
+                {&node.translation.times, &node.rotation.times, &node.scale.times})
+            times.insert(times.end(), nodeTimes->begin(), nodeTimes->end());
+    }
+    std::ranges::sort(times);
+    times.erase(std::unique(times.begin(), times.end()), times.end());
+    CameraPath path;
+    for (const float time : times) {
+        glm::mat4 transform(1.0f);
+        for (const NodeTracks& node : tracks)
+            transform = node.sample(time) * transform;
+        const Vec3 forward = Vec3(transform * Vec4(0.0f, 0.0f, -1.0f, 0.0f));
+        const Vec3 up = Vec3(transform * Vec4(0.0f, 1.0f, 0.0f, 0.0f));
+        if (length2(forward) == 0.0f || length2(cross(forward, up)) == 0.0f) {
+            std::println(stderr, "The camera of {} is scaled to nothing at time {}",
+                fileName.string(), time);
+            return std::nullopt;
+        }
+        path._keyframes.push_back(Keyframe{
+            .time = time,
+            .position = Vec3(transform * Vec4(0.0f, 0.0f, 0.0f, 1.0f)),
+            .rotation = glm::quatLookAt(normalize(forward), normalize(up))});
+    }
+    return path;
+}
+
+void CameraPath::apply(double time, Camera& camera) const {
+    const auto next = std::ranges::upper_bound(_keyframes, time, {}, &Keyframe::time);
+    Keyframe pose;
+    if (next == _keyframes.begin()) {
+        pose = _keyframes.front();
+    } else if (next == _keyframes.end()) {
+        pose = _keyframes.back();
+    } else {
+        const Keyframe& a = *(next - 1);
+        const Keyframe& b = *next;
+        const float t = static_cast<float>((time - a.time) / (b.time - a.time));
+        pose.position = a.position + (b.position - a.position) * t;
+        pose.rotation = glm::slerp(a.rotation, b.rotation, t);
+    }
+    // glTF cameras look down their local -Z with +Y up.
+    camera.position = pose.position;
+    camera.forward = normalize(pose.rotation * Vec3(0.0f, 0.0f, -1.0f));
+    camera.up = normalize(pose.rotation * Vec3(0.0f, 1.0f, 0.0f));
+    camera.right = normalize(pose.rotation * Vec3(1.0f, 0.0f, 0.0f));
+}
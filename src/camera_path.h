@@ -0,0 +1,52 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+#include "glm/gtc/quaternion.hpp"
+
+#include "scene.h"
+#include "types.h"
+
+/// Poses of the camera over time, for rendering animations. Positions are
+/// interpolated linearly and orientations spherically between keyframes.
+class CameraPath {
+public:
+    struct Keyframe {
+        double time;
+        Vec3 position;
+        /// Turns the camera's default view, down -Z with +Y up, to its view.
+        glm::quat rotation;
+    };
+
+    /// Reads the animation of the camera node of a .glb or .gltf file,
+    /// composed with that of the nodes above it, or else a text file with
+    /// one keyframe per line:
+    ///
+    ///     TIME X Y Z TARGET_X TARGET_Y TARGET_Z [UP_X UP_Y UP_Z]
+    ///
+    /// where the camera at X, Y, Z looks at the target, with +Y up unless
+    /// given. Lines starting with '#' are skipped. Prints the problem and
+    /// returns nothing on failure.
+    static std::optional<CameraPath> load(const std::filesystem::path& fileName);
+
+    [[nodiscard]] double startTime() const { return _keyframes.front().time; }
+    [[nodiscard]] double endTime() const { return _keyframes.back().time; }
+    [[nodiscard]] std::size_t numKeyframes() const { return _keyframes.size(); }
+
+    /// Moves `camera` to its pose at `time`, which is clamped to the
+    /// keyframes.
+    void apply(double time, Camera& camera) const;
+
+private:
+    static std::optional<CameraPath> loadKeyframes(const std::filesystem::path& fileName);
+    static std::optional<CameraPath> loadGltfAnimation(const std::filesystem::path& fileName);
+
+    /// Sorted by time, and never empty.
+    std::vector<Keyframe> _keyframes;
+};
@@ -0,0 +1,229 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <print>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "argparse/argparse.hpp"
+
+#include "image.h"
+#include "image_metrics.h"
+#include "mlt.h"
+#include "options.h"
+#include "path_tracer.h"
+#include "random.h"
+#include "scene.h"
+#include "threadpool.h"
+
+constexpr const char* ApplicationName = "MLTConvergence";
+
+int main(int argc, const char* argv[]) {
+    argparse::ArgumentParser parser(
+        ApplicationName, "", argparse::default_arguments::help);
+
+    std::filesystem::path sceneFile;
+    parser.add_argument("scene-file")
+        .help("The .glb or binary .ply file to render.")
+        .required()
+        .store_into(sceneFile);
+
+    std::filesystem::path referencePath;
+    parser.add_argument("-r", "--reference")
+        .metavar("PATH")
+        .help("Linear radiance of a long render of the scene, e.g. saved by "
+            "MLT --headless --hdr pfm. Sets the resolution.")
+        .required()
+        .store_into(referencePath);
+
+    int numJobs = std::thread::hardware_concurrency();
+    parser.add_argument("-j", "--jobs")
+        .metavar("NUM_JOBS")
+        .help("The size of the thread pool, and the number of MLT processes.")
+        .store_into(numJobs);
+
+    bool usePathTracer = false;
+    parser.add_argument("--pt", "--use-path-tracer")
+        .help("Use regular path tracing instead of MLT.")
+        .store_into(usePathTracer);
+
+    std::string integratorString;
+    parser.add_argument("--pt-integrator")
+        .metavar("INTEGRATOR")
+        .help("The integrator used by the path tracer, \"streaming\" or "
+            "\"path\".")
+        .store_into(integratorString);
+
+    std::string enabledMutationsString;
+    parser.add_argument("-m", "--mutations")
+        .metavar("MUTATIONS")
+        .help("The mutations enabled for MLT, as for MLT -m. All are enabled "
+            "by default.")
+        .store_into(enabledMutationsString);
+
+    bool disableAnalyticShapes = false;
+    parser.add_argument("--no-analytic-shapes")
+        .help("Intersect tessellated spheres and rectangles as triangles.")
+        .store_into(disableAnalyticShapes);
+
+    double intervalSeconds = 5.0;
+    parser.add_argument("--interval")
+        .metavar("SECONDS")
+        .help("Render time between measurements. Defaults to 5.")
+        .store_into(intervalSeconds);
+
+    double timeBudgetSeconds = 60.0;
+    parser.add_argument("--time-budget")
+        .metavar("SECONDS")
+        .help("Total render time. Defaults to 60.")
+        .store_into(timeBudgetSeconds);
+
+    std::string snapshotDirectory;
+    parser.add_argument("--snapshots")
+        .metavar("DIR")
+        .help("Also save the linear radiance at every measurement to DIR as "
+            "numbered PFM files.")
+        .store_into(snapshotDirectory);
+
+    int seed = 1;
+    parser.add_argument("--seed")
+        .help("Seed of the random numbers. Defaults to 1.")
+        .store_into(seed);
+
+    std::filesystem::path outputPath = "convergence.csv";
+    parser.add_argument("-o", "--output")
+        .metavar("PATH")
+        .help("Where to write the error over time as CSV. Defaults to "
+            "convergence.csv.")
+        .store_into(outputPath);
+
+    MLT::EnabledMutations enabledMutations{
+        .newPathMutation = true,
+        .lensPerturbation = true,
+        .multiChainPerturbation = true,
+        .bidirectionalMutation = true};
+    PathTracer::Integrator integrator = PathTracer::Integrator::Streaming;
+    try {
+        parser.parse_args(argc, argv);
+        if (!enabledMutationsString.empty())
+            enabledMutations = getEnabledMutationsFromString(enabledMutationsString);
+        if (!integratorString.empty())
+            integrator = getIntegratorFromString(integratorString);
+        if (intervalSeconds <= 0.0)
+            throw std::runtime_error("The interval must be positive");
+    } catch (const std::exception& err) {
+        std::cerr << err.what() << std::endl;
+        std::cerr << parser;
+        std::exit(1);
+    }
+
+    Image reference;
+    reference.load(referencePath);
+    if (reference.empty())
+        return 1;
+    if (reference.channels() < 3) {
+        std::println(stderr, "The reference must be an RGB image");
+        return 1;
+    }
+    const int width = static_cast<int>(reference.width());
+    const int height = static_cast<int>(reference.height());
+
+    std::optional<ThreadPool> pool;
+    if (numJobs > 1)
+        pool.emplace(numJobs);
+    ThreadPool* poolPtr = pool ? &pool.value() : nullptr;
+
+    // The camera of MLT, so the reference can come from its headless mode.
+    Camera camera(
+        width, height, 45.0f, 0.032f,
+        Vec3(0.0f, 0.0f, 1.5f),
+        Vec3(0.0f, 0.0f, -1.0f),
+        Vec3(0.0f, 1.0f, 0.0f));
+    Scene scene(camera);
+    Scene::LoadOptions loadOptions;
+    loadOptions.detectAnalyticShapes = !disableAnalyticShapes;
+    loadOptions.pool = poolPtr;
+    if (!scene.load(sceneFile, loadOptions))
+        return 1;
+
+    std::unique_ptr<IRenderer> renderer;
+    if (usePathTracer)
+        renderer = std::make_unique<PathTracer>(width, height, integrator);
+    else
+        renderer = std::make_unique<MLT>(enabledMutations, width, height, numJobs);
+
+    if (!snapshotDirectory.empty()) {
+        std::error_code error;
+        std::filesystem::create_directories(snapshotDirectory, error);
+        if (error) {
+            std::println(
+                stderr, "Failed to create {}: {}", snapshotDirectory, error.message());
+            return 1;
+        }
+    }
+    std::ofstream csv(outputPath);
+    if (!csv) {
+        std::println(stderr, "Failed to write {}", outputPath.string());
+        return 1;
+    }
+    csv << "seconds,samplesPerPixel,rmse,relMse,flip,estimatedRelError\n";
+    std::println(
+        "{:>10} {:>8} {:>12} {:>12} {:>10} {:>12}",
+        "seconds", "spp", "rmse", "relMse", "flip", "estRelError");
+
+    // Only time spent accumulating counts, so measuring does not skew the
+    // curve. Steps of one sample per pixel keep the measurements close to
+    // the interval.
+    PCG32::setSeed(seed);
+    renderer->reset();
+    Image linear(width, height, 3);
+    double renderSeconds = 0.0;
+    double nextMeasurement = intervalSeconds;
+    int numMeasurements = 0;
+    while (renderSeconds < timeBudgetSeconds) {
+        const auto stepStartTime = std::chrono::steady_clock::now();
+        renderer->accumulate(scene, 1, poolPtr);
+        const std::chrono::duration<double> stepTime =
+            std::chrono::steady_clock::now() - stepStartTime;
+        renderSeconds += stepTime.count();
+        if (renderSeconds < nextMeasurement && renderSeconds < timeBudgetSeconds)
+            continue;
+        while (nextMeasurement <= renderSeconds)
+            nextMeasurement += intervalSeconds;
+
+        renderer->resolveLinear(linear, poolPtr);
+        const ImageErrors errors = computeImageErrors(linear, reference);
+        const std::optional<double> estimatedError = renderer->estimateRelativeError();
+        const std::string estimatedErrorString =
+            estimatedError ? std::format("{:.8g}", *estimatedError) : "";
+        csv << std::format(
+            "{:.3f},{},{:.8g},{:.8g},{:.8g},{}\n",
+            renderSeconds, renderer->numSamplesPerPixel(),
+            errors.rmse, errors.relMse, errors.flip, estimatedErrorString);
+        std::println(
+            "{:>10.2f} {:>8} {:>12.6g} {:>12.6g} {:>10.5f} {:>12}",
+            renderSeconds, renderer->numSamplesPerPixel(),
+            errors.rmse, errors.relMse, errors.flip, estimatedErrorString);
+        if (!snapshotDirectory.empty()) {
+            linear.save(std::filesystem::path(snapshotDirectory) /
+                std::format("{:04}.pfm", numMeasurements));
+        }
+        ++numMeasurements;
+    }
+
+    if (!csv) {
+        std::println(stderr, "Failed to write {}", outputPath.string());
+        return 1;
+    }
+    std::println("Wrote {}", outputPath.string());
+}
@@ -0,0 +1,127 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <optional>
+#include <print>
+#include <stdexcept>
+#include <string>
+
+#include "argparse/argparse.hpp"
+
+#include "image.h"
+#include "options.h"
+#include "render_farm.h"
+#include "socket.h"
+
+constexpr const char* ApplicationName = "MLTCoordinator";
+
+int main(int argc, const char* argv[]) {
+    argparse::ArgumentParser parser(
+        ApplicationName, "", argparse::default_arguments::help);
+
+    int port = RenderFarm::DefaultPort;
+    parser.add_argument("-p", "--port")
+        .metavar("PORT")
+        .help("The port workers connect to. Defaults to 7170.")
+        .store_into(port);
+
+    int numWorkers = 0;
+    parser.add_argument("-w", "--workers")
+        .metavar("NUM_WORKERS")
+        .help("The number of workers to wait for, each started with "
+            "MLT --headless --worker HOST:PORT.")
+        .required()
+        .store_into(numWorkers);
+
+    int seed = 1;
+    parser.add_argument("--seed")
+        .help("Seed from which the workers' seeds are derived. Defaults to 1.")
+        .store_into(seed);
+
+    double connectTimeoutSeconds = 600.0;
+    parser.add_argument("--connect-timeout")
+        .metavar("SECONDS")
+        .help("How long to wait for all workers to connect before merging the "
+            "ones that did. Defaults to 600.")
+        .store_into(connectTimeoutSeconds);
+
+    double updateTimeoutSeconds = 60.0;
+    parser.add_argument("--update-timeout")
+        .metavar("SECONDS")
+        .help("How long a worker may go without sending an update before it is "
+            "given up on and its last update is kept. Keep it a few times the "
+            "workers' --report-interval. Defaults to 60.")
+        .store_into(updateTimeoutSeconds);
+
+    std::string hdrFormatString;
+    parser.add_argument("--hdr")
+        .metavar("FORMAT")
+        .help("Also save the linear radiance, as either \"exr\" or \"pfm\".")
+        .store_into(hdrFormatString);
+
+    std::filesystem::path outputPath = "render.png";
+    parser.add_argument("-o", "--output")
+        .metavar("PATH")
+        .help("Where to save the merged image. Defaults to render.png. With "
+            "--hdr, the linear radiance is saved next to it.")
+        .store_into(outputPath);
+
+    parser.add_epilog(std::format(
+        "Example usage: {} --workers 4 --port 7170 -o room_far.png",
+        ApplicationName));
+
+    std::optional<std::string> hdrExtension;
+    try {
+        parser.parse_args(argc, argv);
+        if (!hdrFormatString.empty())
+            hdrExtension = getHdrExtensionFromString(hdrFormatString);
+        if (numWorkers < 1)
+            throw std::runtime_error("At least one worker is needed");
+        if (port < 0 || port > 65535)
+            throw std::runtime_error("Invalid port");
+        if (connectTimeoutSeconds <= 0.0 || updateTimeoutSeconds <= 0.0)
+            throw std::runtime_error("Timeouts must be positive");
+    } catch (const std::exception& err) {
+        std::cerr << err.what() << std::endl;
+        std::cerr << parser;
+        std::exit(1);
+    }
+
+    std::optional<Socket> listener = Socket::listen(static_cast<std::uint16_t>(port));
+    if (!listener)
+        return 1;
+    std::println("Waiting for {} workers on port {}", numWorkers, listener->localPort());
+    const auto startTime = std::chrono::steady_clock::now();
+    const auto toMilliseconds = [](double seconds) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::duration<double>(seconds));
+    };
+    const std::optional<Accumulation> accumulation = RenderFarm::coordinate(
+        *listener, numWorkers, seed, toMilliseconds(connectTimeoutSeconds),
+        toMilliseconds(updateTimeoutSeconds));
+    if (!accumulation) {
+        std::println(stderr, "No worker sent an image");
+        return 1;
+    }
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - startTime;
+    std::println(
+        "Merged {}x{} at {} samples per pixel in {:.3f}s",
+        accumulation->buffer.width(), accumulation->buffer.height(),
+        accumulation->numSamplesPerPixel, elapsed.count());
+
+    Image linear(accumulation->buffer.width(), accumulation->buffer.height(), 3);
+    accumulation->resolveLinear(linear);
+    if (hdrExtension)
+        linear.save(std::filesystem::path(outputPath).replace_extension(*hdrExtension));
+    Image frame(linear.width(), linear.height(), 3);
+    frame.applyCorrection(linear, 1.0f);
+    frame.save(outputPath);
+}
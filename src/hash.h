@@ -0,0 +1,36 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+/// Finalizer of MurmurHash3, spreading every input bit over the result.
+inline std::uint64_t mixBits(std::uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdu;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53u;
+    x ^= x >> 33;
+    return x;
+}
+
+/// Fast non-cryptographic hash, good enough to notice any edit to the data.
+inline std::uint64_t hashBytes(std::span<const std::byte> bytes, std::uint64_t seed = 0) {
+    constexpr std::uint64_t Multiplier = 0x9e3779b97f4a7c15u;
+    std::uint64_t hash = mixBits(seed ^ (bytes.size() * Multiplier));
+    std::size_t i = 0;
+    for (; i + sizeof(std::uint64_t) <= bytes.size(); i += sizeof(std::uint64_t)) {
+        std::uint64_t word;
+        std::memcpy(&word, bytes.data() + i, sizeof(word));
+        hash = (hash ^ mixBits(word)) * Multiplier;
+    }
+    std::uint64_t tail = 0;
+    std::memcpy(&tail, bytes.data() + i, bytes.size() - i);
+    hash = (hash ^ mixBits(tail)) * Multiplier;
+    return mixBits(hash);
+}
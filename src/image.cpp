@@ -4,19 +4,233 @@
 
 #include "image.h"
 
+#include <array>
+#include <bit>
 #include <cstdio>
+#include <fstream>
 #include <print>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 #include "tracy/Tracy.hpp"
 
+#include "threadpool.h"
+
 #define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image.h"
 #include "stb_image_write.h"
 
+namespace {
+
+/// Runs `function(firstRow, lastRow)` over blocks of rows, on the pool if
+/// there is one.
+template<typename F>
+void forEachRowBlock(std::size_t height, ThreadPool* pool, const F& function) {
+    constexpr std::size_t RowsPerBlock = 16;
+    if (!pool) {
+        function(0, height);
+        return;
+    }
+    for (std::size_t y = 0; y < height; y += RowsPerBlock) {
+        const std::size_t lastRow = std::min(height, y + RowsPerBlock);
+        pool->assignWork([&function, y, lastRow] { function(y, lastRow); });
+    }
+    pool->wait();
+}
+
+/// Display gamma curve tabulated over the square root of the input. The
+/// curve is nearly linear in that domain, so linear interpolation between
+/// a few hundred entries is accurate to well below one 8-bit step.
+constexpr int GammaTableSize = 256;
+
+const std::array<float, GammaTableSize + 1>& gammaTable() {
+    static const std::array<float, GammaTableSize + 1> table = [] {
+        std::array<float, GammaTableSize + 1> result;
+        for (int i = 0; i <= GammaTableSize; ++i) {
+            const float root = static_cast<float>(i) / GammaTableSize;
+            result[i] = std::pow(root * root, 1.0f / Image::DisplayGamma);
+        }
+        return result;
+    }();
+    return table;
+}
+
+void accumulateScaledSpan(
+        float* destination, const float* source, float scale, std::size_t count) {
+    std::size_t i = 0;
+#if defined(__AVX2__)
+    const __m256 scale8 = _mm256_set1_ps(scale);
+    for (; i + 8 <= count; i += 8) {
+        const __m256 sum = _mm256_add_ps(
+            _mm256_loadu_ps(destination + i),
+            _mm256_mul_ps(_mm256_loadu_ps(source + i), scale8));
+        _mm256_storeu_ps(destination + i, sum);
+    }
+#endif
+    for (; i < count; ++i)
+        destination[i] += source[i] * scale;
+}
+
+void applyCorrectionSpan(
+        float* destination, const float* source, float scale, std::size_t count) {
+    const std::array<float, GammaTableSize + 1>& table = gammaTable();
+    std::size_t i = 0;
+#if defined(__AVX2__)
+    const __m256 scale8 = _mm256_set1_ps(scale);
+    const __m256 zero8 = _mm256_setzero_ps();
+    const __m256 one8 = _mm256_set1_ps(1.0f);
+    const __m256 tableSize8 = _mm256_set1_ps(static_cast<float>(GammaTableSize));
+    const __m256i zeroIdx8 = _mm256_setzero_si256();
+    const __m256i lastIdx8 = _mm256_set1_epi32(GammaTableSize - 1);
+    for (; i + 8 <= count; i += 8) {
+        // max returns its second operand when either is NaN, so NaN pixels
+        // become 0 here. The index is clamped too, so the gathers stay in
+        // the table whatever the input.
+        const __m256 value = _mm256_min_ps(_mm256_max_ps(
+            _mm256_mul_ps(_mm256_loadu_ps(source + i), scale8), zero8), one8);
+        const __m256 position = _mm256_mul_ps(_mm256_sqrt_ps(value), tableSize8);
+        const __m256i idx = _mm256_max_epi32(_mm256_min_epi32(
+            _mm256_cvttps_epi32(position), lastIdx8), zeroIdx8);
+        const __m256 fraction = _mm256_sub_ps(position, _mm256_cvtepi32_ps(idx));
+        const __m256 lower = _mm256_i32gather_ps(table.data(), idx, 4);
+        const __m256 upper = _mm256_i32gather_ps(table.data() + 1, idx, 4);
+        const __m256 result = _mm256_add_ps(
+            lower, _mm256_mul_ps(fraction, _mm256_sub_ps(upper, lower)));
+        _mm256_storeu_ps(destination + i, result);
+    }
+#endif
+    for (; i < count; ++i) {
+        // NaN fails every comparison, so it is caught by the negated test.
+        const float scaled = source[i] * scale;
+        const float value = !(scaled > 0.0f) ? 0.0f : std::min(scaled, 1.0f);
+        const float position = std::sqrt(value) * GammaTableSize;
+        const int idx = std::min(static_cast<int>(position), GammaTableSize - 1);
+        const float fraction = position - idx;
+        destination[i] = table[idx] + fraction * (table[idx + 1] - table[idx]);
+    }
+}
+
+void convertToBytesSpan(
+        std::uint8_t* destination, const float* source, std::size_t count) {
+    std::size_t i = 0;
+#if defined(__AVX2__)
+    const __m256 zero8 = _mm256_setzero_ps();
+    const __m256 one8 = _mm256_set1_ps(1.0f);
+    const __m256 max8 = _mm256_set1_ps(255.0f);
+    const auto quantize = [&](const float* values) {
+        const __m256 value = _mm256_min_ps(
+            _mm256_max_ps(_mm256_loadu_ps(values), zero8), one8);
+        return _mm256_cvttps_epi32(_mm256_mul_ps(value, max8));
+    };
+    // Packing works within 128-bit lanes, so the 32-bit groups are put back
+    // in order at the end.
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    for (; i + 32 <= count; i += 32) {
+        const __m256i low = _mm256_packus_epi32(
+            quantize(source + i), quantize(source + i + 8));
+        const __m256i high = _mm256_packus_epi32(
+            quantize(source + i + 16), quantize(source + i + 24));
+        const __m256i bytes = _mm256_permutevar8x32_epi32(
+            _mm256_packus_epi16(low, high), order);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), bytes);
+    }
+#endif
+    for (; i < count; ++i) {
+        const float value = !(source[i] > 0.0f) ? 0.0f : std::min(source[i], 1.0f);
+        destination[i] = static_cast<std::uint8_t>(255.0f * value);
+    }
+}
+
+/// Writes the little-endian fields of an OpenEXR file.
+struct ExrWriter {
+    std::ofstream& file;
+
+    template<typename T>
+    void write(T value) {
+        if constexpr (std::endian::native == std::endian::big) {
+            auto bits = std::bit_cast<std::array<char, sizeof(T)>>(value);
+            std::reverse(bits.begin(), bits.end());
+            value = std::bit_cast<T>(bits);
+        }
+        file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void string(std::string_view value) {
+        file.write(value.data(), value.size());
+        file.put('\0');
+    }
+
+    void attribute(std::string_view name, std::string_view type, std::size_t size) {
+        string(name);
+        string(type);
+        write<std::int32_t>(static_cast<std::int32_t>(size));
+    }
+};
+
+} // namespace
+
+void Image::accumulateScaled(
+        const Image& source, const float scale, ThreadPool* pool) {
+    ZoneScoped;
+    assert(source._width == _width && source._height == _height);
+    assert(source._channels == _channels);
+    const std::size_t rowSize = _width * _channels;
+    forEachRowBlock(_height, pool, [&](std::size_t firstRow, std::size_t lastRow) {
+        accumulateScaledSpan(
+            _pixels.data() + firstRow * rowSize,
+            source._pixels.data() + firstRow * rowSize,
+            scale, (lastRow - firstRow) * rowSize);
+    });
+}
+
+void Image::applyCorrection(
+        const Image& source, const float scale, ThreadPool* pool) {
+    ZoneScoped;
+    assert(source._width == _width && source._height == _height);
+    assert(source._channels == _channels);
+    const std::size_t rowSize = _width * _channels;
+    forEachRowBlock(_height, pool, [&](std::size_t firstRow, std::size_t lastRow) {
+        applyCorrectionSpan(
+            _pixels.data() + firstRow * rowSize,
+            source._pixels.data() + firstRow * rowSize,
+            scale, (lastRow - firstRow) * rowSize);
+    });
+}
+
+void Image::convertToBytes(
+        std::span<std::uint8_t> bytes, const bool flipVertically,
+        ThreadPool* pool) const {
+    ZoneScoped;
+    assert(bytes.size() == _pixels.size());
+    const std::size_t rowSize = _width * _channels;
+    forEachRowBlock(_height, pool, [&](std::size_t firstRow, std::size_t lastRow) {
+        for (std::size_t y = firstRow; y < lastRow; ++y) {
+            const std::size_t targetRow = flipVertically ? _height - 1 - y : y;
+            convertToBytesSpan(
+                bytes.data() + targetRow * rowSize,
+                _pixels.data() + y * rowSize, rowSize);
+        }
+    });
+}
+
 void Image::load(const std::filesystem::path& fileName) {
     ZoneScoped;
     ZoneTextF("fileName=%s", fileName.string().c_str());
+    if (fileName.extension() == ".pfm") {
+        if (!loadPfm(fileName)) {
+            std::println(stderr, "Unable to load {}", fileName.string());
+            *this = Image();
+            return;
+        }
+        std::println("Loaded {}", fileName.string());
+        return;
+    }
     int width, height, numChannels;
     float* buffer = stbi_loadf(
         fileName.string().c_str(), &width, &height, &numChannels, 0);
@@ -53,26 +267,167 @@ void Image::load(const std::span<const std::byte> bytes) {
 void Image::save(const std::filesystem::path& fileName) const {
     ZoneScoped;
     ZoneTextF("fileName=%s", fileName.string().c_str());
+    const std::filesystem::path extension = fileName.extension();
+    bool result;
+    if (extension == ".pfm")
+        result = savePfm(fileName);
+    else if (extension == ".exr")
+        result = saveExr(fileName);
+    else
+        result = savePng(fileName);
+    if (!result) {
+        std::println(stderr, "Failed to save: {}", fileName.string());
+    } else {
+        std::println("Saved \"{}\".", fileName.string());
+    }
+}
+
+bool Image::loadPfm(const std::filesystem::path& fileName) {
+    // Rejects headers too large to be a real image before allocating.
+    constexpr std::int64_t MaxDimension = 1 << 20;
+    std::ifstream file(fileName, std::ios::binary);
+    std::string type;
+    // Signed, so a negative size is rejected instead of wrapping around.
+    std::int64_t width = 0, height = 0;
+    float scale = 0.0f;
+    if (!(file >> type >> width >> height >> scale) ||
+            (type != "PF" && type != "Pf") || scale == 0.0f ||
+            width <= 0 || width > MaxDimension || height <= 0 || height > MaxDimension)
+        return false;
+    // A single whitespace character separates the header from the data.
+    file.get();
+
+    const int channels = type == "PF" ? 3 : 1;
+    const std::streamoff dataStart = file.tellg();
+    file.seekg(0, std::ios::end);
+    const std::streamoff dataSize = file.tellg() - dataStart;
+    file.seekg(dataStart);
+    if (!file || dataSize < static_cast<std::streamoff>(
+            width * height * channels * sizeof(float)))
+        return false;
+
+    _channels = channels;
+    resize(static_cast<std::size_t>(width), static_cast<std::size_t>(height));
+    file.read(
+        reinterpret_cast<char*>(_pixels.data()),
+        static_cast<std::streamsize>(_pixels.size() * sizeof(float)));
+    if (!file)
+        return false;
+    // A negative scale marks little-endian data. Rows are stored from the
+    // bottom up, which matches our layout.
+    const bool isLittleEndian = scale < 0.0f;
+    if (isLittleEndian != (std::endian::native == std::endian::little)) {
+        for (float& value : _pixels)
+            value = std::bit_cast<float>(std::byteswap(std::bit_cast<std::uint32_t>(value)));
+    }
+    return true;
+}
+
+bool Image::savePng(const std::filesystem::path& fileName) const {
     std::vector<std::uint8_t> buffer(_width * _height * _channels);
     // Vertically flip the image when saving
-    for (std::size_t y = 0; y < _height; ++y) {
-        std::size_t srcRow = _height - 1 - y;
-        for (std::size_t x = 0; x < _width; ++x) {
-            for (int c = 0; c < _channels; ++c) {
-                std::size_t srcIdx = (srcRow * _width + x) * _channels + c;
-                std::size_t dstIdx = (y * _width + x) * _channels + c;
-                buffer[dstIdx] = static_cast<std::uint8_t>(
-                    255.0f * gammaCorrection(toneMapping(_pixels[srcIdx])));
-            }
-        }
-    }
+    convertToBytes(buffer, true);
     int stride = _width * _channels;
-    int result = stbi_write_png(
+    return stbi_write_png(
         fileName.string().c_str(), _width, _height, _channels,
         buffer.data(), stride);
-    if (!result) {
-        std::println(stderr, "Failed to save: {}", fileName.string());
+}
+
+bool Image::savePfm(const std::filesystem::path& fileName) const {
+    // PFM only has grayscale and RGB variants.
+    if (_channels != 1 && _channels < 3)
+        return false;
+    std::ofstream file(fileName, std::ios::binary);
+    if (!file)
+        return false;
+    // A negative scale marks little-endian data. Rows are stored from the
+    // bottom up, which matches our layout.
+    const bool isLittleEndian = std::endian::native == std::endian::little;
+    file << (_channels == 1 ? "Pf" : "PF") << '\n'
+         << _width << ' ' << _height << '\n'
+         << (isLittleEndian ? "-1.0" : "1.0") << '\n';
+    if (_channels == 1 || _channels == 3) {
+        file.write(
+            reinterpret_cast<const char*>(_pixels.data()),
+            _pixels.size() * sizeof(float));
     } else {
-        std::println("Saved \"{}\".", fileName.string());
+        // Drop the alpha channel.
+        for (std::size_t y = 0; y < _height; ++y)
+            for (std::size_t x = 0; x < _width; ++x)
+                file.write(reinterpret_cast<const char*>(&rgb(x, y)), 3 * sizeof(float));
+    }
+    return static_cast<bool>(file);
+}
+
+bool Image::saveExr(const std::filesystem::path& fileName) const {
+    // Channels are listed, and stored, in alphabetical order.
+    std::vector<std::pair<std::string_view, int>> exrChannels;
+    if (_channels == 1)
+        exrChannels = {{"Y", 0}};
+    else if (_channels == 3)
+        exrChannels = {{"B", 2}, {"G", 1}, {"R", 0}};
+    else if (_channels == 4)
+        exrChannels = {{"A", 3}, {"B", 2}, {"G", 1}, {"R", 0}};
+    else
+        return false;
+
+    std::ofstream file(fileName, std::ios::binary);
+    if (!file)
+        return false;
+    ExrWriter writer{file};
+    writer.write<std::uint32_t>(20000630); // Magic number
+    writer.write<std::uint32_t>(2); // Version 2, single part scanline file
+
+    std::size_t channelListSize = 1;
+    for (const auto& [name, _] : exrChannels)
+        channelListSize += name.size() + 1 + 16;
+    writer.attribute("channels", "chlist", channelListSize);
+    for (const auto& [name, _] : exrChannels) {
+        writer.string(name);
+        writer.write<std::int32_t>(2); // FLOAT
+        writer.write<std::uint8_t>(0); // pLinear
+        writer.write<std::uint8_t>(0); // Reserved
+        writer.write<std::uint8_t>(0);
+        writer.write<std::uint8_t>(0);
+        writer.write<std::int32_t>(1); // xSampling
+        writer.write<std::int32_t>(1); // ySampling
+    }
+    writer.write<std::uint8_t>(0);
+    writer.attribute("compression", "compression", 1);
+    writer.write<std::uint8_t>(0); // NO_COMPRESSION
+    for (const char* window : {"dataWindow", "displayWindow"}) {
+        writer.attribute(window, "box2i", 16);
+        writer.write<std::int32_t>(0);
+        writer.write<std::int32_t>(0);
+        writer.write<std::int32_t>(static_cast<std::int32_t>(_width) - 1);
+        writer.write<std::int32_t>(static_cast<std::int32_t>(_height) - 1);
+    }
+    writer.attribute("lineOrder", "lineOrder", 1);
+    writer.write<std::uint8_t>(0); // INCREASING_Y
+    writer.attribute("pixelAspectRatio", "float", 4);
+    writer.write<float>(1.0f);
+    writer.attribute("screenWindowCenter", "v2f", 8);
+    writer.write<float>(0.0f);
+    writer.write<float>(0.0f);
+    writer.attribute("screenWindowWidth", "float", 4);
+    writer.write<float>(1.0f);
+    writer.write<std::uint8_t>(0); // End of header
+
+    // One scanline per chunk, each chunk being the line number, the data
+    // size and then every channel's values for the line.
+    const std::size_t lineDataSize = _width * exrChannels.size() * sizeof(float);
+    const std::uint64_t firstChunkOffset =
+        static_cast<std::uint64_t>(file.tellp()) + _height * sizeof(std::uint64_t);
+    for (std::size_t y = 0; y < _height; ++y)
+        writer.write<std::uint64_t>(firstChunkOffset + y * (8 + lineDataSize));
+    for (std::size_t y = 0; y < _height; ++y) {
+        writer.write<std::int32_t>(static_cast<std::int32_t>(y));
+        writer.write<std::int32_t>(static_cast<std::int32_t>(lineDataSize));
+        // EXR lines go from the top down.
+        const float* row = _pixels.data() + (_height - 1 - y) * _width * _channels;
+        for (const auto& [_, channel] : exrChannels)
+            for (std::size_t x = 0; x < _width; ++x)
+                writer.write<float>(row[x * _channels + channel]);
     }
+    return static_cast<bool>(file);
 }
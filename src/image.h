@@ -6,13 +6,17 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <vector>
 #include <filesystem>
 #include <span>
 
 #include "types.h"
 
+class ThreadPool;
+
 template<typename T>
 struct ChannelCount;
 template<> struct ChannelCount<float> { static constexpr int value = 1; };
@@ -35,6 +39,9 @@ public:
     [[nodiscard]] float* pixels() { return _pixels.data(); }
     [[nodiscard]] const float* pixels() const { return _pixels.data(); }
     [[nodiscard]] bool empty() const { return _pixels.empty(); }
+    [[nodiscard]] std::size_t memoryUsage() const {
+        return _pixels.capacity() * sizeof(float);
+    }
 
     void resize(std::size_t w, std::size_t h) {
         _width = w;
@@ -106,16 +113,47 @@ public:
         return r;
     }
 
+    static constexpr float DisplayGamma = 2.2f;
+
     template<typename T>
     static T applyCorrection(T r) {
-        return gammaCorrection(toneMapping(r), 2.2f);
+        return gammaCorrection(toneMapping(r), DisplayGamma);
     }
 
+    // Bulk operations over whole images. These are vectorized and, when a
+    // pool is given, split into blocks of rows that run in parallel. The
+    // pool must not be running other work, since they wait on it.
+
+    /// Adds `source * scale` to this image, which must have the same size.
+    void accumulateScaled(
+        const Image& source, float scale, ThreadPool* pool = nullptr);
+
+    /// Sets this image to `applyCorrection(source * scale)` with a table
+    /// based gamma curve. `source` may be this image.
+    void applyCorrection(
+        const Image& source, float scale, ThreadPool* pool = nullptr);
+
+    /// Clamps every channel to [0, 1] and quantizes it to 8 bits, optionally
+    /// flipping the rows. `bytes` holds `width * height * channels` values.
+    void convertToBytes(
+        std::span<std::uint8_t> bytes, bool flipVertically,
+        ThreadPool* pool = nullptr) const;
+
+    /// Loads `.pfm` files directly and anything else through stb_image. The
+    /// image is left empty if loading fails.
     void load(const std::filesystem::path& fileName);
     void load(const std::span<const std::byte> bytes);
+    /// Saves the image in the format given by the file extension: `.pfm`
+    /// and `.exr` store the floats losslessly, anything else is written as
+    /// an 8-bit PNG.
     void save(const std::filesystem::path& fileName) const;
 
 private:
+    bool loadPfm(const std::filesystem::path& fileName);
+    bool savePng(const std::filesystem::path& fileName) const;
+    bool savePfm(const std::filesystem::path& fileName) const;
+    bool saveExr(const std::filesystem::path& fileName) const;
+
     std::vector<float> _pixels;
     std::size_t _width = 0, _height = 0;
     int _channels = 0;
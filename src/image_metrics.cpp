@@ -0,0 +1,239 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#include "image_metrics.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+#include "glm/common.hpp"
+#include "tracy/Tracy.hpp"
+
+namespace {
+
+/// Standard deviations, in pixels, of the blurs approximating the contrast
+/// sensitivity of the eye at 67 pixels per degree. Color differences are
+/// blurred more than luminance differences.
+constexpr std::array<float, 3> ContrastSigmas{0.6f, 1.6f, 1.6f};
+/// Standard deviation, in pixels, of the blur before edge detection.
+constexpr float EdgeSigma = 1.0f;
+
+constexpr float ColorExponent = 0.7f;
+constexpr float FeatureExponent = 0.5f;
+
+/// D65 white point in XYZ.
+const Vec3 WhitePoint(0.950428545f, 1.0f, 1.088900371f);
+
+/// A single channel of an image.
+struct Plane {
+    std::size_t width, height;
+    std::vector<float> values;
+
+    float& at(std::size_t x, std::size_t y) { return values[x + y * width]; }
+    float at(std::size_t x, std::size_t y) const { return values[x + y * width]; }
+};
+
+Vec3 linearRgbToXyz(const Vec3& rgb) {
+    return Vec3(
+        0.4124564f * rgb.r + 0.3575761f * rgb.g + 0.1804375f * rgb.b,
+        0.2126729f * rgb.r + 0.7151522f * rgb.g + 0.0721750f * rgb.b,
+        0.0193339f * rgb.r + 0.1191920f * rgb.g + 0.9503041f * rgb.b);
+}
+
+Vec3 xyzToLinearRgb(const Vec3& xyz) {
+    return Vec3(
+        3.2404542f * xyz.x - 1.5371385f * xyz.y - 0.4985314f * xyz.z,
+        -0.9692660f * xyz.x + 1.8760108f * xyz.y + 0.0415560f * xyz.z,
+        0.0556434f * xyz.x - 0.2040259f * xyz.y + 1.0572252f * xyz.z);
+}
+
+/// Opponent color space in which FLIP applies its contrast sensitivity
+/// filters: luminance, red-green and blue-yellow.
+Vec3 xyzToYcxcz(const Vec3& xyz) {
+    const Vec3 relative = xyz / WhitePoint;
+    return Vec3(
+        116.0f * relative.y - 16.0f,
+        500.0f * (relative.x - relative.y),
+        200.0f * (relative.y - relative.z));
+}
+
+Vec3 ycxczToXyz(const Vec3& ycxcz) {
+    const float y = (ycxcz.x + 16.0f) / 116.0f;
+    return Vec3(ycxcz.y / 500.0f + y, y, y - ycxcz.z / 200.0f) * WhitePoint;
+}
+
+Vec3 xyzToLab(const Vec3& xyz) {
+    constexpr float Delta = 6.0f / 29.0f;
+    const auto f = [](float t) {
+        return t > Delta * Delta * Delta
+            ? std::cbrt(t)
+            : t / (3.0f * Delta * Delta) + 4.0f / 29.0f;
+    };
+    const Vec3 relative = xyz / WhitePoint;
+    return Vec3(
+        116.0f * f(relative.y) - 16.0f,
+        500.0f * (f(relative.x) - f(relative.y)),
+        200.0f * (f(relative.y) - f(relative.z)));
+}
+
+/// Sum of the lightness difference and the Euclidean chroma difference,
+/// which tracks perceived differences better than plain Euclidean distance
+/// for large differences.
+float hyab(const Vec3& lab1, const Vec3& lab2) {
+    const Vec3 difference = lab1 - lab2;
+    return std::abs(difference.x) +
+        std::sqrt(difference.y * difference.y + difference.z * difference.z);
+}
+
+/// Splits the displayable part of the image into the three opponent
+/// channels.
+std::array<Plane, 3> toOpponentPlanes(const Image& image) {
+    std::array<Plane, 3> planes;
+    for (Plane& plane : planes) {
+        plane.width = image.width();
+        plane.height = image.height();
+        plane.values.resize(image.width() * image.height());
+    }
+    for (std::size_t y = 0; y < image.height(); ++y) {
+        for (std::size_t x = 0; x < image.width(); ++x) {
+            const Vec3 ycxcz = xyzToYcxcz(
+                linearRgbToXyz(Image::toneMapping(image.rgb(x, y))));
+            for (int c = 0; c < 3; ++c)
+                planes[c].at(x, y) = ycxcz[c];
+        }
+    }
+    return planes;
+}
+
+/// Separable Gaussian blur, repeating the edge pixels outside the image.
+Plane blur(const Plane& plane, float sigma) {
+    const int radius = static_cast<int>(std::ceil(3.0f * sigma));
+    std::vector<float> weights(2 * radius + 1);
+    float weightSum = 0.0f;
+    for (int i = -radius; i <= radius; ++i) {
+        weights[i + radius] = std::exp(-0.5f * i * i / (sigma * sigma));
+        weightSum += weights[i + radius];
+    }
+    for (float& weight : weights)
+        weight /= weightSum;
+
+    const auto clampIndex = [](std::size_t base, int offset, std::size_t size) {
+        return static_cast<std::size_t>(std::clamp(
+            static_cast<int>(base) + offset, 0, static_cast<int>(size) - 1));
+    };
+    Plane horizontal = plane;
+    for (std::size_t y = 0; y < plane.height; ++y) {
+        for (std::size_t x = 0; x < plane.width; ++x) {
+            float sum = 0.0f;
+            for (int i = -radius; i <= radius; ++i)
+                sum += weights[i + radius] * plane.at(clampIndex(x, i, plane.width), y);
+            horizontal.at(x, y) = sum;
+        }
+    }
+    Plane result = plane;
+    for (std::size_t y = 0; y < plane.height; ++y) {
+        for (std::size_t x = 0; x < plane.width; ++x) {
+            float sum = 0.0f;
+            for (int i = -radius; i <= radius; ++i)
+                sum += weights[i + radius] * horizontal.at(x, clampIndex(y, i, plane.height));
+            result.at(x, y) = sum;
+        }
+    }
+    return result;
+}
+
+/// Gradient magnitude of the normalized luminance, in about [0, 1].
+Plane edges(const Plane& luminance) {
+    Plane normalized = luminance;
+    for (float& value : normalized.values)
+        value = (value + 16.0f) / 116.0f;
+    const Plane smoothed = blur(normalized, EdgeSigma);
+    Plane result = smoothed;
+    const auto at = [&](int x, int y) {
+        return smoothed.at(
+            std::clamp(x, 0, static_cast<int>(smoothed.width) - 1),
+            std::clamp(y, 0, static_cast<int>(smoothed.height) - 1));
+    };
+    for (int y = 0; y < static_cast<int>(smoothed.height); ++y) {
+        for (int x = 0; x < static_cast<int>(smoothed.width); ++x) {
+            // Sobel kernels, whose response to a unit step is 4.
+            const float dx =
+                (at(x + 1, y - 1) + 2.0f * at(x + 1, y) + at(x + 1, y + 1)) -
+                (at(x - 1, y - 1) + 2.0f * at(x - 1, y) + at(x - 1, y + 1));
+            const float dy =
+                (at(x - 1, y + 1) + 2.0f * at(x, y + 1) + at(x + 1, y + 1)) -
+                (at(x - 1, y - 1) + 2.0f * at(x, y - 1) + at(x + 1, y - 1));
+            result.at(x, y) = 0.25f * std::sqrt(dx * dx + dy * dy);
+        }
+    }
+    return result;
+}
+
+double computeFlip(const Image& image, const Image& reference) {
+    std::array<Plane, 3> imagePlanes = toOpponentPlanes(image);
+    std::array<Plane, 3> referencePlanes = toOpponentPlanes(reference);
+    const Plane imageEdges = edges(imagePlanes[0]);
+    const Plane referenceEdges = edges(referencePlanes[0]);
+    for (int c = 0; c < 3; ++c) {
+        imagePlanes[c] = blur(imagePlanes[c], ContrastSigmas[c]);
+        referencePlanes[c] = blur(referencePlanes[c], ContrastSigmas[c]);
+    }
+
+    const auto toLab = [](const std::array<Plane, 3>& planes, std::size_t i) {
+        const Vec3 ycxcz(planes[0].values[i], planes[1].values[i], planes[2].values[i]);
+        const Vec3 rgb = glm::clamp(xyzToLinearRgb(ycxczToXyz(ycxcz)), 0.0f, 1.0f);
+        return xyzToLab(linearRgbToXyz(rgb));
+    };
+    // The largest difference within the sRGB gamut, between green and blue.
+    const float maxColorError = std::pow(
+        hyab(xyzToLab(linearRgbToXyz(Vec3(0.0f, 1.0f, 0.0f))),
+             xyzToLab(linearRgbToXyz(Vec3(0.0f, 0.0f, 1.0f)))),
+        ColorExponent);
+
+    double errorSum = 0.0;
+    const std::size_t numPixels = image.width() * image.height();
+    for (std::size_t i = 0; i < numPixels; ++i) {
+        const float colorError = std::min(
+            1.0f,
+            std::pow(hyab(toLab(imagePlanes, i), toLab(referencePlanes, i)), ColorExponent) /
+                maxColorError);
+        const float featureError = std::pow(
+            std::min(1.0f, std::abs(imageEdges.values[i] - referenceEdges.values[i]) /
+                std::sqrt(2.0f)),
+            FeatureExponent);
+        errorSum += std::pow(colorError, 1.0f - featureError);
+    }
+    return numPixels > 0 ? errorSum / numPixels : 0.0;
+}
+
+} // namespace
+
+ImageErrors computeImageErrors(const Image& image, const Image& reference) {
+    ZoneScoped;
+    assert(image.width() == reference.width() && image.height() == reference.height());
+    assert(image.channels() >= 3 && reference.channels() >= 3);
+
+    double squaredErrorSum = 0.0;
+    double relativeSquaredErrorSum = 0.0;
+    for (std::size_t y = 0; y < image.height(); ++y) {
+        for (std::size_t x = 0; x < image.width(); ++x) {
+            const Vec3 value = image.rgb(x, y);
+            const Vec3 referenceValue = reference.rgb(x, y);
+            for (int c = 0; c < 3; ++c) {
+                const double error = value[c] - referenceValue[c];
+                squaredErrorSum += error * error;
+                relativeSquaredErrorSum += error * error /
+                    (static_cast<double>(referenceValue[c]) * referenceValue[c] + RelativeErrorEpsilon);
+            }
+        }
+    }
+    const double numValues = std::max<double>(3.0 * image.width() * image.height(), 1.0);
+    return ImageErrors{
+        .rmse = std::sqrt(squaredErrorSum / numValues),
+        .relMse = relativeSquaredErrorSum / numValues,
+        .flip = computeFlip(image, reference)};
+}
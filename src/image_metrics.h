@@ -0,0 +1,34 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#pragma once
+
+#include "image.h"
+
+/// Added to the squared reference value in relative errors, which are
+/// undefined where the reference is black.
+inline constexpr double RelativeErrorEpsilon = 1e-2;
+
+/// Errors of a rendered image against a reference render of the same scene.
+struct ImageErrors {
+    /// Root mean squared error over all pixels and color channels.
+    double rmse = 0.0;
+    /// Mean of the squared error divided by the squared reference value,
+    /// which weighs dark and bright regions alike.
+    double relMse = 0.0;
+    /// Mean perceived difference in [0, 1], see `computeImageErrors`.
+    double flip = 0.0;
+};
+
+/// Compares the linear radiance in `image` with `reference`, which must
+/// have the same size and at least three channels.
+///
+/// The perceptual error follows the structure of LDR FLIP: both images are
+/// clamped to the displayable range, blurred in an opponent color space to
+/// mimic the contrast sensitivity of the eye, compared by their HyAB color
+/// distance, and the color error is amplified where the edges of the two
+/// images differ. The filters assume 67 pixels per degree, and are
+/// simplified, so values are comparable between runs of this tool but not
+/// with other FLIP implementations.
+ImageErrors computeImageErrors(const Image& image, const Image& reference);
@@ -0,0 +1,45 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#include "image_writer.h"
+
+#include <functional>
+
+#include "tracy/Tracy.hpp"
+
+ImageWriter::ImageWriter()
+    : _thread(std::bind_front(&ImageWriter::writeLoop, this)) {}
+
+ImageWriter::~ImageWriter() {
+    {
+        std::lock_guard lock(_mutex);
+        _stopping = true;
+    }
+    _requestCV.notify_all();
+    _thread.join();
+}
+
+void ImageWriter::enqueue(Image image, std::filesystem::path fileName) {
+    {
+        std::lock_guard lock(_mutex);
+        _requests.push(Request(std::move(image), std::move(fileName)));
+    }
+    _requestCV.notify_one();
+}
+
+void ImageWriter::writeLoop() {
+    tracy::SetThreadName("Image Writer");
+    while (true) {
+        Request request;
+        {
+            std::unique_lock lock(_mutex);
+            _requestCV.wait(lock, [&] { return _stopping || !_requests.empty(); });
+            if (_stopping && _requests.empty())
+                break;
+            request = std::move(_requests.front());
+            _requests.pop();
+        }
+        request.image.save(request.fileName);
+    }
+}
@@ -0,0 +1,43 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#pragma once
+
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+#include "image.h"
+
+/// Saves images on a background thread so encoding never blocks rendering or
+/// presentation. Images are written in the order they are queued, and any
+/// still queued when the writer is destroyed are written before it returns.
+class ImageWriter {
+public:
+    ImageWriter();
+    ~ImageWriter();
+
+    ImageWriter(const ImageWriter&) = delete;
+    ImageWriter& operator=(const ImageWriter&) = delete;
+
+    /// Queues `image` to be saved with `Image::save`, which picks the format
+    /// from the extension of `fileName`.
+    void enqueue(Image image, std::filesystem::path fileName);
+
+private:
+    void writeLoop();
+
+    struct Request {
+        Image image;
+        std::filesystem::path fileName;
+    };
+
+    bool _stopping = false;
+    std::mutex _mutex;
+    std::condition_variable _requestCV;
+    std::queue<Request> _requests;
+    std::thread _thread;
+};
@@ -0,0 +1,32 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#pragma once
+
+#include <format>
+#include <string>
+#include <string_view>
+
+/// Quotes `text` as a JSON string, escaping quotes, backslashes and control
+/// characters. Other bytes are copied, so UTF-8 text stays as it is.
+inline std::string jsonString(std::string_view text) {
+    std::string result = "\"";
+    for (const char c : text) {
+        switch (c) {
+        case '"':  result += "\\\""; break;
+        case '\\': result += "\\\\"; break;
+        case '\b': result += "\\b"; break;
+        case '\f': result += "\\f"; break;
+        case '\n': result += "\\n"; break;
+        case '\r': result += "\\r"; break;
+        case '\t': result += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+                result += std::format("\\u{:04x}", static_cast<unsigned char>(c));
+            else
+                result += c;
+        }
+    }
+    return result + '"';
+}
@@ -0,0 +1,324 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <print>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "argparse/argparse.hpp"
+#include "glm/vector_relational.hpp"
+
+#include "bvh.h"
+#include "material.h"
+#include "path.h"
+#include "random.h"
+#include "ray_capture.h"
+#include "render_stats.h"
+#include "scene.h"
+#include "threadpool.h"
+
+constexpr const char* ApplicationName = "MLTKernelBenchmark";
+
+namespace {
+
+constexpr std::array<std::string_view, NumRayKinds> RayKindNames{
+    "primary", "secondary", "shadow"};
+
+/// Items handed to a pool task at once. Large enough that queueing the
+/// tasks costs little next to the work in them.
+constexpr std::size_t ChunkSize = 4096;
+
+struct KernelResult {
+    std::size_t numItems = 0;
+    /// Fastest of the repeated runs.
+    double seconds = std::numeric_limits<double>::infinity();
+    /// Counted over a single run.
+    std::uint64_t numHits = 0;
+    RenderStats::Totals stats;
+};
+
+/// Calls `fn(begin, end)`, which returns its number of hits, over chunks of
+/// `[0, count)`, on `pool` if given and on this thread otherwise. Repeats
+/// the whole range `numRepeats` times and keeps the fastest.
+template<typename ChunkFn>
+KernelResult runKernel(
+        const std::size_t count, ThreadPool* pool, const int numRepeats,
+        const ChunkFn& fn) {
+    KernelResult result{.numItems = count};
+    for (int repeat = 0; repeat < numRepeats; ++repeat) {
+        std::atomic<std::uint64_t> numHits = 0;
+        const RenderStats::Totals statsBefore = RenderStats::total();
+        const auto startTime = std::chrono::steady_clock::now();
+        for (std::size_t begin = 0; begin < count; begin += ChunkSize) {
+            const std::size_t end = std::min(begin + ChunkSize, count);
+            if (pool) {
+                pool->assignWork([&, begin, end] {
+                    numHits.fetch_add(fn(begin, end), std::memory_order_relaxed);
+                });
+            } else {
+                numHits += fn(begin, end);
+            }
+        }
+        if (pool)
+            pool->wait();
+        const std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - startTime;
+
+        result.seconds = std::min(result.seconds, elapsed.count());
+        result.numHits = numHits;
+        result.stats = RenderStats::total() - statsBefore;
+    }
+    return result;
+}
+
+void printHeader() {
+    std::println(
+        "{:<10} {:<10} {:>7} {:>10} {:>10} {:>10} {:>11} {:>10}",
+        "kernel", "rays", "threads", "items", "ns/item", "hits", "nodes/ray",
+        "tris/ray");
+}
+
+void printResult(
+        std::string_view kernel, std::string_view rays, const int numThreads,
+        const KernelResult& result) {
+    const double numItems = std::max<double>(result.numItems, 1.0);
+    std::println(
+        "{:<10} {:<10} {:>7} {:>10} {:>10.2f} {:>10} {:>11.2f} {:>10.2f}",
+        kernel, rays, numThreads, result.numItems,
+        result.seconds * 1e9 / numItems, result.numHits,
+        result.stats.numNodeVisits / numItems,
+        result.stats.numTriangleTests / numItems);
+}
+
+/// Closest hit over the BVHs of every primitive, without computing the
+/// shading data that `Scene::intersect` adds.
+std::optional<std::pair<const Mesh*, BVH::HitInfo>> traverse(
+        const Scene& scene, const RayCapture::Record& record) {
+    const Ray ray(record.origin, record.direction);
+    std::optional<std::pair<const Mesh*, BVH::HitInfo>> closestHit;
+    for (const Mesh& mesh : scene.meshes) {
+        for (const Mesh::Primitive& primitive : mesh.primitives) {
+            std::optional<BVH::HitInfo> hitInfo = primitive.bvh.intersect(
+                ray, record.minDistance, record.maxDistance);
+            if (hitInfo && (!closestHit || hitInfo->distance < closestHit->second.distance))
+                closestHit.emplace(&mesh, *hitInfo);
+        }
+    }
+    return closestHit;
+}
+
+} // namespace
+
+int main(int argc, const char* argv[]) {
+    argparse::ArgumentParser parser(
+        ApplicationName, "", argparse::default_arguments::help);
+
+    std::filesystem::path sceneFile;
+    parser.add_argument("scene-file")
+        .help("The scene the rays were captured in.")
+        .required()
+        .store_into(sceneFile);
+
+    std::filesystem::path raysFile;
+    parser.add_argument("rays-file")
+        .help("Rays recorded with MLT --headless --capture-rays.")
+        .required()
+        .store_into(raysFile);
+
+    int numJobs = std::thread::hardware_concurrency();
+    parser.add_argument("-j", "--jobs")
+        .metavar("NUM_JOBS")
+        .help("The number of threads of the multi-threaded runs.")
+        .store_into(numJobs);
+
+    int numRepeats = 3;
+    parser.add_argument("--repeat")
+        .metavar("NUM_RUNS")
+        .help("Runs of each kernel, of which the fastest is reported. "
+            "Defaults to 3.")
+        .store_into(numRepeats);
+
+    bool noAnalyticShapes = false;
+    parser.add_argument("--no-analytic-shapes")
+        .help("Load the scene as MLT --no-analytic-shapes would.")
+        .store_into(noAnalyticShapes);
+
+    try {
+        parser.parse_args(argc, argv);
+    } catch (const std::exception& err) {
+        std::cerr << err.what() << std::endl;
+        std::cerr << parser;
+        std::exit(1);
+    }
+    numRepeats = std::max(numRepeats, 1);
+
+    const std::optional<std::vector<RayCapture::Record>> records =
+        RayCapture::read(raysFile);
+    if (!records)
+        return 1;
+
+    // Only intersection depends on the camera, and the rays carry their own
+    // origins, so any camera will do.
+    Camera camera(
+        512, 384, 45.0f, 0.032f,
+        Vec3(0.0f, 0.0f, 1.5f),
+        Vec3(0.0f, 0.0f, -1.0f),
+        Vec3(0.0f, 1.0f, 0.0f));
+    Scene scene(camera);
+    Scene::LoadOptions loadOptions;
+    loadOptions.detectAnalyticShapes = !noAnalyticShapes;
+    if (!scene.load(sceneFile, loadOptions))
+        return 1;
+
+    std::array<std::vector<RayCapture::Record>, NumRayKinds> recordsByKind;
+    for (const RayCapture::Record& record : *records)
+        recordsByKind[static_cast<std::size_t>(record.kind)].push_back(record);
+    std::println(
+        "{} rays: {} primary, {} secondary, {} shadow",
+        records->size(), recordsByKind[0].size(), recordsByKind[1].size(),
+        recordsByKind[2].size());
+
+    // Inputs of the isolated kernels, taken from where the rays really go.
+    std::vector<const AABB4*> topNodes;
+    for (const Mesh& mesh : scene.meshes) {
+        for (const Mesh::Primitive& primitive : mesh.primitives) {
+            if (primitive.bvh.nodes.size() > 1)
+                topNodes.push_back(&primitive.bvh.nodes.front().childBounds);
+        }
+    }
+
+    struct TriangleTest {
+        std::size_t recordIdx;
+        BVH::Triangle triangle;
+    };
+    struct Shading {
+        Vec3 inDir;
+        Path::Vertex vertex;
+    };
+    std::vector<TriangleTest> triangleTests;
+    std::vector<Shading> shadings;
+    for (std::size_t i = 0; i < records->size(); ++i) {
+        const RayCapture::Record& record = (*records)[i];
+        if (const auto hit = traverse(scene, record);
+                hit && hit->second.shapeType != BVH::ShapeType::Sphere) {
+            const Mesh::Triangle& triangle = hit->first->triangles[hit->second.triangleIdx];
+            triangleTests.push_back(TriangleTest{
+                .recordIdx = i,
+                .triangle = BVH::Triangle{triangle.positions, hit->second.triangleIdx}});
+        }
+        if (record.kind == RayKind::Shadow)
+            continue;
+        const Ray ray(record.origin, record.direction);
+        std::optional<Scene::HitInfo> hit = scene.intersect(
+            ray, record.kind, record.minDistance, record.maxDistance);
+        if (!hit)
+            continue;
+        if (scene.getMaterial(hit->materialIdx).getType() != Path::Vertex::BounceType::Refractive &&
+                dot(ray.d, hit->geometricNormal) > 0.0f) {
+            hit->normal *= -1;
+            hit->geometricNormal *= -1;
+        }
+        shadings.push_back(Shading{
+            .inDir = -ray.d,
+            .vertex = Path::Vertex{
+                Path::Vertex::BounceType::None,
+                hit->position,
+                hit->normal,
+                hit->geometricNormal, hit->textureCoord, hit->materialIdx}});
+    }
+
+    std::optional<ThreadPool> pool;
+    std::vector<int> threadCounts{1};
+    if (numJobs > 1) {
+        pool.emplace(numJobs);
+        threadCounts.push_back(numJobs);
+    }
+
+    printHeader();
+    for (const int numThreads : threadCounts) {
+        ThreadPool* poolPtr = numThreads > 1 ? &pool.value() : nullptr;
+
+        for (std::size_t kind = 0; kind < NumRayKinds; ++kind) {
+            const std::vector<RayCapture::Record>& kindRecords = recordsByKind[kind];
+            if (kindRecords.empty())
+                continue;
+            printResult("scene", RayKindNames[kind], numThreads, runKernel(
+                kindRecords.size(), poolPtr, numRepeats,
+                [&](std::size_t begin, std::size_t end) {
+                    std::uint64_t numHits = 0;
+                    for (std::size_t i = begin; i < end; ++i) {
+                        const RayCapture::Record& record = kindRecords[i];
+                        numHits += scene.intersect(
+                            Ray(record.origin, record.direction), record.kind,
+                            record.minDistance, record.maxDistance).has_value();
+                    }
+                    return numHits;
+                }));
+            printResult("bvh", RayKindNames[kind], numThreads, runKernel(
+                kindRecords.size(), poolPtr, numRepeats,
+                [&](std::size_t begin, std::size_t end) {
+                    std::uint64_t numHits = 0;
+                    for (std::size_t i = begin; i < end; ++i)
+                        numHits += traverse(scene, kindRecords[i]).has_value();
+                    return numHits;
+                }));
+        }
+
+        // One item is a ray tested against the top node of every BVH.
+        printResult("aabb4", "all", numThreads, runKernel(
+            records->size(), poolPtr, numRepeats,
+            [&](std::size_t begin, std::size_t end) {
+                std::uint64_t numHits = 0;
+                for (std::size_t i = begin; i < end; ++i) {
+                    const Ray ray((*records)[i].origin, (*records)[i].direction);
+                    for (const AABB4* node : topNodes)
+                        numHits += glm::any(node->intersect(ray).isHit);
+                }
+                return numHits;
+            }));
+
+        // One item is a ray tested against the triangle it hits.
+        printResult("triangle", "hits", numThreads, runKernel(
+            triangleTests.size(), poolPtr, numRepeats,
+            [&](std::size_t begin, std::size_t end) {
+                std::uint64_t numHits = 0;
+                for (std::size_t i = begin; i < end; ++i) {
+                    const RayCapture::Record& record = (*records)[triangleTests[i].recordIdx];
+                    numHits += doesRayIntersectTriangle(
+                        Ray(record.origin, record.direction), triangleTests[i].triangle,
+                        record.minDistance, record.maxDistance).has_value();
+                }
+                return numHits;
+            }));
+
+        // One item samples the bounce at a hit point of a primary or
+        // secondary ray. Counts diffuse bounces in place of hits.
+        PCG32::setSeed(1);
+        printResult("material", "hits", numThreads, runKernel(
+            shadings.size(), poolPtr, numRepeats,
+            [&](std::size_t begin, std::size_t end) {
+                PCG32::reseed(begin);
+                std::uint64_t numDiffuse = 0;
+                for (std::size_t i = begin; i < end; ++i) {
+                    const Material material = scene.getMaterial(shadings[i].vertex.materialIdx);
+                    const auto [ray, bounceType] =
+                        material.sampleDirection(shadings[i].inDir, shadings[i].vertex);
+                    numDiffuse += bounceType == Path::Vertex::BounceType::Diffuse;
+                }
+                return numDiffuse;
+            }));
+    }
+}
@@ -0,0 +1,123 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#include "live_buffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <print>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "tracy/Tracy.hpp"
+
+LiveBuffer::~LiveBuffer() {
+    close();
+}
+
+bool LiveBuffer::open(
+        const std::filesystem::path& fileName,
+        const std::size_t width, const std::size_t height, const int channels) {
+    close();
+    _numFloatsPerImage = width * height * channels;
+    _size = sizeof(Header) + 2 * _numFloatsPerImage * sizeof(float);
+#if defined(_WIN32)
+    _file = CreateFileW(
+        fileName.c_str(), GENERIC_READ | GENERIC_WRITE,
+        FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (_file == INVALID_HANDLE_VALUE) {
+        _file = nullptr;
+        std::println(stderr, "Unable to create {}", fileName.string());
+        return false;
+    }
+    const auto size = static_cast<std::uint64_t>(_size);
+    _mapping = CreateFileMappingW(
+        _file, nullptr, PAGE_READWRITE,
+        static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), nullptr);
+    if (_mapping)
+        _data = MapViewOfFile(_mapping, FILE_MAP_ALL_ACCESS, 0, 0, _size);
+#else
+    _file = ::open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (_file < 0) {
+        std::println(stderr, "Unable to create {}", fileName.string());
+        return false;
+    }
+    if (ftruncate(_file, static_cast<off_t>(_size)) == 0) {
+        void* data = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, _file, 0);
+        if (data != MAP_FAILED)
+            _data = data;
+    }
+#endif
+    if (!_data) {
+        std::println(stderr, "Unable to map {}", fileName.string());
+        close();
+        return false;
+    }
+
+    Header* target = header();
+    std::memcpy(target->magic, Magic, sizeof(Magic));
+    target->version = Version;
+    target->width = static_cast<std::uint32_t>(width);
+    target->height = static_cast<std::uint32_t>(height);
+    target->channels = static_cast<std::uint32_t>(channels);
+    target->epoch = 0;
+    target->samplesPerPixel = 0;
+    std::atomic_ref(target->sequence).store(0, std::memory_order_release);
+    std::println("Mapped live buffer {}", fileName.string());
+    return true;
+}
+
+void LiveBuffer::update(
+        const Image& frameBuffer, const Image& linear,
+        const std::uint64_t samplesPerPixel, const std::uint64_t epoch) {
+    ZoneScoped;
+    if (!isOpen())
+        return;
+    assert(frameBuffer.width() * frameBuffer.height() * frameBuffer.channels() == _numFloatsPerImage);
+    assert(linear.width() * linear.height() * linear.channels() == _numFloatsPerImage);
+
+    Header* target = header();
+    std::atomic_ref sequence(target->sequence);
+    const std::uint64_t start = sequence.load(std::memory_order_relaxed);
+    sequence.store(start + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    target->epoch = epoch;
+    target->samplesPerPixel = samplesPerPixel;
+    std::copy_n(frameBuffer.pixels(), _numFloatsPerImage, pixels());
+    std::copy_n(linear.pixels(), _numFloatsPerImage, pixels() + _numFloatsPerImage);
+
+    sequence.store(start + 2, std::memory_order_release);
+}
+
+void LiveBuffer::close() {
+#if defined(_WIN32)
+    if (_data)
+        UnmapViewOfFile(_data);
+    if (_mapping)
+        CloseHandle(_mapping);
+    if (_file)
+        CloseHandle(_file);
+    _mapping = nullptr;
+    _file = nullptr;
+#else
+    if (_data)
+        munmap(_data, _size);
+    if (_file >= 0)
+        ::close(_file);
+    _file = -1;
+#endif
+    _data = nullptr;
+}
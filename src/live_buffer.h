@@ -0,0 +1,77 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+#include "image.h"
+
+/// Memory-mapped file mirroring the render progress so external tools can
+/// watch a render without copies or any cooperation from the renderer.
+///
+/// The file starts with a `Header`, followed by the display frame buffer and
+/// then the linear radiance, each `width * height * channels` floats stored
+/// row by row from the bottom. Writers follow a seqlock protocol: `sequence`
+/// is odd while an update is in progress. Readers load `sequence`, copy what
+/// they need, and retry if it was odd or has changed since.
+class LiveBuffer {
+public:
+    static constexpr char Magic[8] = {'M', 'L', 'T', 'L', 'I', 'V', 'E', '\0'};
+    static constexpr std::uint32_t Version = 1;
+
+    struct alignas(64) Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t width;
+        std::uint32_t height;
+        std::uint32_t channels;
+        /// Incremented every time the render restarts, e.g. when the camera
+        /// moves.
+        std::uint64_t epoch;
+        std::uint64_t samplesPerPixel;
+        /// Seqlock counter, only accessed atomically.
+        std::uint64_t sequence;
+    };
+
+    LiveBuffer() = default;
+    ~LiveBuffer();
+
+    LiveBuffer(const LiveBuffer&) = delete;
+    LiveBuffer& operator=(const LiveBuffer&) = delete;
+
+    /// Creates or truncates `fileName` and maps it. Returns false, after
+    /// printing the reason, if that fails.
+    bool open(
+        const std::filesystem::path& fileName,
+        std::size_t width, std::size_t height, int channels);
+
+    [[nodiscard]] bool isOpen() const { return _data != nullptr; }
+
+    /// Publishes a new frame. Both images must match the size given to
+    /// `open`.
+    void update(
+        const Image& frameBuffer, const Image& linear,
+        std::uint64_t samplesPerPixel, std::uint64_t epoch);
+
+private:
+    void close();
+
+    Header* header() const { return static_cast<Header*>(_data); }
+    float* pixels() const {
+        return reinterpret_cast<float*>(static_cast<std::byte*>(_data) + sizeof(Header));
+    }
+
+    void* _data = nullptr;
+    std::size_t _size = 0;
+    std::size_t _numFloatsPerImage = 0;
+#if defined(_WIN32)
+    void* _file = nullptr;
+    void* _mapping = nullptr;
+#else
+    int _file = -1;
+#endif
+};
@@ -2,59 +2,278 @@
 // Licensed under the MIT License. See LICENSE in the project root for license
 // information.
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <exception>
+#include <filesystem>
+#include <format>
+#include <optional>
 #include <print>
 #include <thread>
 #include <string>
 #include <sstream>
 #include <string_view>
+#include <vector>
 
 #include "argparse/argparse.hpp"
 
+#if !defined(MLT_HEADLESS)
 #include "application.h"
+#endif
+#include "camera_path.h"
 #include "path_tracer.h"
 #include "scene.h"
 #include "mesh.h"
 #include "mlt.h"
+#include "options.h"
+#include "random.h"
+#include "ray_capture.h"
+#include "render_farm.h"
+#include "render_process.h"
+#include "render_stats.h"
+#include "run_options.h"
+#include "scene_watcher.h"
+#include "startup_report.h"
+#include "streaming_image_writer.h"
+#include "threadpool.h"
 
+#if defined(MLT_HEADLESS)
+constexpr const char* ApplicationName = "MLTHeadless";
+#else
 constexpr const char* ApplicationName = "MLT";
 constexpr const char* WindowTitleMLT = "Metropolis Light Transport";
 constexpr const char* WindowTitlePathTracer = "Path Tracer";
+#endif
 
 namespace {
 
-bool matches(const std::string_view token, const std::string_view ref) {
-    if (token.size() > ref.size())
+/// Renders without a window until a limit is reached, then saves the frame
+/// and prints the throughput.
+void renderHeadless(
+        IRenderer& renderer, Scene& scene,
+        const RunOptions& runOptions,
+        const RenderProcess::Limits& limits,
+        const std::filesystem::path& outputPath) {
+    const int width = scene.camera.width;
+    const int height = scene.camera.height;
+    LiveBuffer liveBuffer;
+    if (runOptions.liveBufferPath)
+        liveBuffer.open(*runOptions.liveBufferPath, width, height, 3);
+    const RenderStats::Totals statsBefore = RenderStats::total();
+    RenderProcess renderProcess(
+        renderer, scene, width, height, runOptions.numJobs,
+        liveBuffer.isOpen() ? &liveBuffer : nullptr, limits);
+    renderProcess.waitUntilFinished();
+
+    std::optional<std::filesystem::path> linearPath;
+    if (runOptions.hdrExtension)
+        linearPath = std::filesystem::path(outputPath).replace_extension(*runOptions.hdrExtension);
+    renderProcess.saveFrame(outputPath, linearPath);
+
+    const double seconds = renderProcess.elapsedTime().count();
+    const CropWindow region =
+        renderer.crop().value_or(CropWindow{.width = width, .height = height});
+    const double numSamples =
+        static_cast<double>(renderer.numSamplesPerPixel()) * region.width * region.height;
+    const double samplesPerSecond = seconds > 0.0 ? numSamples / seconds : 0.0;
+    std::println(
+        "Rendered {}x{} at {} samples per pixel in {:.3f}s: "
+        "{:.3f} M samples/s, {:.3f} M samples/s per thread",
+        width, height, renderer.numSamplesPerPixel(), seconds,
+        samplesPerSecond * 1e-6,
+        samplesPerSecond * 1e-6 / std::max(runOptions.numJobs, 1));
+    const RenderStats::Summary summary{
+        .work = RenderStats::total() - statsBefore, .seconds = seconds};
+    std::println("{}", summary.toString());
+    if (const auto error = renderer.estimateRelativeError())
+        std::println("Estimated relative error: {:.4f}", *error);
+    std::println("Saving {}", outputPath.string());
+}
+
+/// Renders the image one tile at a time with `renderer`, whose buffers are
+/// the size of a tile, and streams every finished row of tiles to the output
+/// files. Only the tile buffers and one row of tiles are ever in memory.
+/// Each tile gets the sample and error limits, and an equal share of the
+/// time budget. Returns false if the output could not be written.
+bool renderTiled(
+        IRenderer& renderer, Scene& scene,
+        const RunOptions& runOptions,
+        const RenderProcess::Limits& limits, int tileSize,
+        const std::filesystem::path& outputPath) {
+    const int width = scene.camera.width;
+    const int height = scene.camera.height;
+    StreamingImageWriter writer;
+    if (!writer.open(outputPath, width, height))
         return false;
-    for (size_t i = 0; i < token.size(); ++i) {
-        if (std::tolower(static_cast<unsigned char>(token[i])) !=
-                std::tolower(static_cast<unsigned char>(ref[i])))
+    StreamingImageWriter linearWriter;
+    if (runOptions.hdrExtension) {
+        const std::filesystem::path linearPath =
+            std::filesystem::path(outputPath).replace_extension(*runOptions.hdrExtension);
+        if (!linearWriter.open(linearPath, width, height))
             return false;
     }
-    return true;
-};
-
-MLT::EnabledMutations getEnabledMutationsFromString(
-        const std::string& string) {
-    std::stringstream ss(string);
-    std::string token;
-    MLT::EnabledMutations result{};
-    while (std::getline(ss, token, ',')) {
-        if (token.empty())
-            continue;
-        if (matches(token, "newPathMutation"))
-            result.newPathMutation = true;
-        else if (matches(token, "lensPerturbation"))
-            result.lensPerturbation = true;
-        else if (matches(token, "multiChainPerturbation"))
-            result.multiChainPerturbation = true;
-        else if (matches(token, "bidirectionalMutation"))
-            result.bidirectionalMutation = true;
-        else
-            throw std::runtime_error(
-                std::format("Unknown mutation type: {}", token));
+
+    const int numTileColumns = (width + tileSize - 1) / tileSize;
+    const int numTileRows = (height + tileSize - 1) / tileSize;
+    const int numTiles = numTileColumns * numTileRows;
+    RenderProcess::Limits tileLimits = limits;
+    if (limits.timeBudget)
+        tileLimits.timeBudget = *limits.timeBudget / numTiles;
+
+    const RenderStats::Totals statsBefore = RenderStats::total();
+    const auto startTime = std::chrono::steady_clock::now();
+    Image tile(tileSize, tileSize, 3);
+    Image linearTile(tileSize, tileSize, 3);
+    std::optional<RenderProcess> renderProcess;
+    int numTilesRendered = 0;
+    // Rows of the image go from the bottom up, and the files are written
+    // from the top down. Tiles of the last row reach past the top of it and
+    // tiles of the last column past the right edge of the image, which
+    // costs some work but keeps every tile the same size.
+    for (int top = height; top > 0; top -= tileSize) {
+        const int bandHeight = std::min(tileSize, top);
+        const int bandY = top - bandHeight;
+        Image band(width, bandHeight, 3);
+        Image linearBand;
+        if (linearWriter.isOpen())
+            linearBand = Image(width, bandHeight, 3);
+        for (int tileX = 0; tileX < width; tileX += tileSize) {
+            renderer.setFilmOffset({.x = tileX, .y = bandY});
+            if (!renderProcess) {
+                renderProcess.emplace(
+                    renderer, scene, tileSize, tileSize, runOptions.numJobs,
+                    nullptr, tileLimits);
+            } else {
+                renderProcess->start();
+            }
+            renderProcess->waitUntilFinished();
+
+            renderer.updateFrameBuffer(tile);
+            if (linearWriter.isOpen())
+                renderer.resolveLinear(linearTile);
+            const int tileWidth = std::min(tileSize, width - tileX);
+            for (int y = 0; y < bandHeight; ++y) {
+                for (int x = 0; x < tileWidth; ++x) {
+                    band.rgb(tileX + x, y) = tile.rgb(x, y);
+                    if (linearWriter.isOpen())
+                        linearBand.rgb(tileX + x, y) = linearTile.rgb(x, y);
+                }
+            }
+            ++numTilesRendered;
+            std::println(
+                "Finished tile {} of {} at {} samples per pixel",
+                numTilesRendered, numTiles, renderer.numSamplesPerPixel());
+        }
+        if (!writer.writeBand(band))
+            return false;
+        if (linearWriter.isOpen() && !linearWriter.writeBand(linearBand))
+            return false;
     }
-    return result;
+    renderProcess.reset();
+
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - startTime;
+    std::println(
+        "Rendered {}x{} in {} tiles of {}x{} in {:.3f}s",
+        width, height, numTiles, tileSize, tileSize, elapsed.count());
+    const RenderStats::Summary summary{
+        .work = RenderStats::total() - statsBefore, .seconds = elapsed.count()};
+    std::println("{}", summary.toString());
+    const bool isSaved = writer.close();
+    return (!linearWriter.isOpen() || linearWriter.close()) && isSaved;
+}
+
+/// Renders a frame every `1 / fps` seconds of `cameraPath`, saving them to
+/// `outputPath` with the frame number appended to the stem. The scene and
+/// its BVHs stay loaded, and each frame gets the limits of a headless
+/// render.
+void renderAnimation(
+        IRenderer& renderer, Scene& scene,
+        const RunOptions& runOptions,
+        const RenderProcess::Limits& limits,
+        const CameraPath& cameraPath, double fps,
+        const std::filesystem::path& outputPath) {
+    const int width = scene.camera.width;
+    const int height = scene.camera.height;
+    const double duration = cameraPath.endTime() - cameraPath.startTime();
+    const int numFrames = static_cast<int>(std::floor(duration * fps)) + 1;
+    const auto framePath = [&](int frame, const std::filesystem::path& extension) {
+        std::filesystem::path path = outputPath;
+        path.replace_filename(std::format("{}_{:04}", outputPath.stem().string(), frame));
+        return path.replace_extension(extension);
+    };
+
+    const RenderStats::Totals statsBefore = RenderStats::total();
+    const auto startTime = std::chrono::steady_clock::now();
+    std::optional<RenderProcess> renderProcess;
+    for (int frame = 0; frame < numFrames; ++frame) {
+        cameraPath.apply(cameraPath.startTime() + frame / fps, scene.camera);
+        if (!renderProcess) {
+            renderProcess.emplace(
+                renderer, scene, width, height, runOptions.numJobs, nullptr, limits);
+        } else {
+            renderProcess->start();
+        }
+        renderProcess->waitUntilFinished();
+
+        std::optional<std::filesystem::path> linearPath;
+        if (runOptions.hdrExtension)
+            linearPath = framePath(frame, *runOptions.hdrExtension);
+        renderProcess->saveFrame(framePath(frame, outputPath.extension()), linearPath);
+        std::println(
+            "Finished frame {} of {} at {} samples per pixel in {:.3f}s",
+            frame + 1, numFrames, renderer.numSamplesPerPixel(),
+            renderProcess->elapsedTime().count());
+    }
+    // Waits for the last frames to be written.
+    renderProcess.reset();
+
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - startTime;
+    std::println(
+        "Rendered {} frames of {}x{} in {:.3f}s",
+        numFrames, width, height, elapsed.count());
+    const RenderStats::Summary summary{
+        .work = RenderStats::total() - statsBefore, .seconds = elapsed.count()};
+    std::println("{}", summary.toString());
+}
+
+/// Renders as a worker of MLTCoordinator, with the seed it assigned, until
+/// a limit is reached. The accumulation is sent to the coordinator about
+/// every `reportInterval` and when rendering ends. Returns false if the
+/// coordinator went away first.
+bool renderWorker(
+        IRenderer& renderer, Scene& scene,
+        const RunOptions& runOptions,
+        const RenderProcess::Limits& limits,
+        RenderFarm::Worker& worker,
+        std::chrono::duration<double> reportInterval) {
+    const int width = scene.camera.width;
+    const int height = scene.camera.height;
+    std::println(
+        "Rendering as worker {} of the coordinator", worker.assignment().workerIndex);
+    PCG32::setSeed(worker.assignment().seed);
+    bool isConnected = true;
+    auto lastReportTime = std::chrono::steady_clock::now();
+    const auto report = [&](bool isFinal) {
+        const auto currentTime = std::chrono::steady_clock::now();
+        if (!isConnected || (!isFinal && currentTime - lastReportTime < reportInterval))
+            return;
+        lastReportTime = currentTime;
+        if (!worker.sendUpdate(renderer.accumulation(), isFinal)) {
+            isConnected = false;
+            renderer.stop();
+        }
+    };
+    RenderProcess renderProcess(
+        renderer, scene, width, height, runOptions.numJobs, nullptr, limits, report);
+    renderProcess.waitUntilFinished();
+    std::println(
+        "Rendered {}x{} at {} samples per pixel in {:.3f}s",
+        width, height, renderer.numSamplesPerPixel(),
+        renderProcess.elapsedTime().count());
+    return isConnected;
 }
 
 } // namespace
@@ -63,11 +282,11 @@ int main(int argc, const char* argv[]) {
     argparse::ArgumentParser parser(
         ApplicationName, "", argparse::default_arguments::help);
 
-    std::filesystem::path glbFile;
-    parser.add_argument("glb-file")
-        .help("The .glb file to load into the scene.")
+    std::filesystem::path sceneFile;
+    parser.add_argument("scene-file")
+        .help("The .glb or binary .ply file to load into the scene.")
         .required()
-        .store_into(glbFile);
+        .store_into(sceneFile);
 
     int numJobs = std::thread::hardware_concurrency();
     parser.add_argument("-j", "--jobs")
@@ -81,6 +300,15 @@ int main(int argc, const char* argv[]) {
         .help("Use regular path tracing instead of MLT.")
         .store_into(usePathTracer);
 
+    PathTracer::Integrator integrator = PathTracer::Integrator::Streaming;
+    std::string integratorString;
+    parser.add_argument("--pt-integrator")
+        .metavar("INTEGRATOR")
+        .help("The integrator used by the path tracer, either \"streaming\" "
+            "(default), which evaluates each sample in a single pass, or "
+            "\"path\", which builds the full path before evaluating it.")
+        .store_into(integratorString);
+
     MLT::EnabledMutations enabledMutations{
         .newPathMutation = true,
         .lensPerturbation = true,
@@ -97,15 +325,210 @@ int main(int argc, const char* argv[]) {
             "will be used.")
         .store_into(enabledMutationsString);
 
+    Scene::LoadOptions loadOptions;
+    bool disableAnalyticShapes = false;
+    parser.add_argument("--no-analytic-shapes")
+        .help("Intersect tessellated spheres and rectangles as triangles "
+            "instead of replacing them with analytic shapes.")
+        .store_into(disableAnalyticShapes);
+
+    std::string sceneCacheDirectory;
+    parser.add_argument("--scene-cache")
+        .metavar("DIR")
+        .help("Directory of binary scene snapshots. Unchanged scenes are "
+            "restored from it without parsing or building BVHs.")
+        .store_into(sceneCacheDirectory);
+
+    parser.add_argument("--lazy-textures")
+        .help("Decode each texture the first time it is sampled instead of "
+            "while loading the scene.")
+        .store_into(loadOptions.lazyTextures);
+
+    RunOptions runOptions;
+    std::string hdrFormatString;
+    parser.add_argument("--hdr")
+        .metavar("FORMAT")
+        .help("Also save the linear radiance with each screenshot, as either "
+            "\"exr\" or \"pfm\".")
+        .store_into(hdrFormatString);
+
+    bool watchSceneFile = false;
+    parser.add_argument("--watch")
+        .help("Reload the scene whenever the scene file changes, rebuilding "
+            "only the BVHs of primitives whose geometry changed.")
+        .store_into(watchSceneFile);
+
+    std::string liveBufferPath;
+    parser.add_argument("--live-buffer")
+        .metavar("PATH")
+        .help("Keep the frame buffer and linear radiance in a memory-mapped "
+            "file that external tools can read while rendering.")
+        .store_into(liveBufferPath);
+
+    bool isHeadless = false;
+    parser.add_argument("--headless")
+        .help("Render without a window until the sample or time budget is "
+            "reached, save the result to the output path and exit.")
+        .store_into(isHeadless);
+
+    std::string resolutionString;
+    parser.add_argument("--resolution")
+        .metavar("WIDTHxHEIGHT")
+        .help("The size of the rendered image. Defaults to 512x384.")
+        .store_into(resolutionString);
+
+    std::string cropString;
+    parser.add_argument("--crop")
+        .metavar("X,Y,WIDTH,HEIGHT")
+        .help("Only render this window of the image, in pixels from the "
+            "top-left corner, leaving the rest black.")
+        .store_into(cropString);
+
+    RenderProcess::Limits renderLimits;
+    parser.add_argument("--spp")
+        .metavar("NUM_SAMPLES")
+        .help("Samples per pixel to render in headless mode. Defaults to "
+            "16384.")
+        .store_into(renderLimits.numSamplesPerPixel);
+
+    double timeBudgetSeconds = 0.0;
+    parser.add_argument("--time-budget")
+        .metavar("SECONDS")
+        .help("Stop rendering in headless mode after about this much time, "
+            "even if fewer samples were taken.")
+        .store_into(timeBudgetSeconds);
+
+    double relativeErrorTarget = 0.0;
+    parser.add_argument("--target-error")
+        .metavar("RELATIVE_ERROR")
+        .help("Stop rendering in headless mode once the estimated relative "
+            "error falls to this, e.g. 0.01. MLT needs at least two jobs to "
+            "estimate it.")
+        .store_into(relativeErrorTarget);
+
+    int tileSize = 0;
+    parser.add_argument("--tile-size")
+        .metavar("PIXELS")
+        .help("Render headless in square tiles of this size, streaming them "
+            "to the output, so memory use does not grow with the resolution.")
+        .store_into(tileSize);
+
+    std::string cameraPathFile;
+    parser.add_argument("--camera-path")
+        .metavar("PATH")
+        .help("Render an animation headless, moving the camera along the "
+            "keyframes in PATH: the camera animation of a .glb or .gltf "
+            "file, or a text file of \"TIME X Y Z TARGET_X TARGET_Y TARGET_Z\" "
+            "lines. Frames are saved with their number appended to the "
+            "output path.")
+        .store_into(cameraPathFile);
+
+    double fps = 24.0;
+    parser.add_argument("--fps")
+        .metavar("FPS")
+        .help("Frames per second of the animation. Defaults to 24.")
+        .store_into(fps);
+
+    bool warmStart = false;
+    parser.add_argument("--warm-start")
+        .help("Continue the MLT chains of each animation frame from the "
+            "previous frame instead of starting them over.")
+        .store_into(warmStart);
+
+    std::string workerAddressString;
+    parser.add_argument("--worker")
+        .metavar("HOST:PORT")
+        .help("Render headless as a worker of the MLTCoordinator at HOST:PORT, "
+            "which assigns the seed and merges the result with other "
+            "workers' instead of saving it here.")
+        .store_into(workerAddressString);
+
+    double reportIntervalSeconds = 5.0;
+    parser.add_argument("--report-interval")
+        .metavar("SECONDS")
+        .help("How often a worker sends its image to the coordinator. "
+            "Defaults to 5.")
+        .store_into(reportIntervalSeconds);
+
+    std::filesystem::path outputPath = "render.png";
+    parser.add_argument("-o", "--output")
+        .metavar("PATH")
+        .help("Where headless mode saves the final image. Defaults to "
+            "render.png. With --hdr, the linear radiance is saved next to it.")
+        .store_into(outputPath);
+
+    std::string captureRaysPath;
+    parser.add_argument("--capture-rays")
+        .metavar("PATH")
+        .help("Record the rays traced in headless mode to PATH, to replay "
+            "them with MLTKernelBenchmark.")
+        .store_into(captureRaysPath);
+
+    int captureLimit = 1 << 21;
+    parser.add_argument("--capture-limit")
+        .metavar("NUM_RAYS")
+        .help("Stop recording rays after this many. Defaults to 2097152.")
+        .store_into(captureLimit);
+
+    std::string startupReportPath;
+    parser.add_argument("--startup-report")
+        .metavar("PATH")
+        .help("Also write the startup phase times and memory usage, which are "
+            "always printed, to PATH as JSON.")
+        .store_into(startupReportPath);
+
     parser.add_epilog(std::format(
         "Example usage: {} ../media/room_far.glb -m new,lens -j 8",
         ApplicationName));
 
+    Resolution resolution{512, 384};
+    std::optional<CropWindow> crop;
+    std::optional<NetworkAddress> workerAddress;
     try {
         parser.parse_args(argc, argv);
+#if defined(MLT_HEADLESS)
+        // Without the windowed front end, every render is headless.
+        isHeadless = true;
+#endif
         if (!enabledMutationsString.empty())
             enabledMutations =
                 getEnabledMutationsFromString(enabledMutationsString);
+        if (!integratorString.empty())
+            integrator = getIntegratorFromString(integratorString);
+        loadOptions.detectAnalyticShapes = !disableAnalyticShapes;
+        if (!sceneCacheDirectory.empty())
+            loadOptions.cacheDirectory = sceneCacheDirectory;
+        if (!liveBufferPath.empty())
+            runOptions.liveBufferPath = liveBufferPath;
+        if (!hdrFormatString.empty())
+            runOptions.hdrExtension = getHdrExtensionFromString(hdrFormatString);
+        if (!resolutionString.empty())
+            resolution = getResolutionFromString(resolutionString);
+        if (!cropString.empty())
+            crop = getCropWindowFromString(cropString, resolution);
+        if (timeBudgetSeconds > 0.0)
+            renderLimits.timeBudget = std::chrono::duration<double>(timeBudgetSeconds);
+        if (relativeErrorTarget > 0.0)
+            renderLimits.relativeErrorTarget = relativeErrorTarget;
+        if (!captureRaysPath.empty() && !isHeadless)
+            throw std::runtime_error("--capture-rays requires --headless");
+        if (tileSize < 0 || (tileSize > 0 && !isHeadless))
+            throw std::runtime_error("--tile-size requires --headless and a positive size");
+        if (tileSize > 0 && crop)
+            throw std::runtime_error("--crop cannot be combined with --tile-size");
+        if (!cameraPathFile.empty() && (!isHeadless || tileSize > 0))
+            throw std::runtime_error(
+                "--camera-path requires --headless and cannot be combined with --tile-size");
+        if (fps <= 0.0)
+            throw std::runtime_error("The frame rate must be positive");
+        if (!workerAddressString.empty()) {
+            workerAddress = getNetworkAddressFromString(workerAddressString);
+            if (!isHeadless || tileSize > 0 || !cameraPathFile.empty())
+                throw std::runtime_error("--worker requires --headless and cannot be "
+                    "combined with --tile-size or --camera-path");
+        }
+        if (reportIntervalSeconds <= 0.0)
+            throw std::runtime_error("The report interval must be positive");
     } catch (const std::exception& err) {
         std::cerr << err.what() << std::endl;
         std::cerr << parser;
@@ -113,25 +536,125 @@ int main(int argc, const char* argv[]) {
     }
 
     Camera camera(
-        512, 384, 45.0f, 0.032f,
+        resolution.width, resolution.height, 45.0f, 0.032f,
         Vec3(0.0f, 0.0f, 1.5f),
         Vec3(0.0f, 0.0f, -1.0f),
         Vec3(0.0f, 1.0f, 0.0f));
     Scene scene(camera);
-    bool isSceneLoaded = scene.loadGltf(glbFile);
-    if (!isSceneLoaded)
-        std::exit(1);
+    StartupReport startupReport;
+    {
+        PhaseTimer timer(&startupReport, "scene load");
+        std::optional<ThreadPool> loadingPool;
+        if (numJobs > 1) {
+            loadingPool.emplace(numJobs);
+            loadOptions.pool = &loadingPool.value();
+        }
+        loadOptions.report = &startupReport;
+        bool isSceneLoaded = scene.load(sceneFile, loadOptions);
+        loadOptions.pool = nullptr;
+        loadOptions.report = nullptr;
+        if (!isSceneLoaded)
+            std::exit(1);
+    }
+
+    const auto reportStartup = [&](const IRenderer& renderer) {
+        scene.addMemoryUsage(startupReport);
+        renderer.addMemoryUsage(startupReport);
+        startupReport.print();
+        if (!startupReportPath.empty())
+            startupReport.writeJson(startupReportPath);
+    };
+    runOptions.numJobs = numJobs;
 
-    Window window(512, 384, WindowTitleMLT);
+    std::optional<CameraPath> cameraPath;
+    if (!cameraPathFile.empty()) {
+        cameraPath = CameraPath::load(cameraPathFile);
+        if (!cameraPath)
+            std::exit(1);
+        std::println(
+            "Loaded {} camera keyframes from {:.3f}s to {:.3f}s",
+            cameraPath->numKeyframes(), cameraPath->startTime(), cameraPath->endTime());
+    }
+
+    std::optional<RenderFarm::Worker> worker;
+    if (workerAddress) {
+        const RenderFarm::Job job{
+            .sceneHash = scene.geometryHash(),
+            .renderer = usePathTracer
+                ? RenderFarm::Renderer::PathTracer : RenderFarm::Renderer::MLT};
+        worker = RenderFarm::Worker::connect(
+            workerAddress->host, workerAddress->port, job);
+        if (!worker)
+            std::exit(1);
+    }
+
+    if (isHeadless) {
+        const auto render = [&](IRenderer& renderer) {
+            renderer.setCrop(crop);
+            reportStartup(renderer);
+            if (!captureRaysPath.empty())
+                RayCapture::start(std::max(captureLimit, 0));
+            bool isSaved = true;
+            if (tileSize > 0) {
+                isSaved = renderTiled(
+                    renderer, scene, runOptions, renderLimits, tileSize, outputPath);
+            } else if (cameraPath) {
+                renderAnimation(
+                    renderer, scene, runOptions, renderLimits, *cameraPath, fps,
+                    outputPath);
+            } else if (worker) {
+                isSaved = renderWorker(
+                    renderer, scene, runOptions, renderLimits, *worker,
+                    std::chrono::duration<double>(reportIntervalSeconds));
+            } else {
+                renderHeadless(renderer, scene, runOptions, renderLimits, outputPath);
+            }
+            if (!captureRaysPath.empty()) {
+                const std::vector<RayCapture::Record> rays = RayCapture::stop();
+                std::println("Captured {} rays to {}", rays.size(), captureRaysPath);
+                if (!RayCapture::write(captureRaysPath, rays))
+                    std::exit(1);
+            }
+            if (!isSaved)
+                std::exit(1);
+        };
+        // In tiled mode the renderer's buffers only cover one tile.
+        const int bufferWidth = tileSize > 0 ? tileSize : resolution.width;
+        const int bufferHeight = tileSize > 0 ? tileSize : resolution.height;
+        if (usePathTracer) {
+            PathTracer pathTracer(bufferWidth, bufferHeight, integrator);
+            render(pathTracer);
+        } else {
+            MLT mlt(enabledMutations, bufferWidth, bufferHeight, numJobs);
+            mlt.setWarmStart(warmStart && cameraPath.has_value());
+            render(mlt);
+        }
+        return 0;
+    }
+
+#if !defined(MLT_HEADLESS)
+    PhaseTimer windowTimer(&startupReport, "window setup");
+    Window window(resolution.width, resolution.height, WindowTitleMLT);
     GraphicsContext graphicsContext(window);
     Application application(window, graphicsContext, scene);
+    windowTimer.stop();
+    std::optional<SceneWatcher> sceneWatcher;
+    if (watchSceneFile) {
+        sceneWatcher.emplace(sceneFile, loadOptions, scene, numJobs);
+        runOptions.sceneWatcher = &sceneWatcher.value();
+    }
     if (usePathTracer) {
         window.setTitle(WindowTitlePathTracer);
-        PathTracer pathTracer(window.width(), window.height());
-        application.run(pathTracer, numJobs);
+        PathTracer pathTracer(window.width(), window.height(), integrator);
+        pathTracer.setCrop(crop);
+        reportStartup(pathTracer);
+        application.run(pathTracer, runOptions);
     } else {
         constexpr MLT::EnabledMutations DefaultConfig;
         MLT mlt(enabledMutations, window.width(), window.height(), numJobs);
-        application.run(mlt, numJobs);
+        mlt.setCrop(crop);
+        reportStartup(mlt);
+        application.run(mlt, runOptions);
     }
+#endif
 }
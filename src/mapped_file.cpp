@@ -0,0 +1,105 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#include "mapped_file.h"
+
+#include <cstdio>
+#include <print>
+#include <utility>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "tracy/Tracy.hpp"
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        _data = std::exchange(other._data, nullptr);
+        _size = std::exchange(other._size, 0);
+#if defined(_WIN32)
+        _file = std::exchange(other._file, nullptr);
+        _mapping = std::exchange(other._mapping, nullptr);
+#endif
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::filesystem::path& fileName) {
+    ZoneScoped;
+    ZoneTextF("fileName=%s", fileName.string().c_str());
+    close();
+#if defined(_WIN32)
+    _file = CreateFileW(
+        fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (_file == INVALID_HANDLE_VALUE) {
+        _file = nullptr;
+        std::println(stderr, "Unable to open {}", fileName.string());
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(_file, &size) && size.QuadPart > 0) {
+        _size = static_cast<std::size_t>(size.QuadPart);
+        _mapping = CreateFileMappingW(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (_mapping)
+            _data = MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+    }
+#else
+    const int file = ::open(fileName.c_str(), O_RDONLY);
+    if (file < 0) {
+        std::println(stderr, "Unable to open {}", fileName.string());
+        return false;
+    }
+    struct stat status;
+    if (fstat(file, &status) == 0 && status.st_size > 0) {
+        _size = static_cast<std::size_t>(status.st_size);
+        void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (data != MAP_FAILED)
+            _data = data;
+    }
+    // The mapping stays valid after the descriptor is closed.
+    ::close(file);
+#endif
+    if (!_data) {
+        std::println(stderr, "Unable to map {}", fileName.string());
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+#if defined(_WIN32)
+    if (_data)
+        UnmapViewOfFile(_data);
+    if (_mapping)
+        CloseHandle(_mapping);
+    if (_file)
+        CloseHandle(_file);
+    _mapping = nullptr;
+    _file = nullptr;
+#else
+    if (_data)
+        munmap(_data, _size);
+#endif
+    _data = nullptr;
+    _size = 0;
+}
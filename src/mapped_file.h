@@ -0,0 +1,39 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+/// Read-only memory mapping of a whole file.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    /// Maps `fileName`, replacing any previous mapping. Returns false, after
+    /// printing the reason, if that fails.
+    bool open(const std::filesystem::path& fileName);
+    void close();
+
+    [[nodiscard]] bool isOpen() const { return _data != nullptr; }
+    [[nodiscard]] std::span<const std::byte> bytes() const {
+        return {static_cast<const std::byte*>(_data), _size};
+    }
+
+private:
+    void* _data = nullptr;
+    std::size_t _size = 0;
+#if defined(_WIN32)
+    void* _file = nullptr;
+    void* _mapping = nullptr;
+#endif
+};
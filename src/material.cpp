@@ -105,7 +105,8 @@ Vec3 Material::bsdf(const Path::Vertex& vertex) const {
     Vec3 result = _data.baseColorFactor.xyz() / PI;
     if(_data.baseColorTextureIdx) {
         result *= _scene.sampleTexture(
-            *_data.baseColorTextureIdx, vertex.textureCoord);
+            *_data.baseColorTextureIdx, vertex.textureCoord,
+            vertex.textureFootprint);
     }
     return result;
 }
@@ -116,7 +117,8 @@ Vec3 Material::expectedContribution(const Path::Vertex& vertex, const Vec3& inDi
         baseColor *= _data.baseColorFactor.xyz();
         if (_data.baseColorTextureIdx)
             baseColor *= _scene.sampleTexture(
-                    *_data.baseColorTextureIdx, vertex.textureCoord);
+                    *_data.baseColorTextureIdx, vertex.textureCoord,
+                    vertex.textureFootprint);
     }
     // Refractive materials are always white for now.
     return baseColor;
@@ -126,7 +128,8 @@ Vec3 Material::emission(const Path::Vertex& vertex) const {
     Vec3 emission = _data.emissiveFactor * _data.emissiveStrength;
     if (emission != Vec3(0.0f) && _data.emissiveTextureIdx)
         emission *= _scene.sampleTexture(
-            *_data.emissiveTextureIdx, vertex.textureCoord);
+            *_data.emissiveTextureIdx, vertex.textureCoord,
+            vertex.textureFootprint);
     return emission;
 }
 
@@ -3,17 +3,130 @@
 // information.
 
 #include "mesh.h"
+
+#include <algorithm>
+
 #include "image.h"
 
 void Mesh::addPrimitive(
         std::size_t startIdx, std::size_t count,
-        std::optional<std::size_t> materialIdx) {
-    primitives.emplace_back(
-        startIdx, count, materialIdx, BVH(*this, startIdx, count));
+        std::optional<std::size_t> materialIdx,
+        const std::optional<BVH::AnalyticShape>& shape) {
+    if (shape) {
+        primitives.emplace_back(
+            startIdx, count, materialIdx, BVH(*this, startIdx, count, *shape));
+    } else {
+        primitives.emplace_back(
+            startIdx, count, materialIdx, BVH(*this, startIdx, count));
+    }
+}
+
+void Mesh::addPrimitive(
+        std::size_t startIdx, std::size_t count,
+        std::optional<std::size_t> materialIdx, BVH bvh) {
+    primitives.emplace_back(startIdx, count, materialIdx, std::move(bvh));
 }
 
 float Mesh::Triangle::computeArea() const {
     const Vec3 edge1 = positions[1] - positions[0];
     const Vec3 edge2 = positions[2] - positions[0];
-    return length(cross(edge1, edge2));
+    return 0.5f * length(cross(edge1, edge2));
+}
+
+std::optional<Quad> Mesh::findQuad(
+        std::size_t startIdx, std::size_t count) const {
+    if (count != 2)
+        return std::nullopt;
+    const Triangle& first = triangles[startIdx];
+    const Triangle& second = triangles[startIdx + 1];
+
+    // Tolerances are relative to the size of the first triangle.
+    constexpr float RelativeTolerance = 1e-3f;
+    float scale = 0.0f;
+    for (int i = 0; i < 3; ++i)
+        scale = std::max(scale, length(
+            first.positions[(i + 1) % 3] - first.positions[i]));
+    const float tolerance = RelativeTolerance * scale;
+
+    // Match up the vertices shared by both triangles.
+    std::array<std::optional<int>, 3> matches;
+    std::array<bool, 3> isSecondMatched{};
+    int numShared = 0;
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            if (!isSecondMatched[j] &&
+                    length(first.positions[i] - second.positions[j]) <= tolerance) {
+                matches[i] = j;
+                isSecondMatched[j] = true;
+                ++numShared;
+                break;
+            }
+        }
+    }
+    if (numShared != 2)
+        return std::nullopt;
+
+    // The unshared vertices are opposite corners of the rectangle.
+    const int firstCornerIdx = static_cast<int>(
+        std::find(matches.begin(), matches.end(), std::nullopt) - matches.begin());
+    const int secondCornerIdx = static_cast<int>(
+        std::find(isSecondMatched.begin(), isSecondMatched.end(), false) -
+        isSecondMatched.begin());
+
+    const Vec3 corner = first.positions[firstCornerIdx];
+    const Vec3 edge0 = first.positions[(firstCornerIdx + 1) % 3] - corner;
+    const Vec3 edge1 = first.positions[(firstCornerIdx + 2) % 3] - corner;
+    if (std::abs(dot(edge0, edge1)) > RelativeTolerance * length(edge0) * length(edge1))
+        return std::nullopt; // Not a right angle.
+    if (length(corner + edge0 + edge1 - second.positions[secondCornerIdx]) > tolerance)
+        return std::nullopt;
+    return Quad{corner, edge0, edge1};
+}
+
+std::optional<Sphere> Mesh::findSphere(
+        std::size_t startIdx, std::size_t count) const {
+    // Coarser tessellations are more likely meant to look faceted.
+    constexpr std::size_t MinNumTriangles = 32;
+    constexpr float RadiusTolerance = 1e-3f;
+    constexpr float ExtentTolerance = 2e-2f;
+    constexpr float AreaTolerance = 5e-2f;
+    constexpr float MinNormalAlignment = 0.99f;
+    if (count < MinNumTriangles)
+        return std::nullopt;
+
+    AABB bounds;
+    for (std::size_t i = startIdx; i < startIdx + count; ++i)
+        for (const Vec3& position : triangles[i].positions)
+            bounds.fit(position);
+    const Vec3 center = bounds.getMin() + 0.5f * bounds.getSize();
+
+    // Every vertex must be at the same distance from the center, so the
+    // extent of the bounds along each axis is close to the diameter.
+    const float radius = length(triangles[startIdx].positions[0] - center);
+    if (!(radius > 0.0f))
+        return std::nullopt;
+    for (int axis = 0; axis < 3; ++axis) {
+        if (std::abs(bounds.getSize(axis) - 2.0f * radius) > ExtentTolerance * radius)
+            return std::nullopt;
+    }
+
+    float totalArea = 0.0f;
+    for (std::size_t i = startIdx; i < startIdx + count; ++i) {
+        const Triangle& triangle = triangles[i];
+        for (int j = 0; j < 3; ++j) {
+            const Vec3 offset = triangle.positions[j] - center;
+            const float distance = length(offset);
+            if (std::abs(distance - radius) > RadiusTolerance * radius)
+                return std::nullopt;
+            if (dot(normalize(triangle.normals[j]), offset / distance) < MinNormalAlignment)
+                return std::nullopt;
+        }
+        totalArea += triangle.computeArea();
+    }
+
+    // Rules out open shapes such as hemispheres.
+    const Sphere sphere{center, radius};
+    if (std::abs(totalArea - sphere.area()) > AreaTolerance * sphere.area())
+        return std::nullopt;
+    return sphere;
 }
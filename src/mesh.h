@@ -11,6 +11,7 @@
 
 #include "bvh.h"
 #include "image.h"
+#include "shapes.h"
 #include "types.h"
 #include "random.h"
 
@@ -29,6 +30,18 @@ struct Mesh {
         std::optional<std::size_t> materialIdx;
         BVH bvh;
         float totalArea;
+        /// Set if the primitive is a rectangle made of two triangles.
+        std::optional<Quad> quad;
+        /// Hash of the primitive's triangles and of everything else its BVH
+        /// depends on. A reloaded primitive with the same hash reuses the
+        /// BVH instead of building it again.
+        std::uint64_t geometryHash = 0;
+
+        /// The sphere replacing this primitive's triangles during
+        /// intersection, if any.
+        const Sphere* sphere() const {
+            return bvh.shape ? std::get_if<Sphere>(&*bvh.shape) : nullptr;
+        }
     };
 
     std::string name;
@@ -39,7 +52,24 @@ struct Mesh {
     mutable std::vector<std::discrete_distribution<PCG32::Generator::result_type>>
         primitiveTriangleDistibutions;
 
+    /// Adds a primitive and builds its BVH. If `shape` is given, the
+    /// primitive is intersected analytically rather than by its triangles.
+    void addPrimitive(
+        std::size_t startIdx, std::size_t count,
+        std::optional<std::size_t> materialIdx,
+        const std::optional<BVH::AnalyticShape>& shape = std::nullopt);
+
+    /// Adds a primitive whose BVH has already been built over its triangles.
     void addPrimitive(
         std::size_t startIdx, std::size_t count,
-        std::optional<std::size_t> materialIdx);
+        std::optional<std::size_t> materialIdx, BVH bvh);
+
+    /// Checks whether the `count` triangles starting at `startIdx` form a
+    /// rectangle, which is the case for two triangles sharing a diagonal.
+    std::optional<Quad> findQuad(std::size_t startIdx, std::size_t count) const;
+
+    /// Checks whether the `count` triangles starting at `startIdx` tessellate
+    /// a sphere: every vertex lies on it with a radial normal, and together
+    /// they cover close to its full area.
+    std::optional<Sphere> findSphere(std::size_t startIdx, std::size_t count) const;
 };
@@ -9,8 +9,11 @@
 #include "tracy/Tracy.hpp"
 
 #include "distribution_geometric_clipped.h"
+#include "hash.h"
+#include "image_metrics.h"
 #include "path.h"
 #include "random.h"
+#include "render_stats.h"
 
 namespace {
 
@@ -20,11 +23,18 @@ std::pair<int, int> clampPixel(const Vec2& pixel, const Image& image) {
     return {x, y};
 }
 
-std::tuple<Vec2, Ray> randomEyeRay(const Scene& scene) {
+/// Chains keep their pixel in the coordinates of the accumulation buffer,
+/// which covers the camera image from `offset` on.
+Ray filmEyeRay(const Scene& scene, const Vec2& pixel, FilmOffset offset) {
+    return scene.eyeRay(pixel + Vec2(offset.x, offset.y));
+}
+
+std::tuple<Vec2, Ray> randomEyeRay(
+        const Scene& scene, const CropWindow& region, FilmOffset offset) {
     const Vec2 pixel(
-        PCG32::rand() * scene.camera.width,
-        PCG32::rand() * scene.camera.height);
-    return {pixel, scene.eyeRay(pixel)};
+        region.x + PCG32::rand() * region.width,
+        region.y + PCG32::rand() * region.height);
+    return {pixel, filmEyeRay(scene, pixel, offset)};
 }
 
 float luminance(const Vec3& color) {
@@ -64,8 +74,9 @@ float invGeometryTerm(const Path::Vertex& a, const Path::Vertex& b) {
 
 } // namespace
 
-MLTProcess::MLTProcess(const MLT& renderer, int width, int height) 
-        : _renderer(renderer), _accumulationBuffer(width, height, 3),
+MLTProcess::MLTProcess(
+        const MLT& renderer, int width, int height, std::size_t index)
+        : _renderer(renderer), _index(index), _accumulationBuffer(width, height, 3),
           _mutationDistribution{
                 1.0  * _renderer.getConfig().newPathMutation,
                 1.0  * _renderer.getConfig().lensPerturbation,
@@ -115,7 +126,8 @@ std::optional<MLTProcess::MutationInfo> MLTProcess::bidirectionalMutation(
         // If the first vertex we are deleting in the path is at index 1, it is
         // the point of contact of the eye ray, so when we delete that, we need
         // to create a new eye ray.
-        auto [pixel, newRay] = randomEyeRay(scene);
+        auto [pixel, newRay] = randomEyeRay(
+            scene, region(), _renderer.filmOffset());
         ray = newRay;
         info.proposal.pixel = pixel;
     } else {
@@ -182,18 +194,16 @@ std::optional<MLTProcess::MutationInfo> MLTProcess::eyePathPerturbation(
         return std::nullopt;
 
     const int width = _accumulationBuffer.width();
-    const int height = _accumulationBuffer.height();
+    const CropWindow region = this->region();
     const Vec2 newPixel = _currentState->pixel + pixelOffset(0.1f, 0.1f * width);
-    if (newPixel.x > width || newPixel.x < 0 ||
-        newPixel.y > height || newPixel.y < 0) return std::nullopt;
+    if (newPixel.x > region.x + region.width || newPixel.x < region.x ||
+        newPixel.y > region.y + region.height || newPixel.y < region.y) return std::nullopt;
     
-    std::optional<Ray> nextRay = scene.eyeRay(newPixel);
+    std::optional<Ray> nextRay = filmEyeRay(scene, newPixel, _renderer.filmOffset());
 
     MutationInfo info{
         .proposal = {
-            .path = Path(Path::Vertex{
-                .bounceType = Path::Vertex::BounceType::None,
-                .position = nextRay->o}),
+            .path = Path(Path::createEyeVertex(scene, *nextRay)),
             .pixel = newPixel},
         .type = multiChain ? MutationInfo::Type::MultiChain : MutationInfo::Type::Lens};
 
@@ -255,7 +265,8 @@ std::optional<MLTProcess::MutationInfo> MLTProcess::computeNewPathMutation(
 
     MutationInfo info = MutationInfo{.type = MutationInfo::Type::NewPath};
     Ray newRay;
-    std::tie(info.proposal.pixel, newRay) = randomEyeRay(scene);
+    std::tie(info.proposal.pixel, newRay) = randomEyeRay(
+        scene, region(), _renderer.filmOffset());
     info.proposal.path = Path::createRandomEyePath(scene, newRay);
     if (info.proposal.path.length() <= 1) {
         ++_numNewPathMutations;
@@ -275,11 +286,9 @@ std::optional<MLTProcess::MutationInfo> MLTProcess::computeNewPathMutation(
     return info;
 }
 
-std::optional<MLTProcess::MutationInfo> MLTProcess::computeRandomMutation(
-        const Scene& scene) {
+std::optional<MLTProcess::MutationInfo> MLTProcess::computeMutation(
+        const Scene& scene, const MutationInfo::Type mutationType) {
     using MutationType = MutationInfo::Type;
-    const auto mutationType =
-        static_cast<MutationType>(_mutationDistribution(PCG32::RandomGenerator));
     switch (mutationType) {
     case MutationType::NewPath:         return computeNewPathMutation(scene);
     case MutationType::Lens:            return eyePathPerturbation(scene, false);
@@ -289,12 +298,25 @@ std::optional<MLTProcess::MutationInfo> MLTProcess::computeRandomMutation(
     return std::nullopt;
 }
 
-void MLTProcess::accumulate(const Scene &scene, const int numMutations) {
+void MLTProcess::accumulate(const Scene &scene, const std::uint64_t numMutations) {
     ZoneScoped;
+    // Tiles mix in their position, which leaves the streams of a whole
+    // image render as they were.
+    const FilmOffset offset = _renderer.filmOffset();
+    PCG32::reseed(
+        ((std::uint64_t{_index} << 32) | _numAccumulations++) ^
+        mixBits((std::uint64_t(offset.y) << 32) | std::uint32_t(offset.x)));
+    std::uint64_t numInitialPaths = 0;
+    std::uint64_t numProposed = 0;
+    std::uint64_t numAccepted = 0;
+    if (_isStateFromPreviousFrame)
+        reconnectToCamera(scene);
     // Set up a valid initial state, loop until we find one.
     while (!_renderer.isStopping() && !_currentState) {
+        ++numInitialPaths;
         // Create a random path and evaluate it.
-        const auto [pixel, ray] = randomEyeRay(scene);
+        const auto [pixel, ray] = randomEyeRay(
+            scene, region(), _renderer.filmOffset());
         const Path path = Path::createRandomEyePath(scene, ray);
         EvaluationResult evaluation = evaluate(scene, path.toSlice());
         const float lum = luminance(evaluation.radiance);
@@ -311,7 +333,12 @@ void MLTProcess::accumulate(const Scene &scene, const int numMutations) {
         currentColor /= luminance(currentColor);
 
         const auto [x, y] = clampPixel(_currentState->pixel, _accumulationBuffer);
-        std::optional<MutationInfo> info = computeRandomMutation(scene);
+        const auto mutationType = static_cast<MutationInfo::Type>(
+            _mutationDistribution(PCG32::RandomGenerator));
+        MutationStats& stats = _mutationStats[static_cast<int>(mutationType)];
+        ++stats.numProposed;
+        ++numProposed;
+        std::optional<MutationInfo> info = computeMutation(scene, mutationType);
         if (!info) {
             _accumulationBuffer.rgb(x, y) += currentColor;
             continue;
@@ -332,19 +359,83 @@ void MLTProcess::accumulate(const Scene &scene, const int numMutations) {
 
         if (PCG32::rand() < info->acceptance) {
             _currentState = std::move(info->proposal);
+            ++stats.numAccepted;
+            ++numAccepted;
         }
     }
 
-    const std::size_t numPixels =
-        _accumulationBuffer.width() * _accumulationBuffer.height();
+    RenderStats::Counters& renderStats = RenderStats::local();
+    RenderStats::add(renderStats.numPaths, numInitialPaths + numProposed);
+    RenderStats::add(renderStats.numMutationsProposed, numProposed);
+    RenderStats::add(renderStats.numMutationsAccepted, numAccepted);
+
+    const CropWindow region = this->region();
+    const std::size_t numPixels = std::size_t(region.width) * region.height;
     _averageSamplesPerPixel += static_cast<float>(numMutations) / numPixels;
 }
 
+void MLTProcess::reconnectToCamera(const Scene& scene) {
+    _isStateFromPreviousFrame = false;
+    const Path& path = _currentState->path;
+    if (path.length() < 2) {
+        _currentState.reset();
+        return;
+    }
+    const Path::Vertex& firstBounce = path.vertex(1);
+    const FilmOffset offset = _renderer.filmOffset();
+    const std::optional<Vec2> filmPixel = scene.camera.project(firstBounce.position);
+    if (!filmPixel) {
+        _currentState.reset();
+        return;
+    }
+    const Vec2 pixel = *filmPixel - Vec2(offset.x, offset.y);
+    const CropWindow region = this->region();
+    if (pixel.x < region.x || pixel.x >= region.x + region.width ||
+            pixel.y < region.y || pixel.y >= region.y + region.height) {
+        _currentState.reset();
+        return;
+    }
+
+    // The bounce must be the first thing the new eye ray hits, and be seen
+    // from the side the path left it on.
+    const Ray ray = filmEyeRay(scene, pixel, offset);
+    const std::optional<Scene::HitInfo> hit = scene.intersect(ray, RayKind::Primary);
+    const float tolerance = 1e-3f * std::max(1.0f, length(firstBounce.position - ray.o));
+    const Material& material = scene.getMaterial(firstBounce.materialIdx);
+    if (!hit || length(hit->position - firstBounce.position) > tolerance ||
+            (material.getType() != Path::Vertex::BounceType::Refractive &&
+                dot(ray.d, firstBounce.geometricNormal) > 0.0f)) {
+        _currentState.reset();
+        return;
+    }
+
+    State state{.path = Path(Path::createEyeVertex(scene, ray)), .pixel = pixel};
+    state.path.appendPath(path.getSlice(1, 2));
+    propagateRayCone(state.path.vertex(0), state.path.last(), hit->textureScale);
+    state.path.appendPath(path.getSlice(2, path.length()));
+    state.evaluation = evaluate(scene, state.path.toSlice());
+    if (luminance(state.evaluation.radiance) > Epsilon)
+        _currentState = std::move(state);
+    else
+        _currentState.reset();
+}
+
+CropWindow MLTProcess::region() const {
+    return _renderer.region();
+}
+
 void MLTProcess::reset() {
+    // The chain may refer to geometry that is gone after a scene reload.
+    if (_renderer.warmStart() && _currentState)
+        _isStateFromPreviousFrame = true;
+    else
+        _currentState.reset();
     _accumulationBuffer.clear();
-    _accumulatedLuminance = 0.0f;
+    _accumulatedLuminance = 0.0;
     _numNewPathMutations = 0;
     _averageSamplesPerPixel = 0;
+    _numAccumulations = 0;
+    _mutationStats = {};
 }
 
 MLT::MLT(const EnabledMutations& config, int width, int height, int numProcesses)
@@ -360,14 +451,16 @@ MLT::MLT(const EnabledMutations& config, int width, int height, int numProcesses
     if (numProcesses < 1)
         numProcesses = 1;
     for (int i = 0; i < numProcesses; ++i) {
-        _processes.emplace_back(*this, width, height);
+        _processes.emplace_back(*this, width, height, i);
     }
 }
 
 void MLT::accumulate(const Scene& scene, int numSamples, ThreadPool* pool) {
     ZoneScoped;
-    const int numMutationsPerProcess =
-        numSamples * _width * _height / _processes.size();
+    // In 64 bits, since large images at many samples overflow an int.
+    const CropWindow region = this->region();
+    const std::uint64_t numMutationsPerProcess =
+        std::uint64_t(numSamples) * region.width * region.height / _processes.size();
     if (pool) {
         for (MLTProcess& process : _processes) {
             pool->assignWork([&, process = &process]() {
@@ -382,25 +475,21 @@ void MLT::accumulate(const Scene& scene, int numSamples, ThreadPool* pool) {
     _averageSamplesPerPixel += numSamples;
 }
 
-void MLT::updateFrameBuffer(Image& frameBuffer) const {
+void MLT::updateFrameBuffer(Image& frameBuffer, ThreadPool* pool) const {
+    ZoneScoped;
+    resolveLinear(frameBuffer, pool);
+    // Final image correction pass
+    frameBuffer.applyCorrection(frameBuffer, 1.0f, pool);
+}
+
+void MLT::resolveLinear(Image& image, ThreadPool* pool) const {
     ZoneScoped;
-    frameBuffer.clear();
+    image.clear();
     // Merge the contents of the different processes' accumulation buffers
     const float scaleFactor = computeScaleFactor();
-    for (const MLTProcess& process : _processes) {
-        for (int y = 0; y < frameBuffer.height(); ++y) {
-            for (int x = 0; x < frameBuffer.width(); ++x) {
-                frameBuffer.rgb(x, y) +=
-                    process.accumulationBuffer().rgb(x, y) * scaleFactor;
-            }
-        }
-    }
-    // Final image correction pass
-    for (int y = 0; y < frameBuffer.height(); ++y) {
-        for (int x = 0; x < frameBuffer.width(); ++x) {
-            frameBuffer.rgb(x, y) = Image::applyCorrection(frameBuffer.rgb(x, y));
-        }
-    }
+    for (const MLTProcess& process : _processes)
+        image.accumulateScaled(
+            process.accumulationBuffer(), scaleFactor, pool);
 }
 
 void MLT::reset() {
@@ -410,9 +499,73 @@ void MLT::reset() {
     _averageSamplesPerPixel = 0;
 }
 
+std::optional<double> MLT::estimateRelativeError() const {
+    ZoneScoped;
+    const std::size_t numProcesses = _processes.size();
+    if (numProcesses < 2 || _averageSamplesPerPixel == 0)
+        return std::nullopt;
+    // Each process alone would estimate the image as its buffer scaled by
+    // the number of processes, and the image is the mean of those.
+    const double scaleFactor = computeScaleFactor();
+    const CropWindow region = this->region();
+    double relativeVarianceSum = 0.0;
+    for (int y = region.y; y < region.y + region.height; ++y) {
+        for (int x = region.x; x < region.x + region.width; ++x) {
+            for (int c = 0; c < 3; ++c) {
+                double sum = 0.0;
+                double squaredSum = 0.0;
+                for (const MLTProcess& process : _processes) {
+                    const double estimate = numProcesses * scaleFactor *
+                        process.accumulationBuffer().rgb(x, y)[c];
+                    sum += estimate;
+                    squaredSum += estimate * estimate;
+                }
+                const double mean = sum / numProcesses;
+                const double variance = std::max(
+                    0.0, (squaredSum - numProcesses * mean * mean) / (numProcesses - 1));
+                relativeVarianceSum +=
+                    variance / numProcesses / (mean * mean + RelativeErrorEpsilon);
+            }
+        }
+    }
+    const double numValues = std::max(3.0 * region.width * region.height, 1.0);
+    return std::sqrt(relativeVarianceSum / numValues);
+}
+
+Accumulation MLT::accumulation() const {
+    Accumulation accumulation{
+        .buffer = Image(_width, _height, 3),
+        .numSamplesPerPixel = static_cast<std::uint64_t>(_averageSamplesPerPixel)};
+    for (const MLTProcess& process : _processes) {
+        accumulation.buffer.accumulateScaled(process.accumulationBuffer(), 1.0f);
+        accumulation.accumulatedLuminance += process.accumulatedLuminance();
+        accumulation.numNewPathMutations += process.numNewPathMutations();
+    }
+    return accumulation;
+}
+
+std::array<MutationStats, MLTProcess::NumMutationTypes> MLT::mutationStats() const {
+    std::array<MutationStats, MLTProcess::NumMutationTypes> stats{};
+    for (const MLTProcess& process : _processes) {
+        for (std::size_t i = 0; i < stats.size(); ++i) {
+            stats[i].numProposed += process.mutationStats()[i].numProposed;
+            stats[i].numAccepted += process.mutationStats()[i].numAccepted;
+        }
+    }
+    return stats;
+}
+
+void MLT::addMemoryUsage(StartupReport& report) const {
+    for (const MLTProcess& process : _processes) {
+        report.addMemory(
+            "accumulation buffers", process.accumulationBuffer().memoryUsage());
+        report.addMemory("MLT process state", process.stateMemoryUsage());
+    }
+}
+
 float MLT::computeScaleFactor() const {
-    float totalAccumulatedLuminance = 0.0f;
-    int totalNumNewPathMutations = 0;
+    double totalAccumulatedLuminance = 0.0;
+    std::uint64_t totalNumNewPathMutations = 0;
     for (const MLTProcess& process : _processes) {
         totalAccumulatedLuminance += process.accumulatedLuminance();
         totalNumNewPathMutations += process.numNewPathMutations();
@@ -4,7 +4,10 @@
 
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <random>
+#include <string_view>
 
 #include "image.h"
 #include "scene.h"
@@ -14,22 +17,42 @@
 
 class MLT;
 
+/// Number of proposals of one kind of mutation and how many were accepted.
+/// Proposals that fail to produce a valid path count as rejected.
+struct MutationStats {
+    std::uint64_t numProposed = 0;
+    std::uint64_t numAccepted = 0;
+};
+
 class MLTProcess {
 public:
-    MLTProcess(const MLT& renderer, int width, int height);
+    static constexpr std::size_t NumMutationTypes = 4;
+
+    /// `index` tells the processes apart when seeding random numbers.
+    MLTProcess(const MLT& renderer, int width, int height, std::size_t index);
 
     MLTProcess(const MLTProcess&) = delete;
     MLTProcess& operator=(const MLTProcess&) = delete;
     MLTProcess(MLTProcess&&) = default;
     MLTProcess& operator=(MLTProcess&&) = delete;
 
-    void accumulate(const Scene& scene, int numMutations);
+    void accumulate(const Scene& scene, std::uint64_t numMutations);
     const Image& accumulationBuffer() const { return _accumulationBuffer; }
-    float accumulatedLuminance() const { return _accumulatedLuminance; }
-    int numNewPathMutations() const { return _numNewPathMutations; }
+    double accumulatedLuminance() const { return _accumulatedLuminance; }
+    std::uint64_t numNewPathMutations() const { return _numNewPathMutations; }
     float averageSamplesPerPixel() const { return _averageSamplesPerPixel; }
+    const std::array<MutationStats, NumMutationTypes>& mutationStats() const {
+        return _mutationStats;
+    }
     void reset();
 
+    /// Bytes used by the chain state and mutation distribution, excluding
+    /// the accumulation buffer.
+    std::size_t stateMemoryUsage() const {
+        return sizeof(*this) +
+            _mutationDistribution.probabilities().size() * sizeof(double);
+    }
+
 private:
     struct State {
         Path path;
@@ -68,15 +91,32 @@ private:
     // based on Russian Roulette.
     std::optional<MutationInfo> computeNewPathMutation(const Scene& scene);
 
-    std::optional<MutationInfo> computeRandomMutation(const Scene& scene);
+    std::optional<MutationInfo> computeMutation(
+        const Scene& scene, MutationInfo::Type type);
+
+    /// Keeps the chain of the previous frame if the new camera still sees
+    /// the first bounce of its path, seen through the pixel it projects to.
+    /// Otherwise the chain starts over.
+    void reconnectToCamera(const Scene& scene);
+
+    /// The crop window, or the whole image. Chains only visit its pixels.
+    CropWindow region() const;
 
     const MLT& _renderer;
+    std::size_t _index;
+    /// Number of calls to `accumulate` since the last reset.
+    std::uint64_t _numAccumulations = 0;
     Image _accumulationBuffer;
-    float _accumulatedLuminance = 0.0f;
-    int _numNewPathMutations = 0;
+    /// Kept in 64 bits, since a float stops growing long before a large
+    /// render ends.
+    double _accumulatedLuminance = 0.0;
+    std::uint64_t _numNewPathMutations = 0;
     float _averageSamplesPerPixel = 0.0f;
     std::optional<State> _currentState;
+    /// The chain was kept through a reset and was found with another camera.
+    bool _isStateFromPreviousFrame = false;
     std::discrete_distribution<> _mutationDistribution;
+    std::array<MutationStats, NumMutationTypes> _mutationStats{};
 };
 
 class MLT : public IRenderer {
@@ -99,12 +139,42 @@ public:
         const Scene& scene,
         int numSamples,
         ThreadPool* pool = nullptr) override;
-    virtual void updateFrameBuffer(Image& frameBuffer) const override; 
+    virtual void updateFrameBuffer(
+        Image& frameBuffer,
+        ThreadPool* pool = nullptr) const override;
+    virtual void resolveLinear(
+        Image& image,
+        ThreadPool* pool = nullptr) const override;
     virtual int numSamplesPerPixel() const override { return _averageSamplesPerPixel; }
+    /// Treats the processes as independent estimates of the image and uses
+    /// the variance between them, so it needs at least two processes. The
+    /// shared scale factor is noisy too, which this does not capture.
+    virtual std::optional<double> estimateRelativeError() const override;
     virtual void reset() override;
+    virtual Accumulation accumulation() const override;
+    virtual void addMemoryUsage(StartupReport& report) const override;
 
     const EnabledMutations& getConfig() const { return _config; }
 
+    /// Keeps the chains through resets, for rendering the frames of an
+    /// animation of a static scene. Each chain continues from its last path
+    /// after the camera moves, if the camera still sees it, instead of
+    /// searching for a new one. Must be off when the scene changes.
+    void setWarmStart(bool warmStart) { _warmStart = warmStart; }
+    bool warmStart() const { return _warmStart; }
+
+    /// Names of the mutation types, in the order of `mutationStats`.
+    static constexpr std::array<std::string_view, MLTProcess::NumMutationTypes>
+        MutationNames{"newPath", "lens", "multiChain", "bidirectional"};
+
+    /// Proposals and acceptances per mutation type, summed over processes.
+    std::array<MutationStats, MLTProcess::NumMutationTypes> mutationStats() const;
+
+    /// The crop window, or the whole image.
+    CropWindow region() const {
+        return _crop.value_or(CropWindow{.width = _width, .height = _height});
+    }
+
 private:
     /// Compute the scaling factor needed to make the histogram approximate the image.
     float computeScaleFactor() const;
@@ -114,4 +184,5 @@ private:
     int _height;
     std::vector<MLTProcess> _processes;
     int _averageSamplesPerPixel = 0;
+    bool _warmStart = false;
 };
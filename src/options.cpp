@@ -0,0 +1,110 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#include "options.h"
+
+#include <algorithm>
+#include <cctype>
+#include <format>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+
+bool matches(const std::string_view token, const std::string_view ref) {
+    if (token.size() > ref.size())
+        return false;
+    for (size_t i = 0; i < token.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(token[i])) !=
+                std::tolower(static_cast<unsigned char>(ref[i])))
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+MLT::EnabledMutations getEnabledMutationsFromString(
+        const std::string& string) {
+    std::stringstream ss(string);
+    std::string token;
+    MLT::EnabledMutations result{};
+    while (std::getline(ss, token, ',')) {
+        if (token.empty())
+            continue;
+        if (matches(token, "newPathMutation"))
+            result.newPathMutation = true;
+        else if (matches(token, "lensPerturbation"))
+            result.lensPerturbation = true;
+        else if (matches(token, "multiChainPerturbation"))
+            result.multiChainPerturbation = true;
+        else if (matches(token, "bidirectionalMutation"))
+            result.bidirectionalMutation = true;
+        else
+            throw std::runtime_error(
+                std::format("Unknown mutation type: {}", token));
+    }
+    return result;
+}
+
+PathTracer::Integrator getIntegratorFromString(const std::string& string) {
+    if (matches(string, "streaming"))
+        return PathTracer::Integrator::Streaming;
+    if (matches(string, "path"))
+        return PathTracer::Integrator::PathBased;
+    throw std::runtime_error(
+        std::format("Unknown path tracer integrator: {}", string));
+}
+
+std::string getHdrExtensionFromString(const std::string& string) {
+    if (matches(string, "exr"))
+        return "exr";
+    if (matches(string, "pfm"))
+        return "pfm";
+    throw std::runtime_error(
+        std::format("Unknown HDR image format: {}", string));
+}
+
+Resolution getResolutionFromString(const std::string& string) {
+    Resolution resolution{};
+    char separator = 0;
+    std::istringstream ss(string);
+    if (!(ss >> resolution.width >> separator >> resolution.height) ||
+            !ss.eof() || std::tolower(separator) != 'x' ||
+            resolution.width <= 0 || resolution.height <= 0)
+        throw std::runtime_error(std::format("Invalid resolution: {}", string));
+    return resolution;
+}
+
+CropWindow getCropWindowFromString(
+        const std::string& string, const Resolution& resolution) {
+    CropWindow crop;
+    char separators[3] = {};
+    std::istringstream ss(string);
+    if (!(ss >> crop.x >> separators[0] >> crop.y >> separators[1] >>
+            crop.width >> separators[2] >> crop.height) || !ss.eof() ||
+            std::ranges::any_of(separators, [](char c) { return c != ','; }) ||
+            crop.x < 0 || crop.y < 0 || crop.width <= 0 || crop.height <= 0 ||
+            crop.x + crop.width > resolution.width ||
+            crop.y + crop.height > resolution.height)
+        throw std::runtime_error(std::format("Invalid crop window: {}", string));
+    crop.y = resolution.height - crop.y - crop.height;
+    return crop;
+}
+
+NetworkAddress getNetworkAddressFromString(const std::string& string) {
+    const std::size_t separator = string.rfind(':');
+    NetworkAddress address;
+    int port = 0;
+    if (separator == std::string::npos || separator == 0 ||
+            separator + 1 == string.size())
+        throw std::runtime_error(std::format("Invalid address: {}", string));
+    std::istringstream ss(string.substr(separator + 1));
+    if (!(ss >> port) || !ss.eof() || port <= 0 || port > 65535)
+        throw std::runtime_error(std::format("Invalid port: {}", string));
+    address.host = string.substr(0, separator);
+    address.port = static_cast<std::uint16_t>(port);
+    return address;
+}
@@ -0,0 +1,45 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "mlt.h"
+#include "path_tracer.h"
+
+// Parsers of command line option values shared by the executables. They
+// throw `std::runtime_error` on invalid values, for the caller to report
+// along with the usage.
+
+/// Parses a comma-separated list of mutation names, each of which may be
+/// abbreviated to a prefix, e.g. "new,lens".
+MLT::EnabledMutations getEnabledMutationsFromString(const std::string& string);
+
+PathTracer::Integrator getIntegratorFromString(const std::string& string);
+
+/// Returns "exr" or "pfm".
+std::string getHdrExtensionFromString(const std::string& string);
+
+struct Resolution {
+    int width;
+    int height;
+};
+
+/// Parses "WIDTHxHEIGHT".
+Resolution getResolutionFromString(const std::string& string);
+
+/// Parses "X,Y,WIDTH,HEIGHT", measured from the top-left corner of an image
+/// of the given resolution as it is saved, into a crop window of the
+/// renderer's buffers, whose rows go from the bottom up.
+CropWindow getCropWindowFromString(const std::string& string, const Resolution& resolution);
+
+struct NetworkAddress {
+    std::string host;
+    std::uint16_t port;
+};
+
+/// Parses "HOST:PORT", where the host is a name or an IPv4 address.
+NetworkAddress getNetworkAddressFromString(const std::string& string);
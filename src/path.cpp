@@ -7,6 +7,7 @@
 #include <random>
 #include <print>
 
+#include "sampling.h"
 #include "scene.h"
 
 namespace {
@@ -23,14 +24,11 @@ std::size_t chooseRandomTriangle(
     return mesh.primitiveTriangleDistibutions[primitiveIdx](PCG32::RandomGenerator);
 }
 
-Path::Vertex chooseRandomVertexOnTriangle(const Mesh::Triangle& triangle) {
-    const float sqrtU1 = std::sqrt(PCG32::rand());
-    const float u2 = PCG32::rand();
-
-    const float alpha = 1 - sqrtU1;
-    const float beta = (1 - u2) * sqrtU1;
-    const float gamma = u2 * sqrtU1;
-
+Path::Vertex vertexAtBarycentrics(
+        const Mesh::Triangle& triangle, const Vec3 barycentrics) {
+    const float alpha = barycentrics.x;
+    const float beta = barycentrics.y;
+    const float gamma = barycentrics.z;
     return Path::Vertex{
         .bounceType = Path::Vertex::BounceType::None,
         .position =
@@ -50,6 +48,36 @@ Path::Vertex chooseRandomVertexOnTriangle(const Mesh::Triangle& triangle) {
             triangle.textureCoords[2] * gamma};
 }
 
+Path::Vertex chooseRandomVertexOnTriangle(const Mesh::Triangle& triangle) {
+    const float sqrtU1 = std::sqrt(PCG32::rand());
+    const float u2 = PCG32::rand();
+
+    const float alpha = 1 - sqrtU1;
+    const float beta = (1 - u2) * sqrtU1;
+    const float gamma = u2 * sqrtU1;
+
+    return vertexAtBarycentrics(triangle, Vec3(alpha, beta, gamma));
+}
+
+/// Projects a sampled point onto the triangle, keeping the barycentric
+/// coordinates inside it despite rounding.
+Path::Vertex vertexClosestToPoint(
+        const Mesh::Triangle& triangle, const Vec3 point) {
+    Vec3 barycentrics = glm::max(
+        computeBarycentrics(triangle.positions, point), Vec3(0.0f));
+    barycentrics /= barycentrics[0] + barycentrics[1] + barycentrics[2];
+    return vertexAtBarycentrics(triangle, barycentrics);
+}
+
+Path::Vertex vertexOnSphere(const Sphere& sphere, const Vec3 position) {
+    const Vec3 normal = normalize(position - sphere.center);
+    return Path::Vertex{
+        .bounceType = Path::Vertex::BounceType::None,
+        .position = position,
+        .normal = normal,
+        .geometricNormal = normal};
+}
+
 Path::Vertex chooseRandomVertexOnLight(const Scene& scene, const std::size_t lightIdx) {
     return std::visit(Visitor{
         [&](const PointLight& light) {
@@ -59,6 +87,14 @@ Path::Vertex chooseRandomVertexOnLight(const Scene& scene, const std::size_t lig
         },
         [&](const MeshLight& light) {
             const Mesh::Primitive& primitive = scene.meshes[light.meshIdx].primitives[light.primitiveIdx];
+            if (const Sphere* sphere = primitive.sphere()) {
+                Path::Vertex vertex = vertexOnSphere(
+                    *sphere, sampleSphereSurface(
+                        *sphere, Vec2(PCG32::rand(), PCG32::rand())));
+                vertex.materialIdx = primitive.materialIdx;
+                vertex.lightIdx = lightIdx;
+                return vertex;
+            }
             const std::size_t triangleIdx = chooseRandomTriangle(scene, light.meshIdx, light.primitiveIdx);
             const Mesh::Triangle& triangle = scene.meshes[light.meshIdx].triangles[triangleIdx];
             Path::Vertex vertex = chooseRandomVertexOnTriangle(triangle);
@@ -74,19 +110,28 @@ Path::Vertex chooseRandomVertexOnLight(const Scene& scene, const std::size_t lig
 
 Path Path::createRandomLightPath(const Scene& scene) {
     Path path;
-    if (scene.lights.empty())
+    std::optional<Vertex> lightVertex = createRandomLightVertex(scene);
+    if (!lightVertex)
         return path;
-    path._path[path._pathLength] =
-        chooseRandomVertexOnLight(scene, chooseRandomLight(scene));
+    path._path[path._pathLength] = *lightVertex;
     ++path._pathLength;
     return path;
 }
 
+std::optional<Path::Vertex> Path::createRandomLightVertex(const Scene& scene) {
+    if (scene.lights.empty())
+        return std::nullopt;
+    return chooseRandomVertexOnLight(scene, chooseRandomLight(scene));
+}
+
 std::optional<Ray> Path::addBounce(
         const Scene& scene,
         const Ray& inRay,
         std::optional<float> terminationProbability) {
-    std::optional<Scene::HitInfo> hit = scene.intersect(inRay);
+    // Only eye paths are extended by bouncing, so a path holding just its
+    // first vertex is at the camera.
+    const RayKind kind = _pathLength == 1 ? RayKind::Primary : RayKind::Secondary;
+    std::optional<Scene::HitInfo> hit = scene.intersect(inRay, kind);
 
     if (!hit)
         return std::nullopt;
@@ -102,6 +147,7 @@ std::optional<Ray> Path::addBounce(
         hit->position,
         hit->normal,
         hit->geometricNormal, hit->textureCoord, hit->materialIdx};
+    propagateRayCone(last(), _path[_pathLength], hit->textureScale);
     ++_pathLength;
 
     if (terminationProbability && PCG32::rand() < *terminationProbability)
@@ -122,13 +168,17 @@ Path::Slice Path::getSlice(std::size_t first, std::size_t last) const {
     return Path::Slice(_path.begin() + first, _path.begin() + last);
 }
 
+Path::Vertex Path::createEyeVertex(const Scene& scene, const Ray& ray) {
+    return Vertex{
+        .bounceType = Path::Vertex::BounceType::None,
+        .position = ray.o,
+        .coneSpread = scene.pixelSpreadAngle()};
+}
+
 Path Path::createRandomEyePath(const Scene& scene, Ray ray) {
     Path p;
-    p._path[0] = Vertex{
-        .bounceType = Path::Vertex::BounceType::None,
-        .position = ray.o
-    };
-    
+    p._path[0] = createEyeVertex(scene, ray);
+
     p._pathLength = 1;
     while (p._pathLength < MaxLength) {
         std::optional<Ray> nextRay = p.addBounce(scene, ray, TerminationProbability);
@@ -140,6 +190,17 @@ Path Path::createRandomEyePath(const Scene& scene, Ray ray) {
     return p;
 }
 
+void propagateRayCone(
+        const Path::Vertex& from, Path::Vertex& to, const float textureScale) {
+    const float spread =
+        from.bounceType == Path::Vertex::BounceType::Diffuse
+            ? Path::DiffuseConeSpread
+            : from.coneSpread;
+    to.coneWidth = from.coneWidth + spread * length(to.position - from.position);
+    to.coneSpread = spread;
+    to.textureFootprint = to.coneWidth * textureScale;
+}
+
 bool hasVisibility(const Scene& scene, const Path::Vertex& v1, const Path::Vertex& v2) {
     Vec3 origin = v1.position + v1.geometricNormal * Epsilon;
     Vec3 dir = v2.position - origin;
@@ -148,7 +209,8 @@ bool hasVisibility(const Scene& scene, const Path::Vertex& v1, const Path::Verte
     if (dot(dir, v1.normal) < Epsilon ||
             (length2(v2.normal) > Epsilon && dot(-dir, v2.normal) < Epsilon))
         return false;
-    return !scene.intersect({origin, dir}, 0.0f, dist - 2 * Epsilon).has_value();
+    return !scene.intersect(
+        {origin, dir}, RayKind::Shadow, 0.0f, dist - 2 * Epsilon).has_value();
 }
 
 EvaluationResult evaluateImplicit(
@@ -213,6 +275,91 @@ Vec3 evaluateExplicitLight(
     return result;
 }
 
+Vec3 sampleExplicitLight(
+        const Scene& scene,
+        const Path::Vertex& x1,
+        const Path::Vertex& x2) {
+    if (scene.lights.empty())
+        return Vec3(0.0f);
+    const std::size_t lightIdx = chooseRandomLight(scene);
+    const auto* meshLight = std::get_if<MeshLight>(&scene.lights[lightIdx]);
+    if (!meshLight) {
+        return evaluateExplicitLight(
+            scene, x1, x2, chooseRandomVertexOnLight(scene, lightIdx));
+    }
+
+    const Mesh& mesh = scene.meshes[meshLight->meshIdx];
+    const Mesh::Primitive& primitive = mesh.primitives[meshLight->primitiveIdx];
+    const Vec2 u(PCG32::rand(), PCG32::rand());
+
+    // Sample a point on the light and find the inverse of its pdf with
+    // respect to solid angle, relative to the light as a whole.
+    std::optional<Path::Vertex> lightVertex;
+    float invPdf = 0.0f;
+    if (const Sphere* sphere = primitive.sphere()) {
+        if (std::optional<SolidAngleSample> sample =
+                sampleSphereCone(*sphere, x2.position, u)) {
+            lightVertex = vertexOnSphere(*sphere, sample->position);
+            invPdf = sample->solidAngle;
+        }
+    } else if (primitive.quad) {
+        if (std::optional<SolidAngleSample> sample =
+                sampleSphericalRectangle(*primitive.quad, x2.position, u)) {
+            // Work out which of the two triangles the sample falls in.
+            const Mesh::Triangle& first = mesh.triangles[primitive.startIdx];
+            const Vec3 barycentrics =
+                computeBarycentrics(first.positions, sample->position);
+            const bool isInFirst = barycentrics[1] >= 0.0f && barycentrics[2] >= 0.0f &&
+                barycentrics[1] + barycentrics[2] <= 1.0f;
+            lightVertex = vertexClosestToPoint(
+                mesh.triangles[primitive.startIdx + (isInFirst ? 0 : 1)],
+                sample->position);
+            invPdf = sample->solidAngle;
+        }
+    } else {
+        const std::size_t triangleIdx = chooseRandomTriangle(
+            scene, meshLight->meshIdx, meshLight->primitiveIdx);
+        const Mesh::Triangle& triangle = mesh.triangles[triangleIdx];
+        if (std::optional<SolidAngleSample> sample =
+                sampleSphericalTriangle(triangle.positions, x2.position, u)) {
+            lightVertex = vertexClosestToPoint(triangle, sample->position);
+            invPdf = sample->solidAngle *
+                primitive.totalArea / mesh.triangleAreas[triangleIdx];
+        } else {
+            // The triangle is too small or distant to be sampled by solid
+            // angle. Sample a point on the same triangle by area, which
+            // together with choosing it by area gives the light's area pdf.
+            // Choosing another triangle instead would bias the estimate.
+            Path::Vertex vertex = chooseRandomVertexOnTriangle(triangle);
+            vertex.materialIdx = primitive.materialIdx;
+            vertex.lightIdx = lightIdx;
+            return evaluateExplicitLight(scene, x1, x2, vertex);
+        }
+    }
+
+    if (!lightVertex) {
+        // The light is too small or distant to be sampled by solid angle.
+        return evaluateExplicitLight(
+            scene, x1, x2, chooseRandomVertexOnLight(scene, lightIdx));
+    }
+    lightVertex->materialIdx = primitive.materialIdx;
+    lightVertex->lightIdx = lightIdx;
+
+    if (!hasVisibility(scene, x2, *lightVertex))
+        return Vec3(0.0f);
+
+    const Vec3 outDir = normalize(lightVertex->position - x2.position);
+    const Material& material = scene.getMaterial(x2.materialIdx);
+    const Material& lightMaterial = scene.getMaterial(lightVertex->materialIdx);
+
+    Vec3 result = material.bsdf(x2);
+    result *= std::max(0.0f, dot(x2.normal, outDir));
+    result *= lightMaterial.emission(*lightVertex);
+    result *= invPdf;
+    result *= scene.lights.size();
+    return result;
+}
+
 Vec3 evaluateExplicit(
         const Scene& scene,
         const Path::Vertex& x1, const Path::Vertex& x2,
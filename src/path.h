@@ -36,15 +36,30 @@ public:
         std::optional<std::size_t> materialIdx;
         /// Only used for explicit vertices.
         std::optional<std::size_t> lightIdx;
+        /// Width and spread angle of the ray cone arriving at this vertex,
+        /// tracked to pick a texture filter size.
+        float coneWidth = 0.0f;
+        float coneSpread = 0.0f;
+        /// Width of the ray cone footprint in texture coordinates.
+        float textureFootprint = 0.0f;
     };
 
     using Slice = std::span<const Vertex>;
 
     Path() : _pathLength(0) {}
     explicit Path(const Vertex &vertex) : _path{vertex}, _pathLength{1} {}
+    /// Spread given to ray cones leaving a diffuse bounce.
+    static constexpr float DiffuseConeSpread = 0.1f;
+
+    /// Creates the camera vertex that an eye path starting with `ray` begins
+    /// with.
+    static Vertex createEyeVertex(const Scene& scene, const Ray& ray);
     /// Creates a random path in the scene originating from `ray`.
     static Path createRandomEyePath(const Scene& scene, Ray ray);
     static Path createRandomLightPath(const Scene& scene);
+    /// Samples a single vertex on a random light, or `std::nullopt` if the
+    /// scene has no lights.
+    static std::optional<Vertex> createRandomLightVertex(const Scene& scene);
     std::optional<Ray> addBounce(
         const Scene& scene,
         const Ray& inRay,
@@ -64,6 +79,11 @@ private:
     std::size_t _pathLength;
 };
 
+/// Grows the ray cone leaving `from` up to `to`, and sets the texture
+/// footprint at `to` given its texture coordinate density.
+void propagateRayCone(
+    const Path::Vertex& from, Path::Vertex& to, float textureScale);
+
 bool hasVisibility(
     const Scene& scene,
     const Path::Vertex& v1, const Path::Vertex& v2);
@@ -82,6 +102,15 @@ Vec3 evaluateExplicitLight(
     const Path::Vertex& x1, const Path::Vertex& x2,
     const Path::Vertex& lightVertex);
 
+/// Samples a point on a random light as seen from `x2` and evaluates the
+/// explicit connection to it. Triangle lights are sampled uniformly by the
+/// solid angle they subtend and rectangular lights by spherical rectangle
+/// sampling, which keeps the noise low close to large emitters. Lights too
+/// small to sample this way fall back to `evaluateExplicitLight`.
+Vec3 sampleExplicitLight(
+    const Scene& scene,
+    const Path::Vertex& x1, const Path::Vertex& x2);
+
 Vec3 evaluateExplicit(
     const Scene& scene,
     const Path::Vertex& x1, const Path::Vertex& x2,
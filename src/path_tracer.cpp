@@ -11,15 +11,18 @@
 
 #include "tracy/Tracy.hpp"
 
+#include "image_metrics.h"
 #include "path.h"
 #include "random.h"
+#include "render_stats.h"
 
 void PathTracer::accumulate(
         const Scene& scene, int numSamples, ThreadPool* pool) {
+    const CropWindow region = this->region();
     if (pool) {
         const std::size_t blockWidth = 32;
-        for (int j = 0; j < _accumulationBuffer.height(); j += blockWidth) {
-            for (int i = 0; i < _accumulationBuffer.width(); i += blockWidth) {
+        for (int j = region.y; j < region.y + region.height; j += blockWidth) {
+            for (int i = region.x; i < region.x + region.width; i += blockWidth) {
                 pool->assignWork([&, i, j]() {
                         accumulateBlock(scene, numSamples, i, j, blockWidth);
                     });
@@ -28,65 +31,176 @@ void PathTracer::accumulate(
         pool->wait();
     } else {
         accumulateBlock(
-            scene, numSamples, 0, 0,
-            std::max(_accumulationBuffer.width(), _accumulationBuffer.height()));
+            scene, numSamples, region.x, region.y,
+            std::max(region.width, region.height));
     }
 
     _numSamplesPerPixel += numSamples;
 }
 
-void PathTracer::updateFrameBuffer(Image& frameBuffer) const {
-    for (int y = 0; y < frameBuffer.height(); ++y) {
-        for (int x = 0; x < frameBuffer.width(); ++x) {
-            frameBuffer.rgb(x, y) = Image::applyCorrection(
-                _accumulationBuffer.rgb(x, y) * (1.0f / _numSamplesPerPixel));
+void PathTracer::updateFrameBuffer(Image& frameBuffer, ThreadPool* pool) const {
+    ZoneScoped;
+    frameBuffer.applyCorrection(
+        _accumulationBuffer, 1.0f / _numSamplesPerPixel, pool);
+}
+
+void PathTracer::resolveLinear(Image& image, ThreadPool* pool) const {
+    ZoneScoped;
+    image.clear();
+    image.accumulateScaled(
+        _accumulationBuffer, 1.0f / _numSamplesPerPixel, pool);
+}
+
+std::optional<double> PathTracer::estimateRelativeError() const {
+    ZoneScoped;
+    const int n = _numSamplesPerPixel;
+    if (n < MinSamplesForErrorEstimate)
+        return std::nullopt;
+    const CropWindow region = this->region();
+    double relativeVarianceSum = 0.0;
+    for (int y = region.y; y < region.y + region.height; ++y) {
+        for (int x = region.x; x < region.x + region.width; ++x) {
+            const Vec3 sum = _accumulationBuffer.rgb(x, y);
+            const Vec3 squaredSum = _squaredAccumulationBuffer.rgb(x, y);
+            for (int c = 0; c < 3; ++c) {
+                const double mean = static_cast<double>(sum[c]) / n;
+                const double sampleVariance = std::max(
+                    0.0, (squaredSum[c] - n * mean * mean) / (n - 1));
+                relativeVarianceSum +=
+                    sampleVariance / n / (mean * mean + RelativeErrorEpsilon);
+            }
         }
     }
+    const double numValues = std::max(3.0 * region.width * region.height, 1.0);
+    return std::sqrt(relativeVarianceSum / numValues);
 }
 
 void PathTracer::accumulateBlock(
         const Scene& scene, int numSamples,
         std::size_t x, std::size_t y, std::size_t blockWidth) {
     ZoneScoped;
-    for (int j = y; j < std::min(_accumulationBuffer.height(), y + blockWidth); ++j) {
-        for (int i = x; i < std::min(_accumulationBuffer.width(), x + blockWidth); ++i) {
+    // Seeded by the position in the camera image, so tiles differ.
+    const std::uint64_t filmX = x + _filmOffset.x;
+    const std::uint64_t filmY = y + _filmOffset.y;
+    PCG32::reseed((filmX << 44) | (filmY << 24) | _numSamplesPerPixel);
+    std::atomic<std::uint64_t>& numPaths = RenderStats::local().numPaths;
+    const CropWindow region = this->region();
+    const std::size_t endX = std::min<std::size_t>(region.x + region.width, x + blockWidth);
+    const std::size_t endY = std::min<std::size_t>(region.y + region.height, y + blockWidth);
+    for (int j = y; j < endY; ++j) {
+        for (int i = x; i < endX; ++i) {
+            RenderStats::add(numPaths, numSamples);
             Vec3 radiance(0.0f);
+            Vec3 squaredRadiance(0.0f);
             for (int k = 0; k < numSamples; ++k) {
                 if(_isStopping) return;
-                const Ray ray = scene.eyeRay(Vec2(i + PCG32::rand(), j + PCG32::rand()));
-                const auto eyePath = Path::createRandomEyePath(scene, ray);
-                const auto lightPath = Path::createRandomLightPath(scene);
-                
-                Vec3 throughput(1.0f);
-                for (std::size_t i = 1;i < eyePath.length(); ++i) {
-                    const Path::Vertex& prevVertex = eyePath.vertex(i-1);
-                    const Path::Vertex& vertex = eyePath.vertex(i);
-
-                    if (i < eyePath.length() - 1 ) {
-                        const Path::Vertex& nextVertex = eyePath.vertex(i+1);
-                        EvaluationResult implicitEvaluation =
-                            evaluateImplicit(scene, prevVertex, vertex, nextVertex);
-                        throughput *= implicitEvaluation.russianRouletteRadiance;
-                    }
-                    
-                    if (vertex.bounceType == Path::Vertex::BounceType::Diffuse &&
-                        lightPath.length() > 0) {
-                        radiance += 0.5f * throughput * evaluateExplicitLight(
-                            scene, prevVertex, vertex, lightPath.vertex(0));
-                    }
-                    
-                    const Material& material = scene.getMaterial(vertex.materialIdx);
-                    radiance += 0.5f * throughput * material.emission(vertex);
-                }
-
+                const Ray ray = scene.eyeRay(Vec2(
+                    _filmOffset.x + i + PCG32::rand(),
+                    _filmOffset.y + j + PCG32::rand()));
+                const Vec3 sample = _integrator == Integrator::Streaming
+                    ? sampleStreaming(scene, ray)
+                    : samplePathBased(scene, ray);
+                radiance += sample;
+                squaredRadiance += sample * sample;
             }
             _accumulationBuffer.rgb(i, j) += radiance;
+            _squaredAccumulationBuffer.rgb(i, j) += squaredRadiance;
+        }
+    }
+}
+
+Vec3 PathTracer::samplePathBased(const Scene& scene, const Ray& ray) const {
+    const auto eyePath = Path::createRandomEyePath(scene, ray);
+
+    Vec3 radiance(0.0f);
+    Vec3 throughput(1.0f);
+    for (std::size_t i = 1;i < eyePath.length(); ++i) {
+        const Path::Vertex& prevVertex = eyePath.vertex(i-1);
+        const Path::Vertex& vertex = eyePath.vertex(i);
+
+        if (i < eyePath.length() - 1 ) {
+            const Path::Vertex& nextVertex = eyePath.vertex(i+1);
+            EvaluationResult implicitEvaluation =
+                evaluateImplicit(scene, prevVertex, vertex, nextVertex);
+            throughput *= implicitEvaluation.russianRouletteRadiance;
+        }
+        
+        if (vertex.bounceType == Path::Vertex::BounceType::Diffuse) {
+            radiance += 0.5f * throughput * sampleExplicitLight(
+                scene, prevVertex, vertex);
         }
+        
+        const Material& material = scene.getMaterial(vertex.materialIdx);
+        radiance += 0.5f * throughput * material.emission(vertex);
     }
+    return radiance;
+}
+
+Vec3 PathTracer::sampleStreaming(const Scene& scene, Ray ray) const {
+    constexpr float ContinuationProbability =
+        1.0f - Path::TerminationProbability;
+
+    Vec3 radiance(0.0f);
+    Vec3 throughput(1.0f);
+
+    // A vertex only scales the throughput by its own reflectance once we know
+    // that the path continues past it, so the light gathered at the most
+    // recent vertex is held back until the next intersection is found.
+    bool hasPendingVertex = false;
+    Vec3 pendingReflectance(1.0f);
+    Vec3 pendingRadiance(0.0f);
+
+    Path::Vertex prevVertex = Path::createEyeVertex(scene, ray);
+    for (std::size_t length = 1; length < Path::MaxLength; ++length) {
+        std::optional<Scene::HitInfo> hit = scene.intersect(
+            ray, length == 1 ? RayKind::Primary : RayKind::Secondary);
+        if (!hit)
+            break;
+
+        if (hasPendingVertex) {
+            throughput *= pendingReflectance;
+            radiance += 0.5f * throughput * pendingRadiance;
+        }
+
+        const Material& material = scene.getMaterial(hit->materialIdx);
+        if (material.getType() != Path::Vertex::BounceType::Refractive &&
+                dot(ray.d, hit->geometricNormal) > 0.0f) {
+            hit->normal *= -1;
+            hit->geometricNormal *= -1;
+        }
+
+        Path::Vertex vertex{
+            Path::Vertex::BounceType::None,
+            hit->position,
+            hit->normal,
+            hit->geometricNormal, hit->textureCoord, hit->materialIdx};
+        propagateRayCone(prevVertex, vertex, hit->textureScale);
+        hasPendingVertex = true;
+        pendingRadiance = material.emission(vertex);
+
+        if (PCG32::rand() < Path::TerminationProbability)
+            break;
+
+        const auto [newRay, bounceType] = material.sampleDirection(-ray.d, vertex);
+        vertex.bounceType = bounceType;
+        if (bounceType == Path::Vertex::BounceType::Diffuse)
+            pendingRadiance += sampleExplicitLight(scene, prevVertex, vertex);
+        pendingReflectance =
+            material.expectedContribution(vertex, -ray.d) / ContinuationProbability;
+
+        prevVertex = vertex;
+        ray = newRay;
+    }
+
+    // The last vertex has nothing after it, so its reflectance is not applied.
+    if (hasPendingVertex)
+        radiance += 0.5f * throughput * pendingRadiance;
+    return radiance;
 }
 
 void PathTracer::reset() {
     IRenderer::reset();
     _accumulationBuffer.clear();
+    _squaredAccumulationBuffer.clear();
     _numSamplesPerPixel = 0;
 }
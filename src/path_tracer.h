@@ -11,16 +11,34 @@
 
 class PathTracer : public IRenderer {
 public:
-    PathTracer(int width, int height)
-        : _accumulationBuffer(width, height, 3) {}
+    enum class Integrator {
+        /// Builds the full eye and light paths, then walks them again to
+        /// evaluate their contribution.
+        PathBased,
+        /// Accumulates throughput and radiance in a single forward pass
+        /// without materializing any `Path` objects.
+        Streaming
+    };
+
+    PathTracer(int width, int height, Integrator integrator = Integrator::Streaming)
+        : _accumulationBuffer(width, height, 3),
+          _squaredAccumulationBuffer(width, height, 3),
+          _integrator(integrator) {}
 
     virtual void accumulate(
         const Scene& scene,
         int numSamples,
         ThreadPool* pool = nullptr) override;
 
-    virtual void updateFrameBuffer(Image& frameBuffer) const override; 
+    virtual void updateFrameBuffer(
+        Image& frameBuffer,
+        ThreadPool* pool = nullptr) const override;
+    virtual void resolveLinear(
+        Image& image,
+        ThreadPool* pool = nullptr) const override;
 
+    /// Accumulates the pixels of the block at `x`, `y` that lie within the
+    /// crop window.
     void accumulateBlock(
         const Scene& scene,
         int numSamples,
@@ -30,9 +48,45 @@ public:
 
     virtual int numSamplesPerPixel() const override { return _numSamplesPerPixel; }
 
+    /// Uses the per-pixel sample variance, once every pixel has
+    /// `MinSamplesForErrorEstimate` samples.
+    virtual std::optional<double> estimateRelativeError() const override;
+
     virtual void reset() override;
 
+    virtual Accumulation accumulation() const override {
+        return {.buffer = _accumulationBuffer,
+                .numSamplesPerPixel = static_cast<std::uint64_t>(_numSamplesPerPixel)};
+    }
+
+    virtual void addMemoryUsage(StartupReport& report) const override {
+        report.addMemory("accumulation buffers", _accumulationBuffer.memoryUsage());
+        report.addMemory(
+            "accumulation buffers", _squaredAccumulationBuffer.memoryUsage());
+    }
+
 private:
+    /// The crop window, or the whole image.
+    CropWindow region() const {
+        return _crop.value_or(CropWindow{
+            .width = static_cast<int>(_accumulationBuffer.width()),
+            .height = static_cast<int>(_accumulationBuffer.height())});
+    }
+
+    /// Fewer samples underestimate the variance of pixels that rarely find
+    /// a bright light.
+    static constexpr int MinSamplesForErrorEstimate = 8;
+
+    /// Estimates the radiance along `ray` by building and evaluating paths.
+    Vec3 samplePathBased(const Scene& scene, const Ray& ray) const;
+
+    /// Estimates the radiance along `ray` in a single pass. This produces the
+    /// same estimate as `samplePathBased`.
+    Vec3 sampleStreaming(const Scene& scene, Ray ray) const;
+
     Image _accumulationBuffer;
+    /// Sum of the squared samples of each pixel, for the variance.
+    Image _squaredAccumulationBuffer;
+    Integrator _integrator;
     int _numSamplesPerPixel = 0;
-};
\ No newline at end of file
+};
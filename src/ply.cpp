@@ -0,0 +1,206 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#include "ply.h"
+
+#include <array>
+#include <print>
+#include <sstream>
+#include <utility>
+
+#include "tracy/Tracy.hpp"
+
+namespace {
+
+std::optional<PlyFile::Type> parseType(std::string_view name) {
+    constexpr std::array<std::pair<std::string_view, PlyFile::Type>, 16> Names{{
+        {"char", PlyFile::Type::Int8}, {"int8", PlyFile::Type::Int8},
+        {"uchar", PlyFile::Type::UInt8}, {"uint8", PlyFile::Type::UInt8},
+        {"short", PlyFile::Type::Int16}, {"int16", PlyFile::Type::Int16},
+        {"ushort", PlyFile::Type::UInt16}, {"uint16", PlyFile::Type::UInt16},
+        {"int", PlyFile::Type::Int32}, {"int32", PlyFile::Type::Int32},
+        {"uint", PlyFile::Type::UInt32}, {"uint32", PlyFile::Type::UInt32},
+        {"float", PlyFile::Type::Float32}, {"float32", PlyFile::Type::Float32},
+        {"double", PlyFile::Type::Float64}, {"float64", PlyFile::Type::Float64},
+    }};
+    for (const auto& [typeName, type] : Names) {
+        if (typeName == name)
+            return type;
+    }
+    return std::nullopt;
+}
+
+} // namespace
+
+std::optional<std::size_t> PlyFile::Element::findProperty(
+        std::string_view name) const {
+    for (std::size_t i = 0; i < properties.size(); ++i) {
+        if (properties[i].name == name)
+            return i;
+    }
+    return std::nullopt;
+}
+
+std::size_t PlyFile::typeSize(const Type type) {
+    switch (type) {
+    case Type::Int8:
+    case Type::UInt8:
+        return 1;
+    case Type::Int16:
+    case Type::UInt16:
+        return 2;
+    case Type::Int32:
+    case Type::UInt32:
+    case Type::Float32:
+        return 4;
+    case Type::Float64:
+        return 8;
+    }
+    return 0;
+}
+
+bool PlyFile::open(const std::filesystem::path& fileName) {
+    ZoneScoped;
+    _elements.clear();
+    if (!_file.open(fileName))
+        return false;
+
+    // The header is ASCII and ends at the first "end_header" line.
+    const std::string_view text(
+        reinterpret_cast<const char*>(begin()), _file.bytes().size());
+    constexpr std::string_view HeaderEnd = "end_header";
+    const std::size_t headerEnd = text.find(HeaderEnd);
+    const std::size_t dataStart = text.find('\n', headerEnd);
+    if (!text.starts_with("ply") || headerEnd == std::string_view::npos ||
+            dataStart == std::string_view::npos) {
+        std::println(stderr, "Failed to load PLY: missing header");
+        return false;
+    }
+
+    std::istringstream header{std::string(text.substr(0, headerEnd))};
+    std::string line;
+    bool hasFormat = false;
+    while (std::getline(header, line)) {
+        std::istringstream words(line);
+        std::string keyword;
+        words >> keyword;
+        if (keyword == "format") {
+            std::string format;
+            words >> format;
+            if (format == "binary_little_endian") {
+                _isByteSwapped = std::endian::native != std::endian::little;
+            } else if (format == "binary_big_endian") {
+                _isByteSwapped = std::endian::native != std::endian::big;
+            } else {
+                std::println(
+                    stderr, "Failed to load PLY: unsupported format={}", format);
+                return false;
+            }
+            hasFormat = true;
+        } else if (keyword == "element") {
+            Element& element = _elements.emplace_back();
+            words >> element.name >> element.count;
+        } else if (keyword == "property") {
+            std::string typeName;
+            words >> typeName;
+            std::optional<Type> countType;
+            if (typeName == "list") {
+                std::string countTypeName;
+                words >> countTypeName >> typeName;
+                countType = parseType(countTypeName);
+                if (!countType || *countType == Type::Float32 ||
+                        *countType == Type::Float64) {
+                    std::println(
+                        stderr, "Failed to load PLY: invalid list count type={}",
+                        countTypeName);
+                    return false;
+                }
+            }
+            const std::optional<Type> type = parseType(typeName);
+            if (!type || _elements.empty()) {
+                std::println(stderr, "Failed to load PLY: invalid property \"{}\"", line);
+                return false;
+            }
+            Property& property = _elements.back().properties.emplace_back();
+            words >> property.name;
+            property.type = *type;
+            property.countType = countType;
+        }
+        // Comments and obj_info lines are ignored.
+    }
+    if (!hasFormat) {
+        std::println(stderr, "Failed to load PLY: missing format");
+        return false;
+    }
+
+    // Lay the elements out one after the other. Elements with lists have to
+    // be walked to find where the next one starts.
+    std::size_t offset = dataStart + 1;
+    for (std::size_t elementIdx = 0; elementIdx < _elements.size(); ++elementIdx) {
+        Element& element = _elements[elementIdx];
+        element.offset = offset;
+        bool hasLists = false;
+        for (Property& property : element.properties) {
+            property.offset = element.stride;
+            element.stride += typeSize(property.type);
+            hasLists |= property.countType.has_value();
+        }
+        if (hasLists) {
+            element.stride = 0;
+            if (elementIdx + 1 == _elements.size())
+                break;
+            const std::byte* data = begin() + offset;
+            List list;
+            for (std::size_t i = 0; i < element.count && data; ++i)
+                data = readInstance(element, data, 0, list);
+            if (!data) {
+                std::println(stderr, "Failed to load PLY: truncated element={}", element.name);
+                return false;
+            }
+            offset = data - begin();
+        } else {
+            if (element.stride > 0 &&
+                    element.count > (_file.bytes().size() - offset) / element.stride) {
+                std::println(stderr, "Failed to load PLY: truncated element={}", element.name);
+                return false;
+            }
+            offset += element.count * element.stride;
+        }
+    }
+    return true;
+}
+
+const PlyFile::Element* PlyFile::findElement(std::string_view name) const {
+    for (const Element& element : _elements) {
+        if (element.name == name)
+            return &element;
+    }
+    return nullptr;
+}
+
+const std::byte* PlyFile::readInstance(
+        const Element& element, const std::byte* data,
+        const std::size_t listIdx, List& list) const {
+    for (std::size_t i = 0; i < element.properties.size(); ++i) {
+        const Property& property = element.properties[i];
+        const std::size_t valueSize = typeSize(property.type);
+        std::size_t size = valueSize;
+        if (property.countType) {
+            const std::size_t countSize = typeSize(*property.countType);
+            if (static_cast<std::size_t>(end() - data) < countSize)
+                return nullptr;
+            const std::size_t count = read<std::size_t>(data, *property.countType);
+            data += countSize;
+            if (i == listIdx)
+                list = List{data, count};
+            if (count > static_cast<std::size_t>(end() - data) / valueSize)
+                return nullptr;
+            size = count * valueSize;
+        }
+        if (static_cast<std::size_t>(end() - data) < size)
+            return nullptr;
+        data += size;
+    }
+    return data;
+}
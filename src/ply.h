@@ -0,0 +1,118 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "mapped_file.h"
+
+/// Binary PLY file. The file is mapped and only its header is parsed up
+/// front; element data is read in place, so callers can split it between
+/// threads.
+class PlyFile {
+public:
+    enum class Type : std::uint8_t {
+        Int8,
+        UInt8,
+        Int16,
+        UInt16,
+        Int32,
+        UInt32,
+        Float32,
+        Float64
+    };
+
+    struct Property {
+        std::string name;
+        Type type;
+        /// Set for list properties, whose values follow a count of this type.
+        std::optional<Type> countType;
+        /// Offset within an instance. Only valid for fixed-size elements.
+        std::size_t offset = 0;
+    };
+
+    struct Element {
+        std::string name;
+        std::size_t count = 0;
+        std::vector<Property> properties;
+        /// Offset of the first instance from the start of the file.
+        std::size_t offset = 0;
+        /// Size of every instance, or zero if the element has lists.
+        std::size_t stride = 0;
+
+        /// Index of the property called `name`, if there is one.
+        std::optional<std::size_t> findProperty(std::string_view name) const;
+    };
+
+    /// Values of a list property within one instance.
+    struct List {
+        const std::byte* data = nullptr;
+        std::size_t size = 0;
+    };
+
+    /// Maps `fileName` and parses its header. Returns false, after printing
+    /// the reason, if the file is not a binary PLY file we can read.
+    bool open(const std::filesystem::path& fileName);
+
+    [[nodiscard]] const std::vector<Element>& elements() const { return _elements; }
+    [[nodiscard]] const Element* findElement(std::string_view name) const;
+
+    [[nodiscard]] const std::byte* begin() const { return _file.bytes().data(); }
+    [[nodiscard]] const std::byte* end() const {
+        return _file.bytes().data() + _file.bytes().size();
+    }
+
+    /// Walks the instance of `element` at `data`, storing the list property
+    /// `listIdx` in `list`. Returns the start of the next instance, or
+    /// nullptr if the instance runs past the end of the file.
+    const std::byte* readInstance(
+        const Element& element, const std::byte* data,
+        std::size_t listIdx, List& list) const;
+
+    static std::size_t typeSize(Type type);
+
+    /// Reads a value of `type` at `data`, converted to `T`.
+    template<typename T>
+    T read(const std::byte* data, Type type) const {
+        switch (type) {
+        case Type::Int8: return static_cast<T>(load<std::int8_t>(data));
+        case Type::UInt8: return static_cast<T>(load<std::uint8_t>(data));
+        case Type::Int16: return static_cast<T>(load<std::int16_t>(data));
+        case Type::UInt16: return static_cast<T>(load<std::uint16_t>(data));
+        case Type::Int32: return static_cast<T>(load<std::int32_t>(data));
+        case Type::UInt32: return static_cast<T>(load<std::uint32_t>(data));
+        case Type::Float32:
+            return static_cast<T>(std::bit_cast<float>(load<std::uint32_t>(data)));
+        case Type::Float64:
+            return static_cast<T>(std::bit_cast<double>(load<std::uint64_t>(data)));
+        }
+        return T{};
+    }
+
+private:
+    template<typename T>
+    T load(const std::byte* data) const {
+        T value;
+        std::memcpy(&value, data, sizeof(T));
+        if constexpr (sizeof(T) > 1) {
+            if (_isByteSwapped)
+                value = std::byteswap(value);
+        }
+        return value;
+    }
+
+    MappedFile _file;
+    /// True if the file's byte order differs from ours.
+    bool _isByteSwapped = false;
+    std::vector<Element> _elements;
+};
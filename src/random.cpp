@@ -4,10 +4,20 @@
 
 #include "random.h"
 
+#include <atomic>
 #include <random>
 
+#include "hash.h"
+
 namespace PCG32 {
 
+namespace {
+
+std::atomic<bool> IsSeeded = false;
+std::atomic<std::uint64_t> Seed = 0;
+
+} // namespace
+
 Generator::result_type Generator::operator()() {
     uint64_t x = mcgState;
     const unsigned count = (unsigned)(x >> 61);
@@ -29,4 +39,16 @@ float rand() {
     return std::generate_canonical<float, 32>(RandomGenerator);
 }
 
+void setSeed(std::uint64_t seed) {
+    Seed = seed;
+    IsSeeded = true;
+}
+
+void reseed(std::uint64_t stream) {
+    if (!IsSeeded.load(std::memory_order_relaxed))
+        return;
+    const std::uint64_t seed = Seed.load(std::memory_order_relaxed);
+    RandomGenerator = Generator(mixBits(seed ^ mixBits(stream)));
+}
+
 } // namespace PCG32
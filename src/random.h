@@ -29,4 +29,14 @@ extern thread_local Generator RandomGenerator;
 std::uint32_t pcg32_fast();
 float rand();
 
+/// Makes the random numbers reproducible. Renderers call `reseed` at the
+/// start of each work item, so the numbers it draws no longer depend on
+/// which thread runs it.
+void setSeed(std::uint64_t seed);
+
+/// Seeds the calling thread's generator from the seed given to `setSeed`
+/// and `stream`, which should identify the work item. Does nothing unless a
+/// seed was set.
+void reseed(std::uint64_t stream);
+
 } // namespace PCG32
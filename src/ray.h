@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <cstdint>
+
 #include "types.h"
 
 struct Ray {
@@ -11,3 +13,15 @@ struct Ray {
     Ray() : o(), d(0.0f, 0.0f, 1.0f) {}
     Ray(Vec3 o, Vec3 d) : o(o), d(d) {}
 };
+
+/// What a ray is traced for. Rays are counted and captured by kind.
+enum class RayKind : std::uint32_t {
+    /// Leaves the camera.
+    Primary,
+    /// Continues a path after a bounce.
+    Secondary,
+    /// Only tests the visibility between two points.
+    Shadow
+};
+
+inline constexpr std::size_t NumRayKinds = 3;
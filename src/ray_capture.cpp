@@ -0,0 +1,119 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#include "ray_capture.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <print>
+
+namespace RayCapture {
+
+namespace {
+
+/// Slots are claimed with a single atomic increment, so capturing needs no
+/// lock. The buffer is allocated up front because it cannot grow while
+/// other threads write into it.
+std::vector<Record> Records;
+std::atomic<std::size_t> NumClaimed = 0;
+
+} // namespace
+
+void start(const std::size_t maxNumRays) {
+    detail::IsActive.store(false);
+    Records.assign(maxNumRays, Record{});
+    NumClaimed.store(0);
+    detail::IsActive.store(true);
+}
+
+void record(
+        const Ray& ray, const RayKind kind,
+        const float minDistance, const float maxDistance) {
+    const std::size_t idx = NumClaimed.fetch_add(1, std::memory_order_relaxed);
+    if (idx >= Records.size()) {
+        detail::IsActive.store(false, std::memory_order_relaxed);
+        return;
+    }
+    Records[idx] = Record{
+        .origin = ray.o,
+        .direction = ray.d,
+        .minDistance = minDistance,
+        .maxDistance = maxDistance,
+        .kind = kind};
+}
+
+std::vector<Record> stop() {
+    detail::IsActive.store(false);
+    std::vector<Record> records = std::move(Records);
+    records.resize(std::min(NumClaimed.load(), records.size()));
+    Records.clear();
+    NumClaimed.store(0);
+    return records;
+}
+
+bool write(const std::filesystem::path& fileName, std::span<const Record> records) {
+    std::ofstream file(fileName, std::ios::binary);
+    const std::uint32_t recordSize = sizeof(Record);
+    const std::uint32_t reserved = 0;
+    const std::uint64_t numRecords = records.size();
+    file.write(FileMagic, sizeof(FileMagic));
+    file.write(reinterpret_cast<const char*>(&recordSize), sizeof(recordSize));
+    file.write(reinterpret_cast<const char*>(&reserved), sizeof(reserved));
+    file.write(reinterpret_cast<const char*>(&numRecords), sizeof(numRecords));
+    file.write(
+        reinterpret_cast<const char*>(records.data()),
+        static_cast<std::streamsize>(records.size_bytes()));
+    if (!file) {
+        std::println(stderr, "Failed to write ray capture: {}", fileName.string());
+        return false;
+    }
+    return true;
+}
+
+std::optional<std::vector<Record>> read(const std::filesystem::path& fileName) {
+    std::ifstream file(fileName, std::ios::binary);
+    char magic[sizeof(FileMagic)] = {};
+    std::uint32_t recordSize = 0;
+    std::uint32_t reserved = 0;
+    std::uint64_t numRecords = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&recordSize), sizeof(recordSize));
+    file.read(reinterpret_cast<char*>(&reserved), sizeof(reserved));
+    file.read(reinterpret_cast<char*>(&numRecords), sizeof(numRecords));
+    if (!file || std::memcmp(magic, FileMagic, sizeof(magic)) != 0 ||
+            recordSize != sizeof(Record)) {
+        std::println(stderr, "Not a ray capture file: {}", fileName.string());
+        return std::nullopt;
+    }
+
+    std::error_code error;
+    const std::uintmax_t fileSize = std::filesystem::file_size(fileName, error);
+    const std::uintmax_t headerSize =
+        sizeof(FileMagic) + sizeof(recordSize) + sizeof(reserved) + sizeof(numRecords);
+    if (error || numRecords > (fileSize - headerSize) / sizeof(Record)) {
+        std::println(stderr, "Truncated ray capture file: {}", fileName.string());
+        return std::nullopt;
+    }
+
+    std::vector<Record> records(numRecords);
+    file.read(
+        reinterpret_cast<char*>(records.data()),
+        static_cast<std::streamsize>(numRecords * sizeof(Record)));
+    if (!file) {
+        std::println(stderr, "Truncated ray capture file: {}", fileName.string());
+        return std::nullopt;
+    }
+    const auto isValidKind = [](const Record& record) {
+        return static_cast<std::size_t>(record.kind) < NumRayKinds;
+    };
+    if (!std::ranges::all_of(records, isValidKind)) {
+        std::println(stderr, "Corrupt ray capture file: {}", fileName.string());
+        return std::nullopt;
+    }
+    return records;
+}
+
+} // namespace RayCapture
@@ -0,0 +1,65 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "ray.h"
+#include "types.h"
+
+/// Records the rays traced through the scene while rendering, so that
+/// MLTKernelBenchmark can replay a real workload against the BVHs.
+///
+/// Capture files start with `FileMagic`, the size of a record as a 32-bit
+/// integer, 32 reserved bits and the number of records as a 64-bit integer,
+/// followed by the records. Everything is in the byte order of the machine
+/// that wrote the file.
+namespace RayCapture {
+
+struct Record {
+    Vec3 origin;
+    Vec3 direction;
+    float minDistance;
+    float maxDistance;
+    RayKind kind;
+};
+static_assert(sizeof(Record) == 36);
+
+inline constexpr char FileMagic[8] = {'M', 'L', 'T', 'R', 'A', 'Y', 'S', '1'};
+
+namespace detail {
+inline std::atomic<bool> IsActive = false;
+} // namespace detail
+
+/// Whether rays are being captured. Cheap enough to check for every ray.
+inline bool isActive() {
+    return detail::IsActive.load(std::memory_order_relaxed);
+}
+
+/// Starts capturing the first `maxNumRays` rays traced from any thread,
+/// discarding the rays of an earlier capture.
+void start(std::size_t maxNumRays);
+
+/// Adds a ray to the capture. Thread-safe; rays past the limit are dropped.
+void record(const Ray& ray, RayKind kind, float minDistance, float maxDistance);
+
+/// Stops capturing and returns the captured rays in the order their slots
+/// were claimed. Must not race with `record`, e.g. call it once rendering
+/// has stopped.
+std::vector<Record> stop();
+
+/// Writes `records` to a capture file. Returns false, after printing the
+/// reason, if the file cannot be written.
+bool write(const std::filesystem::path& fileName, std::span<const Record> records);
+
+/// Reads a capture file, or returns `std::nullopt` after printing the reason.
+std::optional<std::vector<Record>> read(const std::filesystem::path& fileName);
+
+} // namespace RayCapture
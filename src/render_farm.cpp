@@ -0,0 +1,244 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#include "render_farm.h"
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <mutex>
+#include <print>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tracy/Tracy.hpp"
+
+#include "hash.h"
+
+namespace RenderFarm {
+
+namespace {
+
+constexpr int NumChannels = 3;
+/// Rejects updates too large to be a real image, e.g. from another program
+/// connecting to the port.
+constexpr std::uint32_t MaxDimension = 1 << 16;
+
+struct UpdateHeader {
+    char magic[8];
+    std::uint32_t isFinal;
+    std::uint32_t width;
+    std::uint32_t height;
+    Renderer renderer;
+    std::uint64_t sceneHash;
+    std::uint64_t numSamplesPerPixel;
+    double accumulatedLuminance;
+    std::uint64_t numNewPathMutations;
+};
+static_assert(sizeof(UpdateHeader) == 56);
+
+struct AssignmentMessage {
+    char magic[8];
+    std::uint32_t workerIndex;
+    std::uint32_t reserved;
+    std::uint64_t seed;
+};
+static_assert(sizeof(AssignmentMessage) == 24);
+
+template<typename T>
+bool send(Socket& socket, const T& value) {
+    return socket.sendAll(std::as_bytes(std::span(&value, 1)));
+}
+
+template<typename T>
+bool receive(Socket& socket, T& value) {
+    return socket.receiveAll(std::as_writable_bytes(std::span(&value, 1)));
+}
+
+struct Update {
+    Job job;
+    Accumulation accumulation;
+    bool isFinal = false;
+};
+
+/// Receives the next update, or nothing if the connection closed or sent
+/// something else.
+std::optional<Update> receiveUpdate(Socket& socket, std::uint32_t workerIndex) {
+    UpdateHeader header;
+    if (!receive(socket, header))
+        return std::nullopt;
+    if (std::memcmp(header.magic, UpdateMagic, sizeof(UpdateMagic)) != 0 ||
+            header.width == 0 || header.width > MaxDimension ||
+            header.height == 0 || header.height > MaxDimension ||
+            (header.renderer != Renderer::PathTracer &&
+                header.renderer != Renderer::MLT)) {
+        std::println(stderr, "Worker {} sent an invalid update", workerIndex);
+        return std::nullopt;
+    }
+    Update update{
+        .job = {.sceneHash = header.sceneHash, .renderer = header.renderer},
+        .accumulation = {
+            .buffer = Image(header.width, header.height, NumChannels),
+            .numSamplesPerPixel = header.numSamplesPerPixel,
+            .accumulatedLuminance = header.accumulatedLuminance,
+            .numNewPathMutations = header.numNewPathMutations},
+        .isFinal = header.isFinal != 0};
+    Image& buffer = update.accumulation.buffer;
+    const std::span<std::byte> pixels = std::as_writable_bytes(std::span(
+        buffer.pixels(), buffer.width() * buffer.height() * NumChannels));
+    if (!socket.receiveAll(pixels))
+        return std::nullopt;
+    return update;
+}
+
+/// What the first accepted update rendered, which every other update must
+/// match to be merged with it.
+struct Target {
+    Job job;
+    std::size_t width = 0;
+    std::size_t height = 0;
+};
+
+/// Describes how `update` differs from `target`, or returns nothing if it
+/// matches.
+std::optional<std::string> findMismatch(
+        const Update& update, const Target& target) {
+    const Image& buffer = update.accumulation.buffer;
+    if (buffer.width() != target.width || buffer.height() != target.height) {
+        return std::format(
+            "its image is {}x{} instead of {}x{}", buffer.width(), buffer.height(),
+            target.width, target.height);
+    }
+    if (update.job.renderer != target.job.renderer)
+        return "it uses another renderer";
+    if (update.job.sceneHash != target.job.sceneHash)
+        return "it renders another scene";
+    return std::nullopt;
+}
+
+} // namespace
+
+std::optional<Worker> Worker::connect(
+        const std::string& host, std::uint16_t port, const Job& job) {
+    std::optional<Socket> socket = Socket::connect(host, port);
+    if (!socket)
+        return std::nullopt;
+    AssignmentMessage message;
+    if (!receive(*socket, message) ||
+            std::memcmp(message.magic, AssignmentMagic, sizeof(AssignmentMagic)) != 0) {
+        std::println(stderr, "{}:{} is not a render coordinator", host, port);
+        return std::nullopt;
+    }
+    return Worker(
+        std::move(*socket), job,
+        Assignment{.workerIndex = message.workerIndex, .seed = message.seed});
+}
+
+bool Worker::sendUpdate(const Accumulation& accumulation, bool isFinal) {
+    ZoneScoped;
+    const Image& buffer = accumulation.buffer;
+    UpdateHeader header{
+        .isFinal = isFinal,
+        .width = static_cast<std::uint32_t>(buffer.width()),
+        .height = static_cast<std::uint32_t>(buffer.height()),
+        .renderer = _job.renderer,
+        .sceneHash = _job.sceneHash,
+        .numSamplesPerPixel = accumulation.numSamplesPerPixel,
+        .accumulatedLuminance = accumulation.accumulatedLuminance,
+        .numNewPathMutations = accumulation.numNewPathMutations};
+    std::memcpy(header.magic, UpdateMagic, sizeof(UpdateMagic));
+    const std::span<const std::byte> pixels = std::as_bytes(std::span(
+        buffer.pixels(), buffer.width() * buffer.height() * NumChannels));
+    if (!send(_socket, header) || !_socket.sendAll(pixels)) {
+        std::println(stderr, "Lost the connection to the coordinator");
+        return false;
+    }
+    return true;
+}
+
+std::optional<Accumulation> coordinate(
+        Socket& listener, int numWorkers, std::uint64_t seed,
+        std::chrono::milliseconds connectTimeout,
+        std::chrono::milliseconds updateTimeout) {
+    const auto connectDeadline = std::chrono::steady_clock::now() + connectTimeout;
+    std::mutex mutex;
+    std::vector<std::optional<Accumulation>> latest(numWorkers);
+    std::optional<Target> target;
+    std::vector<std::thread> receivers;
+    // Every worker is served as soon as it connects, so early workers are
+    // not blocked on a full connection while the others start.
+    for (int workerIdx = 0; workerIdx < numWorkers; ++workerIdx) {
+        const auto remainingTime = std::max(
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                connectDeadline - std::chrono::steady_clock::now()),
+            std::chrono::milliseconds(0));
+        std::optional<Socket> connection = listener.accept(remainingTime);
+        if (!connection) {
+            std::println(
+                stderr, "Stopped waiting for workers with {} of {} connected",
+                workerIdx, numWorkers);
+            break;
+        }
+        const auto index = static_cast<std::uint32_t>(workerIdx);
+        AssignmentMessage message{
+            .workerIndex = index, .reserved = 0, .seed = mixBits(seed ^ mixBits(index))};
+        std::memcpy(message.magic, AssignmentMagic, sizeof(AssignmentMagic));
+        if (!connection->setReceiveTimeout(updateTimeout) ||
+                !send(*connection, message)) {
+            std::println(stderr, "Worker {} disconnected before starting", index);
+            continue;
+        }
+        std::println("Worker {} connected", index);
+        receivers.emplace_back([&, index, socket = std::move(*connection)]() mutable {
+            while (true) {
+                std::optional<Update> update = receiveUpdate(socket, index);
+                if (!update) {
+                    std::lock_guard lock(mutex);
+                    const std::uint64_t numSamples = latest[index]
+                        ? latest[index]->numSamplesPerPixel : 0;
+                    std::println(
+                        stderr, "Worker {} disconnected or stopped reporting; "
+                        "keeping its last {} samples per pixel", index, numSamples);
+                    return;
+                }
+                std::lock_guard lock(mutex);
+                if (!target) {
+                    target = Target{
+                        .job = update->job,
+                        .width = update->accumulation.buffer.width(),
+                        .height = update->accumulation.buffer.height()};
+                } else if (const std::optional<std::string> mismatch =
+                        findMismatch(*update, *target)) {
+                    std::println(
+                        stderr, "Rejecting worker {}, as {}", index, *mismatch);
+                    return;
+                }
+                std::println(
+                    "Worker {} at {} samples per pixel{}", index,
+                    update->accumulation.numSamplesPerPixel,
+                    update->isFinal ? ", finished" : "");
+                latest[index] = std::move(update->accumulation);
+                if (update->isFinal)
+                    return;
+            }
+        });
+    }
+    for (std::thread& receiver : receivers)
+        receiver.join();
+
+    std::optional<Accumulation> merged;
+    for (std::optional<Accumulation>& accumulation : latest) {
+        if (!accumulation)
+            continue;
+        if (!merged)
+            merged = std::move(*accumulation);
+        else
+            merged->add(*accumulation);
+    }
+    return merged;
+}
+
+} // namespace RenderFarm
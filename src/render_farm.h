@@ -0,0 +1,90 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "renderer.h"
+#include "socket.h"
+
+/// Splits a render over worker processes, on one machine or several, which
+/// each render the whole image with their own seed and report their
+/// accumulation to a coordinator that merges them. A worker that fails only
+/// costs the samples it rendered since its last update.
+///
+/// Workers connect over TCP and receive an `Assignment`, then send updates,
+/// each replacing the worker's previous one: `UpdateMagic`, a 32-bit flag
+/// set on the final update, the width and height of the buffer and the
+/// `Renderer` as 32-bit integers, the `Job`'s scene hash and the fields of
+/// `Accumulation` as 64-bit values, and the RGB floats of the buffer.
+/// Everything is in the byte order of the worker, so all machines must
+/// share it.
+namespace RenderFarm {
+
+inline constexpr char AssignmentMagic[8] = {'M', 'L', 'T', 'F', 'A', 'R', 'M', 'A'};
+inline constexpr char UpdateMagic[8] = {'M', 'L', 'T', 'F', 'A', 'R', 'M', 'U'};
+inline constexpr std::uint16_t DefaultPort = 7170;
+
+enum class Renderer : std::uint32_t {
+    PathTracer,
+    MLT
+};
+
+/// What a worker renders. Workers whose job or image size differs from that
+/// of the first worker to send an update are rejected, since their samples
+/// cannot be merged.
+struct Job {
+    /// `Scene::geometryHash` of the worker's scene.
+    std::uint64_t sceneHash = 0;
+    Renderer renderer = Renderer::MLT;
+};
+
+struct Assignment {
+    std::uint32_t workerIndex = 0;
+    /// For `PCG32::setSeed`, different for every worker.
+    std::uint64_t seed = 0;
+};
+
+/// The connection of a worker to its coordinator.
+class Worker {
+public:
+    /// Connects to the coordinator at `host`:`port` and waits for the
+    /// assignment. `job` is sent along with every update. Prints the reason
+    /// and returns nothing if that fails.
+    static std::optional<Worker> connect(
+        const std::string& host, std::uint16_t port, const Job& job);
+
+    [[nodiscard]] const Assignment& assignment() const { return _assignment; }
+
+    /// Sends the worker's accumulation so far. Returns false, after printing
+    /// the reason, if the coordinator is gone or rejected the worker.
+    bool sendUpdate(const Accumulation& accumulation, bool isFinal);
+
+private:
+    Worker(Socket socket, const Job& job, const Assignment& assignment)
+        : _socket(std::move(socket)), _job(job), _assignment(assignment) {}
+
+    Socket _socket;
+    Job _job;
+    Assignment _assignment;
+};
+
+/// Accepts `numWorkers` workers on `listener`, assigning worker `i` a seed
+/// derived from `seed` and `i`, and merges their last updates once every
+/// worker has sent its final update or disconnected. Workers that render
+/// another job than the first to report are disconnected. Workers that have
+/// not connected within `connectTimeout` are given up on, as are workers
+/// that send nothing for `updateTimeout`, so a hung worker cannot stall the
+/// merge. Returns nothing if no worker sent an update.
+std::optional<Accumulation> coordinate(
+    Socket& listener, int numWorkers, std::uint64_t seed,
+    std::chrono::milliseconds connectTimeout,
+    std::chrono::milliseconds updateTimeout);
+
+} // namespace RenderFarm
@@ -0,0 +1,177 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#include "render_process.h"
+
+#include <algorithm>
+#include <format>
+#include <functional>
+#include <print>
+#include <string>
+#include <utility>
+
+#include "tracy/Tracy.hpp"
+
+#include "render_stats.h"
+
+RenderProcess::RenderProcess(
+        IRenderer& renderer, Scene& scene, int width, int height, int numJobs,
+        LiveBuffer* liveBuffer, const Limits& limits, StepCallback onStep)
+    : _renderer(renderer),
+      _scene(scene),
+      _limits(limits),
+      _frameBuffers{Image(width, height, 3), Image(width, height, 3)},
+      _frontBuffer(&_frameBuffers[0]),
+      _backBuffer(&_frameBuffers[1]),
+      _liveBuffer(liveBuffer),
+      _onStep(std::move(onStep)) {
+    if (_liveBuffer)
+        _linearBuffer = Image(width, height, 3);
+    if (numJobs > 1)
+        _threadPool.emplace(numJobs);
+    _thread = std::thread(std::bind_front(&RenderProcess::renderLoop, this));
+}
+
+RenderProcess::~RenderProcess() {
+    stop();
+}
+
+void RenderProcess::reset() {
+    stop();
+    start();
+}
+
+void RenderProcess::stop() {
+    _renderer.stop();
+    if (_thread.joinable())
+        _thread.join();
+}
+
+void RenderProcess::start() {
+    {
+        std::lock_guard lock(_saveMutex);
+        _renderer.reset();
+        _isFinished = false;
+    }
+    ++_epoch;
+    _thread = std::thread(std::bind_front(&RenderProcess::renderLoop, this));
+}
+
+void RenderProcess::waitUntilFinished() {
+    if (_thread.joinable())
+        _thread.join();
+}
+
+void RenderProcess::saveFrame(
+        std::filesystem::path fileName,
+        std::optional<std::filesystem::path> linearFileName) {
+    std::lock_guard lock(_saveMutex);
+    _saveRequest = SaveRequest(std::move(fileName), std::move(linearFileName));
+    if (_isFinished)
+        serveSaveRequest(*_frontBuffer);
+}
+
+void RenderProcess::serveSaveRequest(const Image& frameBuffer) {
+    ZoneScoped;
+    if (!_saveRequest)
+        return;
+    _imageWriter.enqueue(frameBuffer, std::move(_saveRequest->fileName));
+    if (_saveRequest->linearFileName) {
+        Image linear(frameBuffer.width(), frameBuffer.height(), frameBuffer.channels());
+        _renderer.resolveLinear(linear);
+        _imageWriter.enqueue(
+            std::move(linear), std::move(*_saveRequest->linearFileName));
+    }
+    _saveRequest.reset();
+}
+
+void RenderProcess::renderLoop() {
+    tracy::SetThreadName("Render Thread");
+    constexpr int MaxNumSamplesPerStep = 128;
+    constexpr auto StatsInterval = std::chrono::seconds(1);
+    int sampleStepSize = 1;
+    RenderStats::Monitor statsMonitor;
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    _elapsedSeconds = 0.0;
+    while (_renderer.numSamplesPerPixel() < _limits.numSamplesPerPixel) {
+        FrameMark;
+        const int remainingSamples =
+            _limits.numSamplesPerPixel - _renderer.numSamplesPerPixel();
+        const int numSamples = std::min(sampleStepSize, remainingSamples);
+        const auto stepStartTime = std::chrono::high_resolution_clock::now();
+        _renderer.accumulate(
+            _scene, numSamples,
+            _threadPool ? &_threadPool.value() : nullptr);
+        if (_renderer.isStopping())
+            break;
+        const auto currentTime = std::chrono::high_resolution_clock::now();
+        const std::chrono::duration<double> elapsed = currentTime - startTime;
+        _elapsedSeconds = elapsed.count();
+        RenderStats::Counters& stats = RenderStats::local();
+        RenderStats::add(stats.numAccumulateSteps);
+        RenderStats::add(
+            stats.accumulateNanoseconds,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                currentTime - stepStartTime).count());
+        if (sampleStepSize < MaxNumSamplesPerStep)
+            sampleStepSize *= 2;
+        bool isConverged = false;
+        if (const auto summary = statsMonitor.update(StatsInterval)) {
+            summary->plot();
+            std::string errorString;
+            if (_limits.relativeErrorTarget) {
+                if (const auto error = _renderer.estimateRelativeError()) {
+                    TracyPlot("Relative error", *error);
+                    errorString = std::format(", Relative error: {:.4f}", *error);
+                    isConverged = *error <= *_limits.relativeErrorTarget;
+                }
+            }
+            std::println("Samples per pixel: {}, Time: {:.3f}s{}, {}",
+                _renderer.numSamplesPerPixel(), elapsed.count(), errorString,
+                summary->toString());
+            if (isConverged) {
+                std::println("Reached the relative error target of {}",
+                    *_limits.relativeErrorTarget);
+            }
+        }
+
+        bool isOutOfTime = false;
+        if (_limits.timeBudget) {
+            // Shrink the next step to what fits in the remaining time at the
+            // speed of this one.
+            const std::chrono::duration<double> stepTime = currentTime - stepStartTime;
+            const double secondsPerSample = stepTime.count() / numSamples;
+            const double remainingSeconds = (*_limits.timeBudget - elapsed).count();
+            isOutOfTime = remainingSeconds < 0.5 * secondsPerSample;
+            if (secondsPerSample > 0.0) {
+                sampleStepSize = static_cast<int>(std::clamp(
+                    remainingSeconds / secondsPerSample,
+                    1.0, static_cast<double>(sampleStepSize)));
+            }
+        }
+
+        ThreadPool* pool = _threadPool ? &_threadPool.value() : nullptr;
+        _renderer.updateFrameBuffer(*_backBuffer, pool);
+        if (_liveBuffer) {
+            _renderer.resolveLinear(_linearBuffer, pool);
+            _liveBuffer->update(
+                *_backBuffer, _linearBuffer,
+                _renderer.numSamplesPerPixel(), _epoch);
+        }
+        {
+            std::lock_guard lock(_saveMutex);
+            serveSaveRequest(*_backBuffer);
+        }
+        std::swap(_frontBuffer, _backBuffer);
+        if (_onStep)
+            _onStep(false);
+        if (isOutOfTime || isConverged)
+            break;
+    }
+    if (_onStep)
+        _onStep(true);
+    std::lock_guard lock(_saveMutex);
+    _isFinished = true;
+    serveSaveRequest(*_frontBuffer);
+}
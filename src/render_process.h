@@ -0,0 +1,114 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#include "image.h"
+#include "image_writer.h"
+#include "live_buffer.h"
+#include "renderer.h"
+#include "scene.h"
+#include "threadpool.h"
+
+/// Renders a scene on a background thread, publishing the converging frame
+/// buffer after every step, until a sample, time or error limit is reached.
+class RenderProcess {
+public:
+    struct Limits {
+        int numSamplesPerPixel = 16384;
+        /// Rendering also stops once this much time has passed, if given.
+        /// Steps are sized from the time of the last one to land close to it.
+        std::optional<std::chrono::duration<double>> timeBudget;
+        /// Rendering also stops once `IRenderer::estimateRelativeError` is
+        /// at most this, if given. It is checked about once a second.
+        std::optional<double> relativeErrorTarget;
+    };
+
+    /// Called on the render thread after every step, and once more with
+    /// `isFinal` set when rendering ends, while the renderer is not
+    /// accumulating.
+    using StepCallback = std::function<void(bool isFinal)>;
+
+    /// If given, `liveBuffer` is updated after every frame buffer update.
+    RenderProcess(
+        IRenderer& renderer, Scene& scene, int width, int height, int numJobs,
+        LiveBuffer* liveBuffer = nullptr, const Limits& limits = {},
+        StepCallback onStep = {});
+    ~RenderProcess();
+
+    /// Live converging frame buffer for presentation.
+    /// @warning
+    ///     This frame buffer may be invalidated at any point in the future;
+    ///     there is no lock for access.
+    const Image& frameBuffer() const { return *_frontBuffer; }
+
+    /// Should be called when the scene changes.
+    void reset();
+
+    /// Stops rendering and waits for the render thread, after which the
+    /// scene may be modified freely.
+    void stop();
+    /// Restarts rendering from scratch after `stop`.
+    void start();
+
+    /// Waits until a limit is reached, without stopping the renderer early.
+    void waitUntilFinished();
+
+    /// Time spent rendering since the last start.
+    [[nodiscard]] std::chrono::duration<double> elapsedTime() const {
+        return std::chrono::duration<double>(_elapsedSeconds.load());
+    }
+
+    /// Saves the next completed frame to `fileName` and, if given, the
+    /// linear radiance behind it to `linearFileName`. Encoding happens on a
+    /// background thread, so rendering is not paused.
+    void saveFrame(
+        std::filesystem::path fileName,
+        std::optional<std::filesystem::path> linearFileName = std::nullopt);
+
+private:
+    void renderLoop();
+    /// Hands a pending save request to the writer. `_saveMutex` must be held
+    /// and the renderer must not be accumulating.
+    void serveSaveRequest(const Image& frameBuffer);
+
+    IRenderer& _renderer;
+    Scene& _scene;
+    Limits _limits;
+    std::atomic<double> _elapsedSeconds = 0.0;
+
+    std::array<Image, 2> _frameBuffers;
+    Image* _frontBuffer;
+    Image* _backBuffer;
+
+    struct SaveRequest {
+        std::filesystem::path fileName;
+        std::optional<std::filesystem::path> linearFileName;
+    };
+    LiveBuffer* _liveBuffer;
+    StepCallback _onStep;
+    Image _linearBuffer;
+    /// Number of times the render has been restarted.
+    std::uint64_t _epoch = 0;
+
+    std::mutex _saveMutex;
+    std::optional<SaveRequest> _saveRequest;
+    /// Set once the render loop has exited, after which requests are served
+    /// by the caller.
+    bool _isFinished = false;
+    ImageWriter _imageWriter;
+
+    std::thread _thread;
+    std::optional<ThreadPool> _threadPool;
+};
@@ -0,0 +1,174 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#include "render_stats.h"
+
+#include <deque>
+#include <format>
+#include <mutex>
+#include <vector>
+
+#include "tracy/Tracy.hpp"
+
+namespace RenderStats {
+
+namespace {
+
+/// Counters of the running threads, and free slots left by threads that
+/// exited. A deque never moves its elements, so threads can keep pointers
+/// into it. The counts of exited threads move to `Retired`, so the totals
+/// include the work of finished thread pools while the registry only grows
+/// to the largest number of threads that counted at once.
+std::mutex RegistryMutex;
+std::deque<Counters> Registry;
+std::vector<Counters*> FreeSlots;
+Totals Retired;
+
+void addCounters(Totals& totals, const Counters& counters) {
+    constexpr auto Relaxed = std::memory_order_relaxed;
+    for (std::size_t kind = 0; kind < NumRayKinds; ++kind)
+        totals.numRays[kind] += counters.numRays[kind].load(Relaxed);
+    totals.numNodeVisits += counters.numNodeVisits.load(Relaxed);
+    totals.numTriangleTests += counters.numTriangleTests.load(Relaxed);
+    totals.numPaths += counters.numPaths.load(Relaxed);
+    totals.numMutationsProposed += counters.numMutationsProposed.load(Relaxed);
+    totals.numMutationsAccepted += counters.numMutationsAccepted.load(Relaxed);
+    totals.numAccumulateSteps += counters.numAccumulateSteps.load(Relaxed);
+    totals.accumulateNanoseconds += counters.accumulateNanoseconds.load(Relaxed);
+}
+
+void resetCounters(Counters& counters) {
+    constexpr auto Relaxed = std::memory_order_relaxed;
+    for (std::atomic<std::uint64_t>& numRays : counters.numRays)
+        numRays.store(0, Relaxed);
+    counters.numNodeVisits.store(0, Relaxed);
+    counters.numTriangleTests.store(0, Relaxed);
+    counters.numPaths.store(0, Relaxed);
+    counters.numMutationsProposed.store(0, Relaxed);
+    counters.numMutationsAccepted.store(0, Relaxed);
+    counters.numAccumulateSteps.store(0, Relaxed);
+    counters.accumulateNanoseconds.store(0, Relaxed);
+}
+
+/// A thread's slot in the registry, handed back when the thread exits.
+class Slot {
+public:
+    Slot() {
+        std::lock_guard lock(RegistryMutex);
+        if (FreeSlots.empty()) {
+            _counters = &Registry.emplace_back();
+        } else {
+            _counters = FreeSlots.back();
+            FreeSlots.pop_back();
+        }
+    }
+
+    ~Slot() {
+        std::lock_guard lock(RegistryMutex);
+        addCounters(Retired, *_counters);
+        resetCounters(*_counters);
+        FreeSlots.push_back(_counters);
+    }
+
+    Slot(const Slot&) = delete;
+    Slot& operator=(const Slot&) = delete;
+
+    Counters& counters() { return *_counters; }
+
+private:
+    Counters* _counters;
+};
+
+double ratio(double numerator, double denominator) {
+    return denominator > 0.0 ? numerator / denominator : 0.0;
+}
+
+} // namespace
+
+Counters& local() {
+    thread_local Slot slot;
+    return slot.counters();
+}
+
+Totals total() {
+    std::lock_guard lock(RegistryMutex);
+    Totals totals = Retired;
+    for (const Counters& counters : Registry)
+        addCounters(totals, counters);
+    return totals;
+}
+
+Totals Totals::operator-(const Totals& earlier) const {
+    Totals difference;
+    for (std::size_t kind = 0; kind < NumRayKinds; ++kind)
+        difference.numRays[kind] = numRays[kind] - earlier.numRays[kind];
+    difference.numNodeVisits = numNodeVisits - earlier.numNodeVisits;
+    difference.numTriangleTests = numTriangleTests - earlier.numTriangleTests;
+    difference.numPaths = numPaths - earlier.numPaths;
+    difference.numMutationsProposed = numMutationsProposed - earlier.numMutationsProposed;
+    difference.numMutationsAccepted = numMutationsAccepted - earlier.numMutationsAccepted;
+    difference.numAccumulateSteps = numAccumulateSteps - earlier.numAccumulateSteps;
+    difference.accumulateNanoseconds = accumulateNanoseconds - earlier.accumulateNanoseconds;
+    return difference;
+}
+
+std::string Summary::toString() const {
+    const double numRays = work.totalRays();
+    std::string result = std::format(
+        "{:.2f} Mrays/s ({:.0f}% primary, {:.0f}% shadow), "
+        "{:.1f} nodes/ray, {:.1f} tris/ray, {:.3f} Mpaths/s",
+        ratio(numRays, seconds) * 1e-6,
+        ratio(100.0 * work.numRays[static_cast<std::size_t>(RayKind::Primary)], numRays),
+        ratio(100.0 * work.numRays[static_cast<std::size_t>(RayKind::Shadow)], numRays),
+        ratio(work.numNodeVisits, numRays), ratio(work.numTriangleTests, numRays),
+        ratio(work.numPaths, seconds) * 1e-6);
+    if (work.numMutationsProposed > 0) {
+        result += std::format(
+            ", {:.3f} Mmutations/s ({:.1f}% accepted)",
+            ratio(work.numMutationsProposed, seconds) * 1e-6,
+            ratio(100.0 * work.numMutationsAccepted, work.numMutationsProposed));
+    }
+    if (work.numAccumulateSteps > 0) {
+        result += std::format(
+            ", {:.0f} ms/step",
+            ratio(work.accumulateNanoseconds * 1e-6, work.numAccumulateSteps));
+    }
+    return result;
+}
+
+void Summary::plot() const {
+    const double numRays = work.totalRays();
+    TracyPlot("Mrays/s", ratio(numRays, seconds) * 1e-6);
+    TracyPlot("Primary Mrays/s",
+        ratio(work.numRays[static_cast<std::size_t>(RayKind::Primary)], seconds) * 1e-6);
+    TracyPlot("Secondary Mrays/s",
+        ratio(work.numRays[static_cast<std::size_t>(RayKind::Secondary)], seconds) * 1e-6);
+    TracyPlot("Shadow Mrays/s",
+        ratio(work.numRays[static_cast<std::size_t>(RayKind::Shadow)], seconds) * 1e-6);
+    TracyPlot("BVH nodes per ray", ratio(work.numNodeVisits, numRays));
+    TracyPlot("Triangle tests per ray", ratio(work.numTriangleTests, numRays));
+    TracyPlot("Mpaths/s", ratio(work.numPaths, seconds) * 1e-6);
+    TracyPlot("Mmutations/s", ratio(work.numMutationsProposed, seconds) * 1e-6);
+    TracyPlot("Acceptance rate",
+        ratio(work.numMutationsAccepted, work.numMutationsProposed));
+    TracyPlot("ms per step",
+        ratio(work.accumulateNanoseconds * 1e-6, work.numAccumulateSteps));
+}
+
+Monitor::Monitor()
+    : _lastTotals(total()), _lastTime(std::chrono::steady_clock::now()) {}
+
+std::optional<Summary> Monitor::update(const std::chrono::duration<double> interval) {
+    const auto currentTime = std::chrono::steady_clock::now();
+    const std::chrono::duration<double> elapsed = currentTime - _lastTime;
+    if (elapsed < interval)
+        return std::nullopt;
+    const Totals totals = total();
+    Summary summary{.work = totals - _lastTotals, .seconds = elapsed.count()};
+    _lastTotals = totals;
+    _lastTime = currentTime;
+    return summary;
+}
+
+} // namespace RenderStats
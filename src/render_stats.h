@@ -0,0 +1,95 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include "ray.h"
+
+/// Counters of the work done while rendering. Every thread counts into its
+/// own cache-line aligned slot, so counting costs a plain load and store
+/// with no contention, and the totals are only summed when asked for.
+namespace RenderStats {
+
+struct Totals {
+    /// Rays traced through the scene, indexed by `RayKind`.
+    std::array<std::uint64_t, NumRayKinds> numRays{};
+    /// Internal BVH nodes whose four child boxes were tested against a ray.
+    std::uint64_t numNodeVisits = 0;
+    /// Ray-triangle and ray-shape tests.
+    std::uint64_t numTriangleTests = 0;
+    /// Camera samples of the path tracer, and paths proposed by MLT.
+    std::uint64_t numPaths = 0;
+    std::uint64_t numMutationsProposed = 0;
+    std::uint64_t numMutationsAccepted = 0;
+    /// Calls to `IRenderer::accumulate` made by `RenderProcess`, and the
+    /// time spent in them.
+    std::uint64_t numAccumulateSteps = 0;
+    std::uint64_t accumulateNanoseconds = 0;
+
+    [[nodiscard]] std::uint64_t totalRays() const {
+        return numRays[0] + numRays[1] + numRays[2];
+    }
+
+    /// The work done since `earlier` was taken.
+    [[nodiscard]] Totals operator-(const Totals& earlier) const;
+};
+
+struct alignas(64) Counters {
+    std::array<std::atomic<std::uint64_t>, NumRayKinds> numRays{};
+    std::atomic<std::uint64_t> numNodeVisits = 0;
+    std::atomic<std::uint64_t> numTriangleTests = 0;
+    std::atomic<std::uint64_t> numPaths = 0;
+    std::atomic<std::uint64_t> numMutationsProposed = 0;
+    std::atomic<std::uint64_t> numMutationsAccepted = 0;
+    std::atomic<std::uint64_t> numAccumulateSteps = 0;
+    std::atomic<std::uint64_t> accumulateNanoseconds = 0;
+};
+
+/// Counters of the calling thread, which is the only one writing to them.
+Counters& local();
+
+/// Adds `n` to a counter of the calling thread.
+inline void add(std::atomic<std::uint64_t>& counter, std::uint64_t n = 1) {
+    counter.store(
+        counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+/// Sum of the counters of every thread that has counted so far. Counters
+/// only grow, so the work done in between two calls is their difference.
+Totals total();
+
+/// The work done over a stretch of wall time.
+struct Summary {
+    Totals work;
+    double seconds = 0.0;
+
+    /// The rates on one line, as shown in the window title.
+    [[nodiscard]] std::string toString() const;
+
+    /// Sends the rates to Tracy plots. Does nothing unless Tracy is enabled.
+    void plot() const;
+};
+
+/// Sums the counters of all threads every so often.
+class Monitor {
+public:
+    Monitor();
+
+    /// Returns the work done since the last summary, once at least
+    /// `interval` has passed since it.
+    std::optional<Summary> update(std::chrono::duration<double> interval);
+
+private:
+    Totals _lastTotals;
+    std::chrono::steady_clock::time_point _lastTime;
+};
+
+} // namespace RenderStats
@@ -4,10 +4,69 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <optional>
+
 #include "image.h"
 #include "scene.h"
+#include "startup_report.h"
 #include "threadpool.h"
 
+/// Position of a renderer's buffers within the camera image, in pixels.
+struct FilmOffset {
+    int x = 0;
+    int y = 0;
+};
+
+/// A rectangle of pixels of a renderer's buffers, whose row 0 is the bottom
+/// row of the image.
+struct CropWindow {
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+};
+
+/// The sums behind a renderer's image, before normalization. Accumulations
+/// of the same scene rendered with different seeds add up to the
+/// accumulation of one longer render, which is how the render farm merges
+/// its workers.
+struct Accumulation {
+    /// Sum of the samples of each pixel. For MLT, the sum over its chains of
+    /// the colors, scaled to unit luminance, of the states visited there.
+    Image buffer;
+    /// Samples per pixel behind `buffer`.
+    std::uint64_t numSamplesPerPixel = 0;
+    /// Sum of the luminance of the paths sampled by MLT new path mutations,
+    /// and their number, which estimate the mean luminance that scales the
+    /// buffer. Both are zero for the path tracer, whose samples need no
+    /// scaling.
+    double accumulatedLuminance = 0.0;
+    std::uint64_t numNewPathMutations = 0;
+
+    /// Adds `other`, whose buffer must have the same size.
+    void add(const Accumulation& other) {
+        buffer.accumulateScaled(other.buffer, 1.0f);
+        numSamplesPerPixel += other.numSamplesPerPixel;
+        accumulatedLuminance += other.accumulatedLuminance;
+        numNewPathMutations += other.numNewPathMutations;
+    }
+
+    /// Writes the linear radiance estimate, as `IRenderer::resolveLinear`
+    /// of the renderer that made it would, to `image` of the buffer's size.
+    void resolveLinear(Image& image, ThreadPool* pool = nullptr) const {
+        image.clear();
+        if (numSamplesPerPixel == 0)
+            return;
+        const double meanLuminance = numNewPathMutations > 0
+            ? accumulatedLuminance / numNewPathMutations
+            : 1.0;
+        image.accumulateScaled(
+            buffer, static_cast<float>(meanLuminance / numSamplesPerPixel), pool);
+    }
+};
+
 /// Abstract base class for different rendering techniques to implement.
 class IRenderer {
 public:
@@ -17,7 +76,30 @@ public:
         int numSamples,
         ThreadPool* pool = nullptr) = 0;
 
-    virtual void updateFrameBuffer(Image& frameBuffer) const = 0; 
+    /// Writes the display-ready image, using `pool` for the per-pixel work
+    /// if given.
+    virtual void updateFrameBuffer(
+        Image& frameBuffer,
+        ThreadPool* pool = nullptr) const = 0;
+
+    /// Writes the current linear radiance estimate, before tone mapping, to
+    /// `image`, which must have the size of the frame buffer.
+    virtual void resolveLinear(
+        Image& image,
+        ThreadPool* pool = nullptr) const = 0;
+
+    /// Places the buffers, which may be smaller than the camera image, at
+    /// `offset` within it, so the renderer only renders that tile of the
+    /// image. Takes effect from the next `reset`, and must not change while
+    /// accumulating.
+    void setFilmOffset(FilmOffset offset) { _filmOffset = offset; }
+    FilmOffset filmOffset() const { return _filmOffset; }
+
+    /// Restricts rendering to `crop`, which must lie within the buffers, and
+    /// leaves the rest of the image black. Sample counts and normalization
+    /// only cover the crop. Takes effect from the next `reset`.
+    void setCrop(std::optional<CropWindow> crop) { _crop = crop; }
+    const std::optional<CropWindow>& crop() const { return _crop; }
 
     virtual void reset() { _isStopping = false; }
     virtual void stop() { _isStopping = true; }
@@ -25,6 +107,26 @@ public:
 
     virtual int numSamplesPerPixel() const = 0;
 
+    /// Estimates the relative error of the current image from the spread of
+    /// its samples, without a reference: the square root of the mean over
+    /// pixels and channels of the variance of the estimate divided by its
+    /// squared value plus `RelativeErrorEpsilon`. It predicts the square
+    /// root of the relMSE against a converged render. Returns nothing if the
+    /// renderer cannot estimate it, or not yet.
+    virtual std::optional<double> estimateRelativeError() const {
+        return std::nullopt;
+    }
+
+    /// Copies the sums behind the current image, so renders of the same
+    /// scene in other processes can be merged with it.
+    virtual Accumulation accumulation() const = 0;
+
+    /// Adds the memory held by the accumulation buffers and any other
+    /// per-renderer state to `report`.
+    virtual void addMemoryUsage(StartupReport& report) const = 0;
+
 protected:
     std::atomic<bool> _isStopping = false;
+    FilmOffset _filmOffset;
+    std::optional<CropWindow> _crop;
 };
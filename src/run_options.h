@@ -0,0 +1,24 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string>
+
+class SceneWatcher;
+
+/// Settings of a render that apply both with and without a window.
+struct RunOptions {
+    int numJobs = 1;
+    /// Screenshots are always saved as PNG and, if this is given (e.g.
+    /// "exr"), also as linear HDR images.
+    std::optional<std::string> hdrExtension;
+    /// File to mirror the render progress into, see `LiveBuffer`.
+    std::optional<std::filesystem::path> liveBufferPath;
+    /// Applies reloads of the scene file while running, if given. Only used
+    /// with a window.
+    SceneWatcher* sceneWatcher = nullptr;
+};
@@ -0,0 +1,214 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#include "sampling.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "math.h"
+
+namespace {
+
+/// The component of `v` orthogonal to the unit vector `w`, normalized.
+std::optional<Vec3> orthogonalize(Vec3 v, Vec3 w) {
+    const Vec3 result = v - dot(v, w) * w;
+    const float lengthSquared = length2(result);
+    if (lengthSquared <= 0.0f)
+        return std::nullopt;
+    return result / std::sqrt(lengthSquared);
+}
+
+float angleBetween(Vec3 a, Vec3 b) {
+    return std::acos(std::clamp(dot(a, b), -1.0f, 1.0f));
+}
+
+} // namespace
+
+std::optional<SolidAngleSample> sampleSphericalTriangle(
+        const std::array<Vec3, 3>& positions, const Vec3 origin, const Vec2 u) {
+    // Project the triangle onto the unit sphere around the origin.
+    const Vec3 a = normalize(positions[0] - origin);
+    const Vec3 b = normalize(positions[1] - origin);
+    const Vec3 c = normalize(positions[2] - origin);
+
+    // Normals of the great circles through each edge.
+    Vec3 nAB = cross(a, b);
+    Vec3 nBC = cross(b, c);
+    Vec3 nCA = cross(c, a);
+    if (length2(nAB) <= 0.0f || length2(nBC) <= 0.0f || length2(nCA) <= 0.0f)
+        return std::nullopt;
+    nAB = normalize(nAB);
+    nBC = normalize(nBC);
+    nCA = normalize(nCA);
+
+    // Interior angles of the spherical triangle; their excess over pi is the
+    // solid angle.
+    const float alpha = angleBetween(nAB, -nCA);
+    const float beta = angleBetween(nBC, -nAB);
+    const float gamma = angleBetween(nCA, -nBC);
+    const float solidAngle = alpha + beta + gamma - PI;
+    if (!(solidAngle > MinSampledSolidAngle))
+        return std::nullopt;
+
+    // Choose the sub-triangle with area proportional to `u.x` and find the
+    // vertex `cPrime` on edge ac that bounds it.
+    const float sampledArea = PI + u.x * solidAngle;
+    const float cosAlpha = std::cos(alpha);
+    const float sinAlpha = std::sin(alpha);
+    const float sinPhi = std::sin(sampledArea) * cosAlpha - std::cos(sampledArea) * sinAlpha;
+    const float cosPhi = std::cos(sampledArea) * cosAlpha + std::sin(sampledArea) * sinAlpha;
+    const float k1 = cosPhi + cosAlpha;
+    const float k2 = sinPhi - sinAlpha * dot(a, b);
+    const float cosBPrime = std::clamp(
+        (k2 + (k2 * cosPhi - k1 * sinPhi) * cosAlpha) /
+            ((k2 * sinPhi + k1 * cosPhi) * sinAlpha),
+        -1.0f, 1.0f);
+    const float sinBPrime = std::sqrt(std::max(0.0f, 1.0f - cosBPrime * cosBPrime));
+    const std::optional<Vec3> acOrthogonal = orthogonalize(c, a);
+    if (!acOrthogonal)
+        return std::nullopt;
+    const Vec3 cPrime = cosBPrime * a + sinBPrime * *acOrthogonal;
+
+    // Choose a point along the arc from b to `cPrime`.
+    const float cosTheta = 1.0f - u.y * (1.0f - dot(cPrime, b));
+    const float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+    Vec3 direction = b;
+    if (const std::optional<Vec3> arcOrthogonal = orthogonalize(cPrime, b))
+        direction = normalize(cosTheta * b + sinTheta * *arcOrthogonal);
+
+    // Find where the sampled direction meets the triangle.
+    const Vec3 normal = cross(
+        positions[1] - positions[0], positions[2] - positions[0]);
+    const float denominator = dot(direction, normal);
+    if (denominator == 0.0f)
+        return std::nullopt;
+    const float t = dot(positions[0] - origin, normal) / denominator;
+    if (!(t > 0.0f))
+        return std::nullopt;
+    return SolidAngleSample{origin + t * direction, solidAngle};
+}
+
+std::optional<SolidAngleSample> sampleSphericalRectangle(
+        const Quad& quad, const Vec3 origin, const Vec2 u) {
+    // Local reference frame with the rectangle lying in the plane z = z0 < 0.
+    const float edge0Length = length(quad.edge0);
+    const float edge1Length = length(quad.edge1);
+    const Vec3 x = quad.edge0 / edge0Length;
+    const Vec3 y = quad.edge1 / edge1Length;
+    Vec3 z = cross(x, y);
+
+    const Vec3 d = quad.corner - origin;
+    float z0 = dot(d, z);
+    if (z0 > 0.0f) {
+        z = -z;
+        z0 = -z0;
+    }
+    if (z0 == 0.0f)
+        return std::nullopt; // The origin lies in the plane of the rectangle.
+    const float x0 = dot(d, x);
+    const float y0 = dot(d, y);
+    const float x1 = x0 + edge0Length;
+    const float y1 = y0 + edge1Length;
+
+    // Normals of the planes through the origin and each edge.
+    const Vec3 v00(x0, y0, z0);
+    const Vec3 v01(x0, y1, z0);
+    const Vec3 v10(x1, y0, z0);
+    const Vec3 v11(x1, y1, z0);
+    const Vec3 n0 = normalize(cross(v00, v10));
+    const Vec3 n1 = normalize(cross(v10, v11));
+    const Vec3 n2 = normalize(cross(v11, v01));
+    const Vec3 n3 = normalize(cross(v01, v00));
+
+    // Internal angles of the spherical rectangle.
+    const float g0 = std::acos(std::clamp(-dot(n0, n1), -1.0f, 1.0f));
+    const float g1 = std::acos(std::clamp(-dot(n1, n2), -1.0f, 1.0f));
+    const float g2 = std::acos(std::clamp(-dot(n2, n3), -1.0f, 1.0f));
+    const float g3 = std::acos(std::clamp(-dot(n3, n0), -1.0f, 1.0f));
+    const float b0 = n0.z;
+    const float b1 = n2.z;
+    const float k = 2.0f * PI - g2 - g3;
+    const float solidAngle = g0 + g1 - k;
+    if (!(solidAngle > MinSampledSolidAngle))
+        return std::nullopt;
+
+    // Invert the area function along x.
+    const float au = u.x * solidAngle + k;
+    const float fu = (std::cos(au) * b0 - b1) / std::sin(au);
+    float cu = std::copysign(1.0f, fu) / std::sqrt(fu * fu + b0 * b0);
+    cu = std::clamp(cu, -1.0f, 1.0f);
+    float xu = -(cu * z0) / std::sqrt(std::max(1e-12f, 1.0f - cu * cu));
+    xu = std::clamp(xu, x0, x1);
+
+    // Invert the area function along y.
+    const float dist = std::sqrt(xu * xu + z0 * z0);
+    const float h0 = y0 / std::sqrt(dist * dist + y0 * y0);
+    const float h1 = y1 / std::sqrt(dist * dist + y1 * y1);
+    const float hv = h0 + u.y * (h1 - h0);
+    const float hv2 = hv * hv;
+    const float yv = hv2 < 1.0f - 1e-6f ? (hv * dist) / std::sqrt(1.0f - hv2) : y1;
+
+    return SolidAngleSample{origin + xu * x + yv * y + z0 * z, solidAngle};
+}
+
+std::optional<SolidAngleSample> sampleSphereCone(
+        const Sphere& sphere, const Vec3 origin, const Vec2 u) {
+    const Vec3 toCenter = sphere.center - origin;
+    const float distanceSquared = length2(toCenter);
+    const float radiusSquared = sphere.radius * sphere.radius;
+    if (distanceSquared <= radiusSquared)
+        return std::nullopt;
+
+    const float sinThetaMaxSquared = radiusSquared / distanceSquared;
+    const float cosThetaMax = std::sqrt(std::max(0.0f, 1.0f - sinThetaMaxSquared));
+    const float solidAngle = 2.0f * PI * (1.0f - cosThetaMax);
+    if (!(solidAngle > MinSampledSolidAngle))
+        return std::nullopt;
+
+    // Sample a direction in the cone around the axis towards the center.
+    const float cosTheta = 1.0f - u.x * (1.0f - cosThetaMax);
+    const float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+    const float phi = 2.0f * PI * u.y;
+    const Vec3 axis = toCenter / std::sqrt(distanceSquared);
+    const Vec3 tangent = std::abs(axis.x) > std::abs(axis.z)
+        ? normalize(cross(Vec3(0.0f, 1.0f, 0.0f), axis))
+        : normalize(cross(Vec3(1.0f, 0.0f, 0.0f), axis));
+    const Vec3 bitangent = cross(axis, tangent);
+    const Vec3 direction = normalize(
+        sinTheta * std::cos(phi) * tangent +
+        sinTheta * std::sin(phi) * bitangent +
+        cosTheta * axis);
+
+    // Find the near intersection with the sphere, which exists up to rounding
+    // at the silhouette.
+    const float projection = dot(toCenter, direction);
+    const float discriminant = std::max(
+        0.0f, projection * projection - (distanceSquared - radiusSquared));
+    const float t = projection - std::sqrt(discriminant);
+    return SolidAngleSample{origin + t * direction, solidAngle};
+}
+
+Vec3 sampleSphereSurface(const Sphere& sphere, const Vec2 u) {
+    const float z = 1.0f - 2.0f * u.x;
+    const float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+    const float phi = 2.0f * PI * u.y;
+    return sphere.center +
+        sphere.radius * Vec3(r * std::cos(phi), r * std::sin(phi), z);
+}
+
+Vec3 computeBarycentrics(const std::array<Vec3, 3>& positions, const Vec3 point) {
+    const Vec3 edge1 = positions[1] - positions[0];
+    const Vec3 edge2 = positions[2] - positions[0];
+    const Vec3 offset = point - positions[0];
+    const float d11 = dot(edge1, edge1);
+    const float d12 = dot(edge1, edge2);
+    const float d22 = dot(edge2, edge2);
+    const float d01 = dot(offset, edge1);
+    const float d02 = dot(offset, edge2);
+    const float invDenominator = 1.0f / (d11 * d22 - d12 * d12);
+    const float beta = (d22 * d01 - d12 * d02) * invDenominator;
+    const float gamma = (d11 * d02 - d12 * d01) * invDenominator;
+    return {1.0f - beta - gamma, beta, gamma};
+}
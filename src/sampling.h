@@ -0,0 +1,54 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#pragma once
+
+#include <array>
+#include <optional>
+
+#include "shapes.h"
+#include "types.h"
+
+/// A point on a shape, sampled uniformly with respect to the solid angle that
+/// the shape subtends from some reference point.
+struct SolidAngleSample {
+    Vec3 position;
+    /// The subtended solid angle, equal to the inverse of the sample's pdf.
+    float solidAngle;
+};
+
+/// Solid angles below this are not sampled reliably in single precision, so
+/// callers should fall back to sampling by area.
+constexpr float MinSampledSolidAngle = 3e-4f;
+
+/// Samples a point on a triangle uniformly by solid angle as seen from
+/// `origin`, following Arvo's "Stratified Sampling of Spherical Triangles".
+/// @returns
+///     `std::nullopt` if the triangle is degenerate or subtends too small a
+///     solid angle to be sampled.
+std::optional<SolidAngleSample> sampleSphericalTriangle(
+    const std::array<Vec3, 3>& positions, Vec3 origin, Vec2 u);
+
+/// Samples a point on a rectangle uniformly by solid angle as seen from
+/// `origin`, following Ureña et al., "An Area-Preserving Parametrization for
+/// Spherical Rectangles". The edges of `quad` must be orthogonal.
+/// @returns
+///     `std::nullopt` if the rectangle subtends too small a solid angle to be
+///     sampled.
+std::optional<SolidAngleSample> sampleSphericalRectangle(
+    const Quad& quad, Vec3 origin, Vec2 u);
+
+/// Samples a point on the visible cap of a sphere uniformly by solid angle as
+/// seen from `origin`, by sampling the cone of directions it subtends.
+/// @returns
+///     `std::nullopt` if `origin` is inside the sphere or the sphere subtends
+///     too small a solid angle to be sampled.
+std::optional<SolidAngleSample> sampleSphereCone(
+    const Sphere& sphere, Vec3 origin, Vec2 u);
+
+/// Samples a point uniformly by area on the surface of a sphere.
+Vec3 sampleSphereSurface(const Sphere& sphere, Vec2 u);
+
+/// Barycentric coordinates of `point` projected onto the plane of a triangle.
+Vec3 computeBarycentrics(const std::array<Vec3, 3>& positions, Vec3 point);
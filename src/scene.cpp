@@ -4,8 +4,14 @@
 
 #include "scene.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
+#include <cctype>
 #include <functional>
+#include <initializer_list>
+#include <limits>
 #include <print>
 #include <numeric>
 
@@ -18,10 +24,146 @@
 #include "glm/gtc/type_ptr.hpp"
 #include "glm/gtc/quaternion.hpp"
 
+#include "hash.h"
+#include "mapped_file.h"
+#include "ply.h"
+#include "ray_capture.h"
+#include "render_stats.h"
+#include "scene_cache.h"
+#include "startup_report.h"
+#include "threadpool.h"
 #include "types.h"
 
 constexpr float PBRLumensToWatts = 1.0f / 683;
 
+namespace {
+
+/// Gives fastgltf the bytes of a buffer view, whether the buffer is part of
+/// the asset or an external file we mapped.
+struct BufferDataAdapter {
+    const std::vector<MappedFile>& externalBuffers;
+
+    fastgltf::span<const std::byte> operator()(
+            const fastgltf::Asset& asset, std::size_t bufferViewIdx) const {
+        const fastgltf::BufferView& bufferView = asset.bufferViews[bufferViewIdx];
+        const fastgltf::Buffer& buffer = asset.buffers[bufferView.bufferIndex];
+        const std::byte* data = std::visit(Visitor{
+            [&](const auto& arg) -> const std::byte* {
+                return externalBuffers[bufferView.bufferIndex].bytes().data();
+            },
+            [](const fastgltf::sources::Array& array) -> const std::byte* {
+                return array.bytes.data();
+            },
+            [](const fastgltf::sources::ByteView& view) -> const std::byte* {
+                return view.bytes.data();
+            },
+        }, buffer.data);
+        assert(data);
+        return {data + bufferView.byteOffset, bufferView.byteLength};
+    }
+};
+
+/// Calls `function(triangleIdx, corner, vertexIdx)` for the corners of the
+/// first `numTriangles` triangles of `primitive`.
+template<typename F>
+void forEachTriangleCorner(
+        const fastgltf::Asset& asset, const fastgltf::Primitive& primitive,
+        std::size_t numTriangles, const BufferDataAdapter& adapter,
+        const F& function) {
+    if (!primitive.indicesAccessor) {
+        for (std::size_t i = 0; i < numTriangles * 3; ++i)
+            function(i / 3, i % 3, i);
+        return;
+    }
+    fastgltf::iterateAccessorWithIndex<std::uint32_t>(
+        asset, asset.accessors[*primitive.indicesAccessor],
+        [&](std::uint32_t vertexIdx, std::size_t i) {
+            if (i < numTriangles * 3)
+                function(i / 3, i % 3, vertexIdx);
+        },
+        adapter);
+}
+
+/// Number of whole triangles in a triangle list primitive.
+std::size_t countTriangles(
+        const fastgltf::Asset& asset, const fastgltf::Primitive& primitive) {
+    if (primitive.indicesAccessor)
+        return asset.accessors[*primitive.indicesAccessor].count / 3;
+    const auto positionsIt = primitive.findAttribute("POSITION");
+    return asset.accessors[positionsIt->accessorIndex].count / 3;
+}
+
+/// Number of PLY vertices or faces read by each task.
+constexpr std::size_t PlyChunkSize = 1 << 16;
+
+/// Calls `function(begin, end)` on consecutive ranges of at most `chunkSize`
+/// of `count` items, as separate tasks if there is a pool, and waits for them.
+template<typename F>
+void forEachChunk(
+        std::size_t count, std::size_t chunkSize, ThreadPool* pool,
+        const F& function) {
+    for (std::size_t begin = 0; begin < count; begin += chunkSize) {
+        const std::size_t end = std::min(count, begin + chunkSize);
+        if (pool)
+            pool->assignWork([&function, begin, end] { function(begin, end); });
+        else
+            function(begin, end);
+    }
+    if (pool)
+        pool->wait();
+}
+
+/// Interleaves the bits of a point in the unit cube, 10 bits per axis.
+std::uint32_t mortonCode(const Vec3 unitPosition) {
+    const auto spread = [](float value) {
+        std::uint32_t x = static_cast<std::uint32_t>(
+            std::clamp(value * 1024.0f, 0.0f, 1023.0f));
+        x = (x | (x << 16)) & 0x030000ffu;
+        x = (x | (x << 8)) & 0x0300f00fu;
+        x = (x | (x << 4)) & 0x030c30c3u;
+        x = (x | (x << 2)) & 0x09249249u;
+        return x;
+    };
+    return (spread(unitPosition.x) << 2) |
+        (spread(unitPosition.y) << 1) |
+        spread(unitPosition.z);
+}
+
+/// The primitive of `previousScene` with the same place in the file and the
+/// same geometry, whose BVH can be reused.
+const Mesh::Primitive* findUnchangedPrimitive(
+        const Scene* previousScene, std::size_t meshIdx,
+        std::size_t primitiveIdx, std::size_t startIdx, std::size_t count,
+        std::uint64_t geometryHash) {
+    if (!previousScene || meshIdx >= previousScene->meshes.size())
+        return nullptr;
+    const Mesh& previousMesh = previousScene->meshes[meshIdx];
+    if (primitiveIdx >= previousMesh.primitives.size())
+        return nullptr;
+    const Mesh::Primitive& previous = previousMesh.primitives[primitiveIdx];
+    if (previous.geometryHash != geometryHash ||
+            previous.startIdx != startIdx || previous.count != count)
+        return nullptr;
+    return &previous;
+}
+
+/// Computes the total areas and light sampling distributions of a new mesh's
+/// primitives.
+void computePrimitiveAreas(Mesh& mesh) {
+    for (Mesh::Primitive& primitive : mesh.primitives) {
+        const auto firstArea = mesh.triangleAreas.begin() + primitive.startIdx;
+        const auto lastArea = firstArea + primitive.count;
+
+        primitive.totalArea = std::accumulate(firstArea, lastArea, 0.0f);
+        if (const Sphere* sphere = primitive.sphere())
+            primitive.totalArea = sphere->area();
+        primitive.quad = mesh.findQuad(primitive.startIdx, primitive.count);
+        mesh.primitiveTriangleDistibutions.emplace_back(firstArea, lastArea);
+    }
+}
+
+} // namespace
+
 void Camera::move(const Vec3 delta) {
     position = position + delta;
 }
@@ -35,10 +177,25 @@ void Camera::rotate(float yaw, float pitch) {
     up = normalize(cross(right, forward));
 }
 
+std::optional<Vec2> Camera::project(const Vec3& point) const {
+    const Vec3 direction = point - position;
+    const float depth = dot(direction, forward);
+    if (depth <= 0.0f)
+        return std::nullopt;
+    const float scale = distanceToFilm / depth;
+    return Vec2(
+        (dot(direction, right) * scale / (aspectRatio * filmSize) + 0.5f) * width,
+        (dot(direction, up) * scale / filmSize + 0.5f) * height);
+}
+
 std::optional<Scene::HitInfo> Scene::intersect(
         const Ray& ray,
+        const RayKind kind,
         float minDistance,
         float maxDistance) const {
+    RenderStats::add(RenderStats::local().numRays[static_cast<std::size_t>(kind)]);
+    if (RayCapture::isActive())
+        RayCapture::record(ray, kind, minDistance, maxDistance);
     struct Hit {
         std::reference_wrapper<const Mesh> mesh;
         std::reference_wrapper<const Mesh::Primitive> primitive;
@@ -56,11 +213,34 @@ std::optional<Scene::HitInfo> Scene::intersect(
     if (!closestHit)
         return std::nullopt;
 
+    if (closestHit->hitInfo.shapeType == BVH::ShapeType::Sphere) {
+        const Sphere& sphere = *closestHit->primitive.get().sphere();
+        const Vec3 normal = normalize(closestHit->hitInfo.position - sphere.center);
+        return HitInfo{
+            .distance = closestHit->hitInfo.distance,
+            .position = closestHit->hitInfo.position,
+            .normal = normal,
+            .geometricNormal = normal,
+            .textureCoord = Vec2(
+                0.5f + std::atan2(normal.z, normal.x) / (2.0f * PI),
+                0.5f - std::asin(std::clamp(normal.y, -1.0f, 1.0f)) / PI),
+            .materialIdx = closestHit->primitive.get().materialIdx,
+            .shapeType = BVH::ShapeType::Sphere,
+            // The parametrization spans 2 pi r horizontally and pi r
+            // vertically; use the geometric mean.
+            .textureScale = 1.0f / (std::sqrt(2.0f) * PI * sphere.radius)};
+    }
+
     const Mesh::Triangle& triangle =
         closestHit->mesh.get().triangles[closestHit->hitInfo.triangleIdx];
     const Vec3 edge1 = triangle.positions[1] - triangle.positions[0];
     const Vec3 edge2 = triangle.positions[2] - triangle.positions[0];
     const Vec3 weights = closestHit->hitInfo.barycentricCoords;
+    const Vec2 textureEdge1 = triangle.textureCoords[1] - triangle.textureCoords[0];
+    const Vec2 textureEdge2 = triangle.textureCoords[2] - triangle.textureCoords[0];
+    const float textureArea =
+        std::abs(textureEdge1.x * textureEdge2.y - textureEdge1.y * textureEdge2.x);
+    const float worldArea = length(cross(edge1, edge2));
 
     return HitInfo{
         .distance = closestHit->hitInfo.distance,
@@ -74,17 +254,100 @@ std::optional<Scene::HitInfo> Scene::intersect(
             weights[0] * triangle.textureCoords[0] +
             weights[1] * triangle.textureCoords[1] +
             weights[2] * triangle.textureCoords[2],
-        .materialIdx = closestHit->primitive.get().materialIdx};
+        .materialIdx = closestHit->primitive.get().materialIdx,
+        .shapeType = closestHit->hitInfo.shapeType,
+        .textureScale =
+            worldArea > 0.0f ? std::sqrt(textureArea / worldArea) : 0.0f};
 }
 
-bool Scene::loadGltf(const std::filesystem::path& filePath) {
+bool Scene::load(
+        const std::filesystem::path& filePath, const LoadOptions& options) {
     ZoneScoped;
     ZoneTextF("filePath=%s", filePath.string().c_str());
 
+    // Snapshots hold a whole scene, so they are only used for empty ones.
+    const bool isEmpty =
+        meshes.empty() && images.empty() && lights.empty() && materials.empty();
+    std::optional<std::uint64_t> cacheKey;
+    if (options.cacheDirectory && isEmpty)
+        cacheKey = SceneCache::computeKey(filePath, options);
+    if (cacheKey) {
+        const std::filesystem::path cacheFile =
+            SceneCache::snapshotPath(*options.cacheDirectory, *cacheKey);
+        PhaseTimer timer(options.report, "snapshot load");
+        if (SceneCache::load(*this, cacheFile, *cacheKey))
+            return true;
+    }
+
+    std::string extension = filePath.extension().string();
+    std::ranges::transform(extension, extension.begin(), [](unsigned char c) {
+        return std::tolower(c);
+    });
+    const bool isLoaded = extension == ".ply"
+        ? parsePly(filePath, options)
+        : parseGltf(filePath, options);
+    if (!isLoaded)
+        return false;
+
+    if (cacheKey) {
+        PhaseTimer timer(options.report, "snapshot save");
+        SceneCache::save(
+            *this, SceneCache::snapshotPath(*options.cacheDirectory, *cacheKey),
+            *cacheKey);
+    }
+    return true;
+}
+
+void Scene::addMemoryUsage(StartupReport& report) const {
+    for (const Mesh& mesh : meshes) {
+        report.addMemory(
+            "triangles",
+            mesh.triangles.capacity() * sizeof(Mesh::Triangle) +
+                mesh.triangleAreas.capacity() * sizeof(float));
+        for (const Mesh::Primitive& primitive : mesh.primitives)
+            report.addMemory("bvh nodes", primitive.bvh.memoryUsage());
+        for (const auto& distribution : mesh.primitiveTriangleDistibutions) {
+            report.addMemory(
+                "light distributions",
+                distribution.probabilities().size() * sizeof(double));
+        }
+    }
+    for (const TextureImage& image : images)
+        report.addMemory("textures", image.memoryUsage());
+}
+
+std::uint64_t Scene::geometryHash() const {
+    std::vector<std::uint64_t> hashes;
+    for (const Mesh& mesh : meshes) {
+        for (const Mesh::Primitive& primitive : mesh.primitives)
+            hashes.push_back(primitive.geometryHash);
+    }
+    return hashBytes(std::as_bytes(std::span(hashes)));
+}
+
+void Scene::replaceContents(Scene&& other) {
+    meshes = std::move(other.meshes);
+    textures = std::move(other.textures);
+    images = std::move(other.images);
+    lights = std::move(other.lights);
+    materials = std::move(other.materials);
+}
+
+bool Scene::parseGltf(
+        const std::filesystem::path& filePath, const LoadOptions& options) {
+    ZoneScoped;
     std::println("Loading GLTF: {}", filePath.string());
 
+    // Map the file rather than reading it, so the binary chunk is only
+    // copied once, by the parser.
+    PhaseTimer readTimer(options.report, "file read");
+#if defined(FASTGLTF_HAS_MEMORY_MAPPED_FILE)
+    fastgltf::Expected<fastgltf::MappedGltfFile> dataBuffer =
+        fastgltf::MappedGltfFile::FromPath(filePath);
+#else
     fastgltf::Expected<fastgltf::GltfDataBuffer> dataBuffer =
         fastgltf::GltfDataBuffer::FromPath(filePath);
+#endif
     if (!dataBuffer) {
         std::println(
             stderr, "Failed to load GLTF: error={}",
@@ -98,10 +361,12 @@ bool Scene::loadGltf(const std::filesystem::path& filePath) {
         fastgltf::Extensions::KHR_materials_ior |
         fastgltf::Extensions::KHR_lights_punctual;
     fastgltf::Parser parser(extensionsToLoad);
-    
-    constexpr auto options = fastgltf::Options::LoadExternalBuffers;
+    readTimer.stop();
+
+    PhaseTimer parseTimer(options.report, "parse");
     fastgltf::Expected<fastgltf::Asset> asset = parser.loadGltfBinary(
-        dataBuffer.get(), filePath.parent_path(), options);
+        dataBuffer.get(), filePath.parent_path(), fastgltf::Options::None);
+    parseTimer.stop();
     if (!asset) {
         std::println(
             stderr, "Failed to load GLTF: error={}",
@@ -109,11 +374,56 @@ bool Scene::loadGltf(const std::filesystem::path& filePath) {
         return false;
     }
 
+    // External buffers are mapped instead of being loaded into vectors.
+    PhaseTimer bufferTimer(options.report, "file read");
+    std::vector<MappedFile> externalBuffers(asset->buffers.size());
+    for (std::size_t bufferIdx = 0; bufferIdx < asset->buffers.size(); ++bufferIdx) {
+        const auto* uri = std::get_if<fastgltf::sources::URI>(
+            &asset->buffers[bufferIdx].data);
+        if (!uri)
+            continue;
+        if (!uri->uri.isLocalPath() || uri->fileByteOffset != 0 ||
+                !externalBuffers[bufferIdx].open(
+                    filePath.parent_path() / uri->uri.fspath())) {
+            std::println(
+                stderr, "Failed to load GLTF: unsupported buffer uri={}",
+                uri->uri.string());
+            return false;
+        }
+    }
+    bufferTimer.stop();
+    const BufferDataAdapter bufferDataAdapter{externalBuffers};
+
     // Load images
     // Adapted from example:
     // https://github.com/spnda/fastgltf/blob/main/examples/gl_viewer/gl_viewer.cpp
-    for (const fastgltf::Image& image : asset->images) {
-        Image& newImage = images.emplace_back();
+    // Images are decoded on the pool while the rest of the scene loads, or
+    // deferred until they are first sampled.
+    const std::size_t firstImageIdx = images.size();
+    images.resize(firstImageIdx + asset->images.size());
+    const auto decodeImage = [&](TextureImage& newImage, auto source) {
+        const auto decode = [&newImage, source, report = options.report] {
+            PhaseTimer timer(report, "image decode");
+            newImage.load(source);
+            newImage.buildMipMaps();
+        };
+        if (options.pool)
+            options.pool->assignWork(decode);
+        else
+            decode();
+    };
+    // The asset outlives the decoding, so its buffers are only copied for
+    // deferred images.
+    const auto loadImage = [&](
+            TextureImage& newImage, std::span<const std::byte> bytes) {
+        if (options.lazyTextures)
+            newImage.defer(std::vector<std::byte>(bytes.begin(), bytes.end()));
+        else
+            decodeImage(newImage, bytes);
+    };
+    for (std::size_t imageIdx = 0; imageIdx < asset->images.size(); ++imageIdx) {
+        const fastgltf::Image& image = asset->images[imageIdx];
+        TextureImage& newImage = images[firstImageIdx + imageIdx];
         std::visit(Visitor{
             [](const auto& arg) {},
             [&](const fastgltf::sources::URI& filePath) {
@@ -121,30 +431,23 @@ bool Scene::loadGltf(const std::filesystem::path& filePath) {
                 assert(filePath.fileByteOffset == 0);
                 // We're only capable of loading local files.
                 assert(filePath.uri.isLocalPath());
-                newImage.load(filePath.uri.path());
+                std::filesystem::path imagePath(filePath.uri.path());
+                if (options.lazyTextures)
+                    newImage.defer(std::move(imagePath));
+                else
+                    decodeImage(newImage, std::move(imagePath));
             },
             [&](const fastgltf::sources::Array& vector) {
-                newImage.load(vector.bytes);
+                loadImage(newImage, vector.bytes);
             },
             [&](const fastgltf::sources::BufferView& view) {
-                const fastgltf::BufferView& bufferView =
-                    asset->bufferViews[view.bufferViewIndex];
-                const fastgltf::Buffer& buffer =
-                    asset->buffers[bufferView.bufferIndex];
-                std::visit(Visitor{
-                    // We only care about VectorWithMime here, because we
-                    // specify LoadExternalBuffers, meaning
-                    // all buffers are already loaded into a vector.
-                    [](auto& arg) {},
-                    [&](const fastgltf::sources::Array& vector) {
-                        newImage.load(std::span(
-                            vector.bytes.data() + bufferView.byteOffset,
-                            bufferView.byteLength));
-                    }
-                }, buffer.data);
+                const fastgltf::span<const std::byte> bytes =
+                    bufferDataAdapter(asset.get(), view.bufferViewIndex);
+                loadImage(newImage, std::span(bytes.data(), bytes.size()));
             },
         }, image.data);
     }
+
     // Load textures
     for (const fastgltf::Texture& texture : asset->textures) {
         assert(texture.imageIndex.has_value());
@@ -235,120 +538,468 @@ bool Scene::loadGltf(const std::filesystem::path& filePath) {
     }
 
 
-    // Load meshes
-    struct Vertex {
-        Vec3 position;
-        Vec3 normal;
-        Vec2 textureCoordinate;
+    // Load meshes. Every primitive is imported and gets its BVH built as a
+    // separate task, writing only to its own range of triangles. The results
+    // are then merged in order, so the scene does not depend on scheduling.
+    struct PrimitiveImport {
+        std::size_t meshIdx;
+        std::size_t primitiveIdx;
+        const fastgltf::Primitive* primitive;
+        std::size_t startIdx;
+        std::size_t count;
+        std::optional<BVH::AnalyticShape> analyticShape;
+        std::optional<BVH> bvh;
+        std::uint64_t geometryHash = 0;
+        /// False if the BVH was taken from `LoadOptions::previousScene`.
+        bool isRebuilt = false;
     };
+    std::vector<Mesh> newMeshes(asset->meshes.size());
+    std::vector<PrimitiveImport> primitiveImports;
     for (std::size_t meshIdx = 0; meshIdx < asset->meshes.size(); ++meshIdx) {
         const fastgltf::Mesh& mesh = asset->meshes[meshIdx];
-        Mesh newMesh{.name = std::string{mesh.name}};
-        for (const fastgltf::Primitive& primitive : mesh.primitives) {
-            std::size_t primitiveStartIdx = newMesh.triangles.size();
-            std::size_t primitiveTriangleCount = 0;
-
-            std::vector<std::uint32_t> indices;
-            std::vector<Vertex> vertices;
-
-            const auto positionsIt = primitive.findAttribute("POSITION");
-            const auto normalsIt = primitive.findAttribute("NORMAL");
-            const auto textureCoordsIt = primitive.findAttribute("TEXCOORD_0");
-
-            // Load indices
-            {
-                const fastgltf::Accessor& accessor =
-                    asset->accessors[*primitive.indicesAccessor];
-                indices.reserve(accessor.count);
-                fastgltf::iterateAccessor<std::uint32_t>(
-                    asset.get(), accessor,
-                    [&](std::uint32_t idx) { indices.push_back(idx); });
-            }
-            // Load positions
-            {
-                const fastgltf::Accessor& accessor =
-                    asset->accessors[positionsIt->accessorIndex];
-                vertices.resize(vertices.size() + accessor.count);
-                fastgltf::iterateAccessorWithIndex<Vec3>(
-                    asset.get(), accessor,
-                    [&](Vec3 position, std::size_t idx) {
-                        vertices[idx] = Vertex{
-                            .position = meshTransforms[meshIdx] * Vec4(position, 1.0f),
-                            .normal = Vec3(1.0f, 0.0f, 0.0f),
-                            .textureCoordinate = Vec2(0.0f)};
-                    });
-            }
-            // Load normals
-            if (normalsIt != primitive.attributes.end()) {
-                const fastgltf::Accessor& accessor =
-                    asset->accessors[normalsIt->accessorIndex];
-                fastgltf::iterateAccessorWithIndex<Vec3>(
-                    asset.get(), accessor,
-                    [&](Vec3 normal, std::size_t idx) {
-                        vertices[idx].normal =
-                            meshTransforms[meshIdx] * Vec4(normal, 0.0f);
-                    });
-            }
-            // Load texture coordinates
-            if (textureCoordsIt != primitive.attributes.end()) {
-                const fastgltf::Accessor& accessor =
-                    asset->accessors[textureCoordsIt->accessorIndex];
-                fastgltf::iterateAccessorWithIndex<Vec2>(
-                    asset.get(), accessor,
-                    [&](Vec2 textureCoordinate, std::size_t idx) {
-                        vertices[idx].textureCoordinate = textureCoordinate;
-                    });
-            }
+        Mesh& newMesh = newMeshes[meshIdx];
+        newMesh.name = std::string{mesh.name};
+
+        // Size the geometry up front so the accessors can be read straight
+        // into the final triangles.
+        std::size_t numMeshTriangles = 0;
+        for (std::size_t primitiveIdx = 0; primitiveIdx < mesh.primitives.size(); ++primitiveIdx) {
+            const fastgltf::Primitive& primitive = mesh.primitives[primitiveIdx];
+            const std::size_t count = countTriangles(asset.get(), primitive);
+            primitiveImports.emplace_back(
+                meshIdx, primitiveIdx, &primitive, numMeshTriangles, count);
+            numMeshTriangles += count;
+        }
+        newMesh.triangles.resize(numMeshTriangles);
+        newMesh.triangleAreas.resize(numMeshTriangles);
+        newMesh.primitives.reserve(mesh.primitives.size());
+    }
 
-            for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
-                Mesh::Triangle triangle;
-                for (int j = 0; j < 3; ++j) {
-                    const Vertex& v = vertices[indices[i + j]];
-                    triangle.positions[j] = v.position;
-                    triangle.normals[j] = v.normal;
-                    triangle.textureCoords[j] = v.textureCoordinate;
+    const auto importPrimitive = [&](PrimitiveImport& import) {
+        ZoneScopedN("Importing primitive");
+        PhaseTimer assemblyTimer(options.report, "mesh assembly");
+        const fastgltf::Primitive& primitive = *import.primitive;
+        const glm::mat4& transform = meshTransforms[import.meshIdx];
+        Mesh& newMesh = newMeshes[import.meshIdx];
+        Mesh::Triangle* const triangles = newMesh.triangles.data() + import.startIdx;
+
+        const auto positionsIt = primitive.findAttribute("POSITION");
+        const auto normalsIt = primitive.findAttribute("NORMAL");
+        const auto textureCoordsIt = primitive.findAttribute("TEXCOORD_0");
+        const fastgltf::Accessor& positions =
+            asset->accessors[positionsIt->accessorIndex];
+        const fastgltf::Accessor* normals =
+            normalsIt != primitive.attributes.end()
+                ? &asset->accessors[normalsIt->accessorIndex]
+                : nullptr;
+        const fastgltf::Accessor* textureCoords =
+            textureCoordsIt != primitive.attributes.end()
+                ? &asset->accessors[textureCoordsIt->accessorIndex]
+                : nullptr;
+
+        forEachTriangleCorner(
+            asset.get(), primitive, import.count, bufferDataAdapter,
+            [&](std::size_t triangleIdx, std::size_t corner, std::size_t vertexIdx) {
+                Mesh::Triangle& triangle = triangles[triangleIdx];
+                const Vec3 position = fastgltf::getAccessorElement<Vec3>(
+                    asset.get(), positions, vertexIdx, bufferDataAdapter);
+                triangle.positions[corner] = transform * Vec4(position, 1.0f);
+                triangle.normals[corner] = Vec3(1.0f, 0.0f, 0.0f);
+                if (normals) {
+                    const Vec3 normal = fastgltf::getAccessorElement<Vec3>(
+                        asset.get(), *normals, vertexIdx, bufferDataAdapter);
+                    triangle.normals[corner] = transform * Vec4(normal, 0.0f);
                 }
-                newMesh.triangles.push_back(triangle);
-                const float triangleArea = triangle.computeArea();
-                newMesh.triangleAreas.push_back(triangleArea);
-                ++primitiveTriangleCount;
+                triangle.textureCoords[corner] = textureCoords
+                    ? fastgltf::getAccessorElement<Vec2>(
+                        asset.get(), *textureCoords, vertexIdx, bufferDataAdapter)
+                    : Vec2(0.0f);
+            });
+        for (std::size_t i = 0; i < import.count; ++i)
+            newMesh.triangleAreas[import.startIdx + i] = triangles[i].computeArea();
+        assemblyTimer.stop();
+
+        // Spheres are only swapped in for untextured materials, since the
+        // analytic parametrization would not match the mesh's UVs.
+        const MaterialData& primitiveMaterial =
+            primitive.materialIndex
+                ? materials[*primitive.materialIndex]
+                : DefaultMaterialData;
+        const bool isTextured =
+            primitiveMaterial.baseColorTextureIdx ||
+            primitiveMaterial.emissiveTextureIdx;
+
+        PhaseTimer bvhTimer(options.report, "bvh build");
+        std::uint64_t& geometryHash = import.geometryHash;
+        geometryHash = hashBytes(
+            std::as_bytes(std::span(triangles, import.count)),
+            (options.detectAnalyticShapes ? 2 : 0) + (isTextured ? 1 : 0));
+        if (const Mesh::Primitive* previous = findUnchangedPrimitive(
+                options.previousScene, import.meshIdx, import.primitiveIdx,
+                import.startIdx, import.count, geometryHash)) {
+            import.bvh.emplace(previous->bvh);
+            import.analyticShape = previous->bvh.shape;
+            return;
+        }
+
+        if (options.detectAnalyticShapes) {
+            if (std::optional<Quad> quad = newMesh.findQuad(
+                    import.startIdx, import.count)) {
+                import.analyticShape = *quad;
+            } else if (!isTextured) {
+                if (std::optional<Sphere> sphere = newMesh.findSphere(
+                        import.startIdx, import.count))
+                    import.analyticShape = *sphere;
             }
+        }
+        if (import.analyticShape) {
+            import.bvh.emplace(
+                newMesh, import.startIdx, import.count, *import.analyticShape);
+        } else {
+            import.bvh.emplace(newMesh, import.startIdx, import.count);
+        }
+        import.isRebuilt = true;
+    };
+    for (PrimitiveImport& import : primitiveImports) {
+        if (options.pool)
+            options.pool->assignWork([&importPrimitive, &import] {
+                importPrimitive(import);
+            });
+        else
+            importPrimitive(import);
+    }
+    // This also waits for the images.
+    if (options.pool)
+        options.pool->wait();
+    if (options.previousScene) {
+        const auto numRebuilt = std::ranges::count_if(
+            primitiveImports, &PrimitiveImport::isRebuilt);
+        std::println(
+            "Rebuilt {} of {} primitive BVHs", numRebuilt, primitiveImports.size());
+    }
+
+    for (PrimitiveImport& import : primitiveImports) {
+        const fastgltf::Primitive& primitive = *import.primitive;
+        Mesh& newMesh = newMeshes[import.meshIdx];
+
+        // If this primitive has an emmisive material, we need to also
+        // add it as a light source.
+        const MaterialData& primitiveMaterial =
+            primitive.materialIndex
+                ? materials[*primitive.materialIndex]
+                : DefaultMaterialData;
+
+        if (primitiveMaterial.emissiveStrength > 0.0f &&
+                length2(primitiveMaterial.emissiveFactor) > 0.0f) {
+            const auto& meshLight = std::get<MeshLight>(
+                lights.emplace_back(MeshLight{
+                    .meshIdx = meshes.size() + import.meshIdx,
+                    .primitiveIdx = newMesh.primitives.size()}));
+            std::println(
+                "Added mesh name={} primitiveIdx={} as a light",
+                newMesh.name, meshLight.primitiveIdx);
+        }
+        if (import.analyticShape) {
+            std::println(
+                "Using an analytic {} for mesh name={} primitiveIdx={}",
+                std::holds_alternative<Sphere>(*import.analyticShape) ? "sphere" : "quad",
+                newMesh.name, newMesh.primitives.size());
+        }
+
+        newMesh.addPrimitive(
+            import.startIdx, import.count, primitive.materialIndex,
+            std::move(*import.bvh));
+        newMesh.primitives.back().geometryHash = import.geometryHash;
+    }
+
+    PhaseTimer distributionTimer(options.report, "distributions");
+    for (Mesh& newMesh : newMeshes) {
+        computePrimitiveAreas(newMesh);
+        std::println("Loaded mesh name={}", newMesh.name);
+        meshes.emplace_back(std::move(newMesh));
+    }
+    distributionTimer.stop();
+
+    std::size_t textureMemoryUsage = 0;
+    for (const TextureImage& image : images)
+        textureMemoryUsage += image.memoryUsage();
+    std::println(
+        "Loaded {} images using {:.1f} MiB{}",
+        images.size(), textureMemoryUsage / (1024.0 * 1024.0),
+        options.lazyTextures ? ", decoding on first use" : "");
+
+    return true;
+}
+
+bool Scene::parsePly(
+        const std::filesystem::path& filePath, const LoadOptions& options) {
+    ZoneScoped;
+    std::println("Loading PLY: {}", filePath.string());
+
+    PhaseTimer readTimer(options.report, "file read");
+    PlyFile file;
+    if (!file.open(filePath))
+        return false;
+    readTimer.stop();
+    const PlyFile::Element* vertexElement = file.findElement("vertex");
+    const PlyFile::Element* faceElement = file.findElement("face");
+    if (!vertexElement || !faceElement || vertexElement->stride == 0) {
+        std::println(
+            stderr, "Failed to load PLY: expected fixed-size vertices and faces");
+        return false;
+    }
+
+    const auto findVertexProperty = [&](
+            std::initializer_list<std::string_view> names) -> const PlyFile::Property* {
+        for (const std::string_view name : names) {
+            if (const auto propertyIdx = vertexElement->findProperty(name))
+                return &vertexElement->properties[*propertyIdx];
+        }
+        return nullptr;
+    };
+    const std::array<const PlyFile::Property*, 3> positionProperties{
+        findVertexProperty({"x"}), findVertexProperty({"y"}), findVertexProperty({"z"})};
+    const std::array<const PlyFile::Property*, 3> normalProperties{
+        findVertexProperty({"nx"}), findVertexProperty({"ny"}), findVertexProperty({"nz"})};
+    const std::array<const PlyFile::Property*, 2> textureCoordProperties{
+        findVertexProperty({"u", "s", "texture_u", "texture_s"}),
+        findVertexProperty({"v", "t", "texture_v", "texture_t"})};
+    const bool hasNormals = std::ranges::all_of(
+        normalProperties, [](const auto* property) { return property != nullptr; });
+    const bool hasTextureCoords = std::ranges::all_of(
+        textureCoordProperties, [](const auto* property) { return property != nullptr; });
+
+    std::optional<std::size_t> indicesIdx = faceElement->findProperty("vertex_indices");
+    if (!indicesIdx)
+        indicesIdx = faceElement->findProperty("vertex_index");
+    const bool hasPositions = std::ranges::all_of(
+        positionProperties, [](const auto* property) { return property != nullptr; });
+    if (!hasPositions || !indicesIdx ||
+            !faceElement->properties[*indicesIdx].countType) {
+        std::println(
+            stderr, "Failed to load PLY: expected vertex positions and face indices");
+        return false;
+    }
+    const PlyFile::Type indexType = faceElement->properties[*indicesIdx].type;
+    const std::size_t indexSize = PlyFile::typeSize(indexType);
 
-            // If this primitive has an emmisive material, we need to also
-            // add it as a light source.
-            const MaterialData& primitiveMaterial =
-                primitive.materialIndex
-                    ? materials[*primitive.materialIndex]
-                    : DefaultMaterialData;
-
-            if (primitiveMaterial.emissiveStrength > 0.0f &&
-                    length2(primitiveMaterial.emissiveFactor) > 0.0f) {
-                const auto& meshLight = std::get<MeshLight>(
-                    lights.emplace_back(MeshLight{
-                        .meshIdx = meshes.size(),
-                        .primitiveIdx = newMesh.primitives.size()}));
-                std::println(
-                    "Added mesh name={} primitiveIdx={} as a light",
-                    newMesh.name, meshLight.primitiveIdx);
+    // Vertices have a fixed size, so each task can jump straight to its
+    // range. Their bounds are gathered along the way for sorting triangles.
+    struct Vertex {
+        Vec3 position;
+        Vec3 normal;
+        Vec2 textureCoord;
+    };
+    std::vector<Vertex> vertices(vertexElement->count);
+    std::vector<AABB> vertexChunkBounds(
+        (vertices.size() + PlyChunkSize - 1) / PlyChunkSize);
+    forEachChunk(vertices.size(), PlyChunkSize, options.pool, [&](
+            const std::size_t begin, const std::size_t end) {
+        ZoneScopedN("Reading PLY vertices");
+        PhaseTimer timer(options.report, "parse");
+        AABB& bounds = vertexChunkBounds[begin / PlyChunkSize];
+        const std::byte* data =
+            file.begin() + vertexElement->offset + begin * vertexElement->stride;
+        for (std::size_t i = begin; i < end; ++i, data += vertexElement->stride) {
+            Vertex& vertex = vertices[i];
+            for (int axis = 0; axis < 3; ++axis) {
+                vertex.position[axis] = file.read<float>(
+                    data + positionProperties[axis]->offset,
+                    positionProperties[axis]->type);
+                vertex.normal[axis] = hasNormals
+                    ? file.read<float>(
+                        data + normalProperties[axis]->offset,
+                        normalProperties[axis]->type)
+                    : 0.0f;
+            }
+            for (int axis = 0; axis < 2; ++axis) {
+                vertex.textureCoord[axis] = hasTextureCoords
+                    ? file.read<float>(
+                        data + textureCoordProperties[axis]->offset,
+                        textureCoordProperties[axis]->type)
+                    : 0.0f;
             }
+            bounds.fit(vertex.position);
+        }
+    });
+    AABB vertexBounds;
+    for (const AABB& bounds : vertexChunkBounds) {
+        vertexBounds.fit(bounds.getMin());
+        vertexBounds.fit(bounds.getMax());
+    }
 
-            newMesh.addPrimitive(
-                primitiveStartIdx, primitiveTriangleCount,
-                primitive.materialIndex);
+    // Faces are lists, so a quick serial pass finds where each chunk of them
+    // starts and how many triangles came before it. Only the list counts
+    // are read here.
+    struct FaceChunk {
+        const std::byte* data;
+        std::size_t firstTriangle;
+    };
+    std::vector<FaceChunk> faceChunks;
+    std::size_t numTriangles = 0;
+    {
+        ZoneScopedN("Scanning PLY faces");
+        PhaseTimer timer(options.report, "parse");
+        const std::byte* data = file.begin() + faceElement->offset;
+        for (std::size_t faceIdx = 0; faceIdx < faceElement->count; ++faceIdx) {
+            if (faceIdx % PlyChunkSize == 0)
+                faceChunks.emplace_back(data, numTriangles);
+            PlyFile::List indices;
+            data = file.readInstance(*faceElement, data, *indicesIdx, indices);
+            if (!data) {
+                std::println(stderr, "Failed to load PLY: truncated faces");
+                return false;
+            }
+            if (indices.size >= 3)
+                numTriangles += indices.size - 2;
         }
+    }
+    // Triangles are sorted by 32-bit indices below.
+    if (numTriangles > std::numeric_limits<std::uint32_t>::max()) {
+        std::println(stderr, "Failed to load PLY: too many triangles={}", numTriangles);
+        return false;
+    }
 
-        for (Mesh::Primitive& primitive : newMesh.primitives) {
-            const auto firstArea = newMesh.triangleAreas.begin() + primitive.startIdx;
-            const auto lastArea = firstArea + primitive.count;
+    // Faces are fanned into triangles straight in the mesh, each chunk
+    // writing only its own range.
+    Mesh newMesh;
+    newMesh.name = filePath.stem().string();
+    newMesh.triangles.resize(numTriangles);
+    newMesh.triangleAreas.resize(numTriangles);
+    std::atomic<bool> hasInvalidIndices = false;
+    forEachChunk(faceElement->count, PlyChunkSize, options.pool, [&](
+            const std::size_t begin, const std::size_t end) {
+        ZoneScopedN("Assembling PLY triangles");
+        PhaseTimer timer(options.report, "mesh assembly");
+        const FaceChunk& chunk = faceChunks[begin / PlyChunkSize];
+        const std::byte* data = chunk.data;
+        std::size_t triangleIdx = chunk.firstTriangle;
+        const auto vertexAt = [&](const PlyFile::List& indices, std::size_t i) {
+            const auto vertexIdx = file.read<std::int64_t>(
+                indices.data + i * indexSize, indexType);
+            if (vertexIdx < 0 || static_cast<std::size_t>(vertexIdx) >= vertices.size()) {
+                hasInvalidIndices = true;
+                return Vertex{};
+            }
+            return vertices[vertexIdx];
+        };
+        for (std::size_t faceIdx = begin; faceIdx < end; ++faceIdx) {
+            PlyFile::List indices;
+            data = file.readInstance(*faceElement, data, *indicesIdx, indices);
+            for (std::size_t corner = 2; corner < indices.size; ++corner) {
+                const std::array<Vertex, 3> corners{
+                    vertexAt(indices, 0),
+                    vertexAt(indices, corner - 1),
+                    vertexAt(indices, corner)};
+                Mesh::Triangle& triangle = newMesh.triangles[triangleIdx];
+                for (std::size_t i = 0; i < 3; ++i) {
+                    triangle.positions[i] = corners[i].position;
+                    triangle.normals[i] = corners[i].normal;
+                    triangle.textureCoords[i] = corners[i].textureCoord;
+                }
+                // Scans rarely come with normals, so they are shaded flat.
+                if (!hasNormals) {
+                    const Vec3 normal = cross(
+                        triangle.positions[1] - triangle.positions[0],
+                        triangle.positions[2] - triangle.positions[0]);
+                    triangle.normals.fill(
+                        length2(normal) > 0.0f ? normalize(normal) : Vec3(0.0f, 0.0f, 1.0f));
+                }
+                newMesh.triangleAreas[triangleIdx] = triangle.computeArea();
+                ++triangleIdx;
+            }
+        }
+    });
+    if (hasInvalidIndices) {
+        std::println(stderr, "Failed to load PLY: vertex index out of range");
+        return false;
+    }
+    vertices = {};
+
+    // Large meshes are split into several primitives so their BVHs can be
+    // built in parallel. Sorting the triangles along a Morton curve first
+    // keeps each primitive compact, so rays can skip most of them.
+    if (numTriangles > PlyPrimitiveSize) {
+        ZoneScopedN("Sorting PLY triangles");
+        PhaseTimer timer(options.report, "mesh assembly");
+        const Vec3 boundsMin = vertexBounds.getMin();
+        const Vec3 boundsScale =
+            1.0f / glm::max(vertexBounds.getSize(), Vec3(1e-20f));
+        std::vector<std::uint64_t> keys(numTriangles);
+        forEachChunk(numTriangles, PlyChunkSize, options.pool, [&](
+                const std::size_t begin, const std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                const auto& positions = newMesh.triangles[i].positions;
+                const Vec3 centroid = (positions[0] + positions[1] + positions[2]) / 3.0f;
+                const std::uint32_t code = mortonCode((centroid - boundsMin) * boundsScale);
+                keys[i] = (std::uint64_t{code} << 32) | i;
+            }
+        });
+        std::ranges::sort(keys);
+
+        std::vector<Mesh::Triangle> sortedTriangles(numTriangles);
+        std::vector<float> sortedAreas(numTriangles);
+        forEachChunk(numTriangles, PlyChunkSize, options.pool, [&](
+                const std::size_t begin, const std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                const std::size_t triangleIdx = keys[i] & 0xffffffffu;
+                sortedTriangles[i] = newMesh.triangles[triangleIdx];
+                sortedAreas[i] = newMesh.triangleAreas[triangleIdx];
+            }
+        });
+        newMesh.triangles = std::move(sortedTriangles);
+        newMesh.triangleAreas = std::move(sortedAreas);
+    }
 
-            primitive.totalArea = std::accumulate(firstArea, lastArea, 0.0f);
-            newMesh.primitiveTriangleDistibutions.emplace_back(firstArea, lastArea);
+    struct PrimitiveImport {
+        std::size_t startIdx;
+        std::size_t count;
+        std::optional<BVH> bvh;
+        std::uint64_t geometryHash = 0;
+        bool isRebuilt = false;
+    };
+    std::vector<PrimitiveImport> primitiveImports;
+    for (std::size_t startIdx = 0; startIdx < numTriangles; startIdx += PlyPrimitiveSize) {
+        primitiveImports.emplace_back(
+            startIdx, std::min(PlyPrimitiveSize, numTriangles - startIdx));
+    }
+    forEachChunk(primitiveImports.size(), 1, options.pool, [&](
+            const std::size_t primitiveIdx, std::size_t) {
+        ZoneScopedN("Building PLY primitive BVH");
+        PhaseTimer timer(options.report, "bvh build");
+        PrimitiveImport& import = primitiveImports[primitiveIdx];
+        import.geometryHash = hashBytes(std::as_bytes(std::span(
+            newMesh.triangles.data() + import.startIdx, import.count)));
+        if (const Mesh::Primitive* previous = findUnchangedPrimitive(
+                options.previousScene, 0, primitiveIdx,
+                import.startIdx, import.count, import.geometryHash)) {
+            import.bvh.emplace(previous->bvh);
+            return;
         }
+        import.bvh.emplace(newMesh, import.startIdx, import.count);
+        import.isRebuilt = true;
+    });
+    if (options.previousScene) {
+        const auto numRebuilt = std::ranges::count_if(
+            primitiveImports, &PrimitiveImport::isRebuilt);
+        std::println(
+            "Rebuilt {} of {} primitive BVHs", numRebuilt, primitiveImports.size());
+    }
 
-        meshes.emplace_back(std::move(newMesh));
-        std::println("Loaded mesh name={}", mesh.name);
+    for (PrimitiveImport& import : primitiveImports) {
+        newMesh.addPrimitive(
+            import.startIdx, import.count, std::nullopt, std::move(*import.bvh));
+        newMesh.primitives.back().geometryHash = import.geometryHash;
+    }
+    {
+        PhaseTimer timer(options.report, "distributions");
+        computePrimitiveAreas(newMesh);
     }
 
+    std::println(
+        "Loaded mesh name={} triangles={} primitives={}",
+        newMesh.name, numTriangles, newMesh.primitives.size());
+    meshes.emplace_back(std::move(newMesh));
     return true;
 }
 
@@ -7,13 +7,18 @@
 #include <algorithm>
 #include <variant>
 #include <limits>
+#include <optional>
 
 #include "image.h"
 #include "material.h"
 #include "math.h"
 #include "mesh.h"
+#include "texture.h"
 #include "types.h"
 
+class StartupReport;
+class ThreadPool;
+
 struct Camera {
     Camera(
         int width, int height, float fov, float filmSize,
@@ -31,6 +36,10 @@ struct Camera {
     void move(Vec3 delta);
     void rotate(float yaw, float pitch);
 
+    /// The film position, in pixels, that `point` is seen at, or nothing if
+    /// it is not in front of the camera. The inverse of `Scene::eyeRay`.
+    [[nodiscard]] std::optional<Vec2> project(const Vec3& point) const;
+
     const int width;
     const int height;
     const float aspectRatio;
@@ -65,10 +74,12 @@ public:
     Camera camera;
     std::vector<Mesh> meshes;
     std::vector<Texture> textures;
-    std::vector<Image> images;
+    std::vector<TextureImage> images;
     std::vector<Light> lights;
 
 private:
+    friend class SceneCache;
+
     static inline const MaterialData DefaultMaterialData{};
     std::vector<MaterialData> materials;
 
@@ -80,17 +91,70 @@ public:
         Vec3 geometricNormal;
         Vec2 textureCoord;
         std::optional<std::size_t> materialIdx;
+        BVH::ShapeType shapeType = BVH::ShapeType::Triangle;
+        /// Texture coordinate units per world unit around the hit point.
+        float textureScale = 0.0f;
+    };
+
+    struct LoadOptions {
+        /// Replace tessellated spheres and rectangles with analytic shapes
+        /// for intersection and light sampling.
+        bool detectAnalyticShapes = true;
+        /// Decode textures the first time they are sampled instead of while
+        /// loading.
+        bool lazyTextures = false;
+        /// Used to decode textures in parallel with the rest of the scene,
+        /// if given.
+        ThreadPool* pool = nullptr;
+        /// If set, scenes are restored from snapshots in this directory when
+        /// the source file has not changed, and snapshots are written after
+        /// loading otherwise. See `SceneCache`.
+        std::optional<std::filesystem::path> cacheDirectory;
+        /// Earlier version of the same scene. Primitives whose geometry did
+        /// not change take their BVH from it instead of building a new one.
+        const Scene* previousScene = nullptr;
+        /// Receives the time spent in each loading phase, if given.
+        StartupReport* report = nullptr;
     };
 
+    /// Finds the closest hit along `ray`. `kind` is only used to count and
+    /// capture the ray.
     std::optional<HitInfo> intersect(
         const Ray& ray,
+        RayKind kind,
         float minDistance = 0.0f,
         float maxDistance = std::numeric_limits<float>::max()) const;
 
-    bool loadGltf(const std::filesystem::path& filePath);
+    /// Adds the contents of a .glb or binary .ply file to the scene, chosen
+    /// by the file's extension.
+    ///
+    /// PLY files hold a single mesh with the default material. Large meshes
+    /// are split into spatially coherent primitives of at most
+    /// `PlyPrimitiveSize` triangles, so their BVHs are built in parallel.
+    bool load(
+        const std::filesystem::path& filePath,
+        const LoadOptions& options = {});
+
+    static constexpr std::size_t PlyPrimitiveSize = std::size_t{1} << 18;
+
+    /// Adds the memory held by the geometry, BVHs, textures and light
+    /// distributions to `report`.
+    void addMemoryUsage(StartupReport& report) const;
+
+    /// Combines the `geometryHash` of every primitive, so processes that
+    /// loaded the same scene can tell.
+    [[nodiscard]] std::uint64_t geometryHash() const;
+
+    /// Takes everything but the camera from `other`, e.g. after reloading.
+    void replaceContents(Scene&& other);
 
     Ray eyeRay(Vec2 pixel) const;
 
+    /// Angle subtended by a pixel, used as the initial spread of ray cones.
+    float pixelSpreadAngle() const {
+        return camera.filmSize / (camera.distanceToFilm * camera.height);
+    }
+
     Material getMaterial(std::optional<std::size_t> materialIdx) const {
         if (!materialIdx)
             return Material(*this, DefaultMaterialData);
@@ -105,19 +169,21 @@ public:
         return getMaterial(mesh.primitives[primitiveIdx].materialIdx);
     }
 
-    Vec3 sampleTexture(std::size_t textureIdx, const Vec2& textureCoord) const {
+    /// Samples a texture filtered over `footprint`, the width of the shaded
+    /// area in texture coordinates. Zero samples the finest level.
+    Vec3 sampleTexture(
+            std::size_t textureIdx, const Vec2& textureCoord,
+            float footprint = 0.0f) const {
         assert(0 <= textureIdx && textureIdx < textures.size());
         const Texture& texture = textures[textureIdx];
-        const Image& image = images[texture.imageIdx];
-        if (image.empty())
-            return Vec3(1.0f);
-
-        // Repeating
-        std::size_t u = int(textureCoord.x * image.width()) % image.width();
-        std::size_t v = int(textureCoord.y * image.height()) % image.height();
-        if (u < 0) u += image.width();
-        if (v < 0) v += image.height();
-
-        return image.rgb(u, v);
+        return images[texture.imageIdx].sample(textureCoord, footprint);
     }
+
+private:
+    bool parseGltf(
+        const std::filesystem::path& filePath,
+        const LoadOptions& options);
+    bool parsePly(
+        const std::filesystem::path& filePath,
+        const LoadOptions& options);
 };
\ No newline at end of file
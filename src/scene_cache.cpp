@@ -0,0 +1,525 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#include "scene_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <optional>
+#include <print>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include "tracy/Tracy.hpp"
+
+#include "hash.h"
+#include "mapped_file.h"
+
+namespace {
+
+constexpr char Magic[8] = {'M', 'L', 'T', 'S', 'C', 'E', 'N', 'E'};
+
+/// Sizes of the structures stored as raw bytes, and the byte order. A
+/// snapshot written by a build with a different layout is rejected.
+struct Layout {
+    std::uint32_t meshTriangle = sizeof(Mesh::Triangle);
+    std::uint32_t bvhTriangle = sizeof(BVH::Triangle);
+    std::uint32_t bvhNode = sizeof(BVH::Node);
+    std::uint32_t aabb = sizeof(AABB);
+    std::uint32_t textureLevel = sizeof(TextureImage::Level);
+    std::uint32_t byteOrder = 0x01020304;
+
+    bool operator==(const Layout&) const = default;
+};
+
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t reserved;
+    std::uint64_t key;
+    Layout layout;
+};
+
+enum class ImageKind : std::uint8_t {
+    Decoded,
+    EncodedBytes,
+    EncodedFile
+};
+
+class SnapshotWriter {
+public:
+    template<typename T>
+    void value(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const auto* first = reinterpret_cast<const std::byte*>(&value);
+        _bytes.insert(_bytes.end(), first, first + sizeof(T));
+    }
+
+    template<typename T>
+    void optional(const std::optional<T>& value) {
+        this->value<std::uint8_t>(value.has_value());
+        if (value)
+            this->value(*value);
+    }
+
+    template<typename T>
+    void array(std::span<const T> values) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        value<std::uint64_t>(values.size());
+        const auto* first = reinterpret_cast<const std::byte*>(values.data());
+        _bytes.insert(_bytes.end(), first, first + values.size_bytes());
+    }
+
+    void string(std::string_view value) {
+        array(std::span(value.data(), value.size()));
+    }
+
+    const std::vector<std::byte>& bytes() const { return _bytes; }
+
+private:
+    std::vector<std::byte> _bytes;
+};
+
+/// Reads back what `SnapshotWriter` wrote. Running past the end of the data
+/// marks the reader as failed instead of reading out of bounds.
+class SnapshotReader {
+public:
+    explicit SnapshotReader(std::span<const std::byte> bytes) : _bytes(bytes) {}
+
+    [[nodiscard]] bool failed() const { return _failed; }
+    void fail() { _failed = true; }
+
+    /// Reads a number of elements, each taking at least one byte.
+    std::size_t count() {
+        const auto result = value<std::uint64_t>();
+        if (result > _bytes.size() - _offset) {
+            _failed = true;
+            return 0;
+        }
+        return result;
+    }
+
+    template<typename T>
+    T value() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T result{};
+        read(&result, sizeof(T));
+        return result;
+    }
+
+    template<typename T>
+    std::optional<T> optional() {
+        if (!value<std::uint8_t>())
+            return std::nullopt;
+        return value<T>();
+    }
+
+    template<typename T>
+    std::vector<T> array() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const auto size = value<std::uint64_t>();
+        if (_failed || size > (_bytes.size() - _offset) / sizeof(T)) {
+            _failed = true;
+            return {};
+        }
+        std::vector<T> result(size);
+        read(result.data(), size * sizeof(T));
+        return result;
+    }
+
+    std::string string() {
+        const std::vector<char> characters = array<char>();
+        return std::string(characters.begin(), characters.end());
+    }
+
+private:
+    void read(void* target, std::size_t size) {
+        if (_failed || size > _bytes.size() - _offset) {
+            _failed = true;
+            return;
+        }
+        std::memcpy(target, _bytes.data() + _offset, size);
+        _offset += size;
+    }
+
+    std::span<const std::byte> _bytes;
+    std::size_t _offset = 0;
+    bool _failed = false;
+};
+
+void writeShape(SnapshotWriter& writer, const BVH::AnalyticShape& shape) {
+    writer.value<std::uint8_t>(shape.index());
+    std::visit([&](const auto& value) { writer.value(value); }, shape);
+}
+
+std::optional<BVH::AnalyticShape> readShape(SnapshotReader& reader) {
+    switch (reader.value<std::uint8_t>()) {
+    case 0:
+        return reader.value<Sphere>();
+    case 1:
+        return reader.value<Quad>();
+    default:
+        reader.fail();
+        return std::nullopt;
+    }
+}
+
+} // namespace
+
+std::optional<std::uint64_t> SceneCache::computeKey(
+        const std::filesystem::path& sourceFile,
+        const Scene::LoadOptions& options) {
+    ZoneScoped;
+    MappedFile file;
+    if (!file.open(sourceFile))
+        return std::nullopt;
+    std::uint64_t seed = Version;
+    seed = seed * 2 + options.detectAnalyticShapes;
+    seed = seed * 2 + options.lazyTextures;
+    return hashBytes(file.bytes(), seed);
+}
+
+std::filesystem::path SceneCache::snapshotPath(
+        const std::filesystem::path& directory, const std::uint64_t key) {
+    return directory / std::format("{:016x}.mltscene", key);
+}
+
+bool SceneCache::save(
+        const Scene& scene, const std::filesystem::path& fileName,
+        const std::uint64_t key) {
+    ZoneScoped;
+    SnapshotWriter writer;
+    Header header{.version = Version, .reserved = 0, .key = key, .layout = {}};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    writer.value(header);
+
+    writer.value(scene.camera.position);
+    writer.value(scene.camera.forward);
+    writer.value(scene.camera.up);
+    writer.value(scene.camera.right);
+
+    writer.value<std::uint64_t>(scene.materials.size());
+    for (const MaterialData& material : scene.materials) {
+        writer.string(material.name);
+        writer.value(material.baseColorFactor);
+        writer.optional(material.baseColorTextureIdx);
+        writer.value(material.metallicFactor);
+        writer.value(material.roughnessFactor);
+        writer.optional(material.metallicRoughnessTextureIdx);
+        writer.value(material.emissiveFactor);
+        writer.value(material.emissiveStrength);
+        writer.optional(material.emissiveTextureIdx);
+        writer.value(material.transmissionFactor);
+        writer.optional(material.transmissionTextureIdx);
+        writer.value(material.ior);
+    }
+
+    writer.array(std::span(scene.textures));
+
+    // Images that have not been decoded yet are stored encoded, so they stay
+    // lazy when the snapshot is loaded.
+    writer.value<std::uint64_t>(scene.images.size());
+    for (const TextureImage& image : scene.images) {
+        const auto& deferred = image._deferred;
+        if (deferred && !deferred->isDecoded.load(std::memory_order_acquire)) {
+            if (const auto* path = std::get_if<std::filesystem::path>(&deferred->source)) {
+                writer.value(ImageKind::EncodedFile);
+                writer.string(path->string());
+            } else {
+                writer.value(ImageKind::EncodedBytes);
+                writer.array(std::span<const std::byte>(
+                    std::get<std::vector<std::byte>>(deferred->source)));
+            }
+            continue;
+        }
+        writer.value(ImageKind::Decoded);
+        writer.value(image._format);
+        writer.value(image._channels);
+        writer.array(std::span(image._levels));
+        writer.array(std::span(image._bytes));
+        writer.array(std::span(image._floats));
+    }
+
+    writer.value<std::uint64_t>(scene.lights.size());
+    for (const Light& light : scene.lights) {
+        writer.value<std::uint8_t>(light.index());
+        std::visit([&](const auto& value) { writer.value(value); }, light);
+    }
+
+    writer.value<std::uint64_t>(scene.meshes.size());
+    for (const Mesh& mesh : scene.meshes) {
+        writer.string(mesh.name);
+        writer.array(std::span(mesh.triangles));
+        writer.array(std::span(mesh.triangleAreas));
+        writer.value<std::uint64_t>(mesh.primitives.size());
+        for (const Mesh::Primitive& primitive : mesh.primitives) {
+            writer.value<std::uint64_t>(primitive.startIdx);
+            writer.value<std::uint64_t>(primitive.count);
+            writer.optional(primitive.materialIdx);
+            writer.value(primitive.totalArea);
+            writer.value(primitive.geometryHash);
+            writer.optional(primitive.quad);
+            writer.array(std::span(primitive.bvh.triangles));
+            writer.array(std::span(primitive.bvh.nodes));
+            writer.value(primitive.bvh.rootBounds);
+            writer.value<std::uint8_t>(primitive.bvh.shape.has_value());
+            if (primitive.bvh.shape)
+                writeShape(writer, *primitive.bvh.shape);
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(fileName.parent_path(), error);
+    const std::filesystem::path temporaryFileName = std::format(
+        "{}.{:08x}.tmp", fileName.string(), std::random_device()());
+    {
+        std::ofstream file(temporaryFileName, std::ios::binary);
+        file.write(
+            reinterpret_cast<const char*>(writer.bytes().data()),
+            writer.bytes().size());
+        if (!file) {
+            std::println(stderr, "Failed to write scene cache: {}", fileName.string());
+            file.close();
+            std::filesystem::remove(temporaryFileName, error);
+            return false;
+        }
+    }
+    std::filesystem::rename(temporaryFileName, fileName, error);
+    if (error) {
+        std::println(stderr, "Failed to write scene cache: {}", fileName.string());
+        std::filesystem::remove(temporaryFileName, error);
+        return false;
+    }
+    std::println(
+        "Saved scene cache {} ({:.1f} MiB)",
+        fileName.string(), writer.bytes().size() / (1024.0 * 1024.0));
+    return true;
+}
+
+bool SceneCache::isConsistent(
+        const std::vector<MaterialData>& materials,
+        const std::vector<Texture>& textures,
+        const std::vector<TextureImage>& images,
+        const std::vector<Light>& lights,
+        const std::vector<Mesh>& meshes) {
+    const auto isIndexValid = [](const std::optional<std::size_t>& idx, std::size_t size) {
+        return !idx || *idx < size;
+    };
+    for (const MaterialData& material : materials) {
+        if (!isIndexValid(material.baseColorTextureIdx, textures.size()) ||
+                !isIndexValid(material.metallicRoughnessTextureIdx, textures.size()) ||
+                !isIndexValid(material.emissiveTextureIdx, textures.size()) ||
+                !isIndexValid(material.transmissionTextureIdx, textures.size()))
+            return false;
+    }
+    for (const Texture& texture : textures) {
+        if (texture.imageIdx >= images.size())
+            return false;
+    }
+
+    // Deferred images, and images that failed to decode, have no levels.
+    for (const TextureImage& image : images) {
+        if (image._levels.empty())
+            continue;
+        if (image._channels < 1 || image._channels > 4)
+            return false;
+        std::size_t storageSize = 0;
+        switch (image._format) {
+        case TextureImage::Format::SRGB8:   storageSize = image._bytes.size(); break;
+        case TextureImage::Format::Float32: storageSize = image._floats.size(); break;
+        default:                            return false;
+        }
+        const std::size_t numTexels = storageSize / image._channels;
+        for (const TextureImage::Level& level : image._levels) {
+            const TextureImage::Level expected =
+                TextureImage::makeLevel(level.width, level.height, level.offset);
+            if (level.width == 0 || level.height == 0 ||
+                    level.tilesPerRow != expected.tilesPerRow ||
+                    level.numTiles != expected.numTiles ||
+                    level.offset > numTexels ||
+                    level.numTiles > (numTexels - level.offset) / TextureImage::TexelsPerTile)
+                return false;
+        }
+    }
+
+    for (const Mesh& mesh : meshes) {
+        for (const Mesh::Primitive& primitive : mesh.primitives) {
+            if (!isIndexValid(primitive.materialIdx, materials.size()))
+                return false;
+            const BVH& bvh = primitive.bvh;
+            if (!bvh.shape && bvh.nodes.empty())
+                return false;
+            for (const BVH::Triangle& triangle : bvh.triangles) {
+                if (triangle.idx >= mesh.triangles.size())
+                    return false;
+            }
+            // Children are always stored after their parent, which also
+            // rules out cycles.
+            for (std::size_t nodeIdx = 0; nodeIdx < bvh.nodes.size(); ++nodeIdx) {
+                const BVH::Node& node = bvh.nodes[nodeIdx];
+                const std::size_t first = node.idx;
+                if (node.isLeaf()
+                        ? first + node.numTriangles > bvh.triangles.size()
+                        : first <= nodeIdx || first + 4 > bvh.nodes.size())
+                    return false;
+            }
+        }
+    }
+
+    for (const Light& light : lights) {
+        const auto* meshLight = std::get_if<MeshLight>(&light);
+        if (meshLight && (meshLight->meshIdx >= meshes.size() ||
+                meshLight->primitiveIdx >= meshes[meshLight->meshIdx].primitives.size()))
+            return false;
+    }
+    return true;
+}
+
+bool SceneCache::load(
+        Scene& scene, const std::filesystem::path& fileName,
+        const std::uint64_t key) {
+    ZoneScoped;
+    std::error_code error;
+    if (!std::filesystem::exists(fileName, error))
+        return false;
+    MappedFile file;
+    if (!file.open(fileName))
+        return false;
+    SnapshotReader reader(file.bytes());
+
+    const auto header = reader.value<Header>();
+    if (reader.failed() ||
+            std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 ||
+            header.version != Version || header.key != key ||
+            header.layout != Layout{}) {
+        std::println("Ignoring stale scene cache {}", fileName.string());
+        return false;
+    }
+
+    const Vec3 position = reader.value<Vec3>();
+    const Vec3 forward = reader.value<Vec3>();
+    const Vec3 up = reader.value<Vec3>();
+    const Vec3 right = reader.value<Vec3>();
+
+    std::vector<MaterialData> materials(reader.count());
+    for (MaterialData& material : materials) {
+        if (reader.failed())
+            break;
+        material.name = reader.string();
+        material.baseColorFactor = reader.value<Vec4>();
+        material.baseColorTextureIdx = reader.optional<std::size_t>();
+        material.metallicFactor = reader.value<float>();
+        material.roughnessFactor = reader.value<float>();
+        material.metallicRoughnessTextureIdx = reader.optional<std::size_t>();
+        material.emissiveFactor = reader.value<Vec3>();
+        material.emissiveStrength = reader.value<float>();
+        material.emissiveTextureIdx = reader.optional<std::size_t>();
+        material.transmissionFactor = reader.value<float>();
+        material.transmissionTextureIdx = reader.optional<std::size_t>();
+        material.ior = reader.value<float>();
+    }
+
+    std::vector<Texture> textures = reader.array<Texture>();
+
+    std::vector<TextureImage> images(reader.count());
+    for (TextureImage& image : images) {
+        if (reader.failed())
+            break;
+        switch (reader.value<ImageKind>()) {
+        case ImageKind::Decoded:
+            image._format = reader.value<TextureImage::Format>();
+            image._channels = reader.value<int>();
+            image._levels = reader.array<TextureImage::Level>();
+            image._bytes = reader.array<std::uint8_t>();
+            image._floats = reader.array<float>();
+            image._id = TextureImage::NextId++;
+            break;
+        case ImageKind::EncodedBytes:
+            image.defer(reader.array<std::byte>());
+            break;
+        case ImageKind::EncodedFile:
+            image.defer(std::filesystem::path(reader.string()));
+            break;
+        default:
+            reader.fail();
+            break;
+        }
+    }
+
+    std::vector<Light> lights(reader.count());
+    for (Light& light : lights) {
+        if (reader.failed())
+            break;
+        if (reader.value<std::uint8_t>() == 0)
+            light = reader.value<PointLight>();
+        else
+            light = reader.value<MeshLight>();
+    }
+
+    std::vector<Mesh> meshes(reader.count());
+    for (Mesh& mesh : meshes) {
+        if (reader.failed())
+            break;
+        mesh.name = reader.string();
+        mesh.triangles = reader.array<Mesh::Triangle>();
+        mesh.triangleAreas = reader.array<float>();
+        const auto numPrimitives = reader.count();
+        for (std::uint64_t i = 0; i < numPrimitives && !reader.failed(); ++i) {
+            const auto startIdx = reader.value<std::uint64_t>();
+            const auto count = reader.value<std::uint64_t>();
+            const auto materialIdx = reader.optional<std::size_t>();
+            const auto totalArea = reader.value<float>();
+            const auto geometryHash = reader.value<std::uint64_t>();
+            const auto quad = reader.optional<Quad>();
+            BVH bvh;
+            bvh.triangles = reader.array<BVH::Triangle>();
+            bvh.nodes = reader.array<BVH::Node>();
+            bvh.rootBounds = reader.value<AABB>();
+            if (reader.value<std::uint8_t>())
+                bvh.shape = readShape(reader);
+            if (startIdx + count > mesh.triangleAreas.size() ||
+                    mesh.triangleAreas.size() != mesh.triangles.size()) {
+                std::println(stderr, "Corrupt scene cache {}", fileName.string());
+                return false;
+            }
+            Mesh::Primitive& primitive = mesh.primitives.emplace_back(
+                startIdx, count, materialIdx, std::move(bvh));
+            primitive.totalArea = totalArea;
+            primitive.geometryHash = geometryHash;
+            primitive.quad = quad;
+            const auto firstArea = mesh.triangleAreas.begin() + startIdx;
+            mesh.primitiveTriangleDistibutions.emplace_back(
+                firstArea, firstArea + count);
+        }
+    }
+
+    if (reader.failed() ||
+            !isConsistent(materials, textures, images, lights, meshes)) {
+        std::println(stderr, "Corrupt scene cache {}", fileName.string());
+        return false;
+    }
+
+    scene.camera.position = position;
+    scene.camera.forward = forward;
+    scene.camera.up = up;
+    scene.camera.right = right;
+    scene.materials = std::move(materials);
+    scene.textures = std::move(textures);
+    scene.images = std::move(images);
+    scene.lights = std::move(lights);
+    scene.meshes = std::move(meshes);
+    std::println(
+        "Loaded scene cache {}: {} meshes, {} images, {} lights",
+        fileName.string(), scene.meshes.size(), scene.images.size(),
+        scene.lights.size());
+    return true;
+}
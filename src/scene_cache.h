@@ -0,0 +1,62 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+#include "scene.h"
+
+/// Binary snapshot of a fully loaded scene: flattened geometry with built
+/// BVHs, materials, textures with their mip chains and lights. Loading a
+/// snapshot skips parsing, decoding and BVH construction entirely.
+///
+/// Snapshots are keyed by a hash of the source file's contents and of the
+/// load options that change the result, and carry a format version and the
+/// layout of the raw structures they contain. A snapshot that does not match
+/// in any of these is ignored.
+class SceneCache {
+public:
+    /// Bump whenever the format or anything baked into it changes, e.g. the
+    /// BVH builder or the analytic shape detection.
+    static constexpr std::uint32_t Version = 2;
+
+    /// Hashes the contents of `sourceFile` together with `options`. Returns
+    /// `std::nullopt` if the file cannot be read.
+    static std::optional<std::uint64_t> computeKey(
+        const std::filesystem::path& sourceFile,
+        const Scene::LoadOptions& options);
+
+    /// Path of the snapshot for `key` inside `directory`.
+    static std::filesystem::path snapshotPath(
+        const std::filesystem::path& directory, std::uint64_t key);
+
+    /// Writes a snapshot of `scene`. The file is written next to its final
+    /// location and then renamed, so concurrent readers never see a partial
+    /// snapshot.
+    static bool save(
+        const Scene& scene, const std::filesystem::path& fileName,
+        std::uint64_t key);
+
+    /// Replaces the contents of `scene`, which must be empty, with the
+    /// snapshot in `fileName`. Returns false, leaving `scene` empty, if there
+    /// is no valid snapshot for `key`.
+    static bool load(
+        Scene& scene, const std::filesystem::path& fileName,
+        std::uint64_t key);
+
+private:
+    /// Checks every index and offset a decoded snapshot refers to, so a
+    /// corrupt snapshot that still parses is treated as a miss instead of
+    /// being trusted by the renderer.
+    static bool isConsistent(
+        const std::vector<MaterialData>& materials,
+        const std::vector<Texture>& textures,
+        const std::vector<TextureImage>& images,
+        const std::vector<Light>& lights,
+        const std::vector<Mesh>& meshes);
+};
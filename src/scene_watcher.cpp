@@ -0,0 +1,97 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#include "scene_watcher.h"
+
+#include <optional>
+#include <print>
+#include <system_error>
+
+#include "tracy/Tracy.hpp"
+
+#include "threadpool.h"
+
+SceneWatcher::SceneWatcher(
+        std::filesystem::path filePath, Scene::LoadOptions options,
+        const Scene& scene, const int numJobs)
+    : _filePath(std::move(filePath)),
+      _options(std::move(options)),
+      _scene(scene),
+      _camera(scene.camera),
+      _numJobs(numJobs) {
+    _thread = std::thread(std::bind_front(&SceneWatcher::watchLoop, this));
+}
+
+SceneWatcher::~SceneWatcher() {
+    {
+        std::lock_guard lock(_mutex);
+        _stopping = true;
+    }
+    _stopCV.notify_all();
+    _thread.join();
+}
+
+bool SceneWatcher::applyReload(const std::function<void(Scene&&)>& apply) {
+    std::lock_guard lock(_mutex);
+    if (!_reloadedScene)
+        return false;
+    apply(std::move(*_reloadedScene));
+    _reloadedScene.reset();
+    return true;
+}
+
+std::filesystem::file_time_type SceneWatcher::lastWriteTime() const {
+    std::error_code error;
+    const auto time = std::filesystem::last_write_time(_filePath, error);
+    return error ? std::filesystem::file_time_type::min() : time;
+}
+
+void SceneWatcher::watchLoop() {
+    tracy::SetThreadName("Scene Watcher");
+    std::filesystem::file_time_type loadedTime = lastWriteTime();
+    std::filesystem::file_time_type previousTime = loadedTime;
+    while (true) {
+        {
+            std::unique_lock lock(_mutex);
+            if (_stopCV.wait_for(lock, PollInterval, [&] { return _stopping; }))
+                break;
+            // Wait for the last reload to be applied, since the next one
+            // reads the scene it went into.
+            if (_reloadedScene)
+                continue;
+        }
+
+        // Only reload once the file has stopped changing, so a save in
+        // progress is not picked up.
+        const std::filesystem::file_time_type time = lastWriteTime();
+        const bool isStable = time == previousTime;
+        previousTime = time;
+        if (time == loadedTime || !isStable ||
+                time == std::filesystem::file_time_type::min())
+            continue;
+        loadedTime = time;
+
+        ZoneScopedN("Reloading scene");
+        std::println("Reloading {}", _filePath.string());
+        const auto startTime = std::chrono::steady_clock::now();
+        auto reloadedScene = std::make_unique<Scene>(_camera);
+        Scene::LoadOptions options = _options;
+        options.previousScene = &_scene;
+        std::optional<ThreadPool> pool;
+        if (_numJobs > 1) {
+            pool.emplace(_numJobs);
+            options.pool = &pool.value();
+        }
+        if (!reloadedScene->load(_filePath, options)) {
+            std::println(stderr, "Keeping the current scene");
+            continue;
+        }
+        const std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - startTime;
+        std::println("Reloaded {} in {:.3f}s", _filePath.string(), elapsed.count());
+
+        std::lock_guard lock(_mutex);
+        _reloadedScene = std::move(reloadedScene);
+    }
+}
@@ -0,0 +1,56 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "scene.h"
+
+/// Watches a scene file and reloads it in the background whenever it is
+/// saved. Primitives whose geometry did not change keep their BVHs, so edits
+/// to materials and lights only cost a parse.
+class SceneWatcher {
+public:
+    static constexpr auto PollInterval = std::chrono::milliseconds(500);
+
+    /// `scene` must have been loaded from `filePath` with `options`. Reloads
+    /// use a pool of `numJobs` threads while they run.
+    SceneWatcher(
+        std::filesystem::path filePath, Scene::LoadOptions options,
+        const Scene& scene, int numJobs);
+    ~SceneWatcher();
+
+    SceneWatcher(const SceneWatcher&) = delete;
+    SceneWatcher& operator=(const SceneWatcher&) = delete;
+
+    /// If a reload finished since the last call, passes the new scene to
+    /// `apply`, which should move it into the watched scene while nothing is
+    /// rendering it. No reload runs while `apply` does.
+    bool applyReload(const std::function<void(Scene&&)>& apply);
+
+private:
+    void watchLoop();
+    std::filesystem::file_time_type lastWriteTime() const;
+
+    std::filesystem::path _filePath;
+    Scene::LoadOptions _options;
+    const Scene& _scene;
+    /// Reloaded scenes start from the camera the scene was loaded with,
+    /// since the live camera may be moving.
+    Camera _camera;
+    int _numJobs;
+
+    bool _stopping = false;
+    std::mutex _mutex;
+    std::condition_variable _stopCV;
+    std::unique_ptr<Scene> _reloadedScene;
+    std::thread _thread;
+};
@@ -0,0 +1,64 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#include "shapes.h"
+
+#include <cmath>
+
+AABB Quad::bounds() const {
+    AABB result;
+    result.fit(corner);
+    result.fit(corner + edge0);
+    result.fit(corner + edge1);
+    result.fit(corner + edge0 + edge1);
+    return result;
+}
+
+std::optional<float> Quad::intersect(
+        const Ray& ray, float minDistance, float maxDistance) const {
+    constexpr float Epsilon = 5e-7f;
+    const Vec3 planeNormal = cross(edge0, edge1);
+    const float denominator = dot(planeNormal, ray.d);
+    if (std::abs(denominator) < Epsilon)
+        return std::nullopt; // The ray is parallel to the quad.
+
+    const float t = dot(planeNormal, corner - ray.o) / denominator;
+    if (t < minDistance || t > maxDistance)
+        return std::nullopt;
+
+    // Coordinates of the hit point along each edge.
+    const Vec3 offset = ray.o + ray.d * t - corner;
+    const float u = dot(offset, edge0) / dot(edge0, edge0);
+    const float v = dot(offset, edge1) / dot(edge1, edge1);
+    if (u < 0 || u > 1 || v < 0 || v > 1)
+        return std::nullopt;
+    return t;
+}
+
+AABB Sphere::bounds() const {
+    AABB result;
+    result.fit(center - Vec3(radius));
+    result.fit(center + Vec3(radius));
+    return result;
+}
+
+std::optional<float> Sphere::intersect(
+        const Ray& ray, float minDistance, float maxDistance) const {
+    const Vec3 offset = ray.o - center;
+    const float a = dot(ray.d, ray.d);
+    const float halfB = dot(offset, ray.d);
+    const float c = dot(offset, offset) - radius * radius;
+    const float discriminant = halfB * halfB - a * c;
+    if (discriminant < 0.0f)
+        return std::nullopt;
+
+    const float sqrtDiscriminant = std::sqrt(discriminant);
+    const float nearT = (-halfB - sqrtDiscriminant) / a;
+    if (nearT >= minDistance && nearT <= maxDistance)
+        return nearT;
+    const float farT = (-halfB + sqrtDiscriminant) / a;
+    if (farT >= minDistance && farT <= maxDistance)
+        return farT;
+    return std::nullopt;
+}
@@ -0,0 +1,43 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#pragma once
+
+#include <optional>
+
+#include "aabb.h"
+#include "math.h"
+#include "ray.h"
+#include "types.h"
+
+/// A planar parallelogram spanned by two edges leaving a shared corner.
+struct Quad {
+    Vec3 corner;
+    Vec3 edge0;
+    Vec3 edge1;
+
+    Vec3 normal() const { return normalize(cross(edge0, edge1)); }
+    float area() const { return length(cross(edge0, edge1)); }
+    AABB bounds() const;
+
+    /// @returns
+    ///     The distance to the intersection point if there is one within
+    ///     `[minDistance, maxDistance]`, `std::nullopt` otherwise.
+    std::optional<float> intersect(
+        const Ray& ray, float minDistance, float maxDistance) const;
+};
+
+struct Sphere {
+    Vec3 center;
+    float radius;
+
+    float area() const { return 4.0f * PI * radius * radius; }
+    AABB bounds() const;
+
+    /// @returns
+    ///     The distance to the closest intersection point within
+    ///     `[minDistance, maxDistance]`, `std::nullopt` otherwise.
+    std::optional<float> intersect(
+        const Ray& ray, float minDistance, float maxDistance) const;
+};
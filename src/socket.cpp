@@ -0,0 +1,261 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#include "socket.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <print>
+#include <utility>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#if defined(_WIN32)
+using NativeSocket = SOCKET;
+constexpr std::intptr_t InvalidHandle = static_cast<std::intptr_t>(INVALID_SOCKET);
+
+/// Winsock has to be started once before any other call.
+bool startNetworking() {
+    static const bool isStarted = [] {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    return isStarted;
+}
+
+std::string lastError() {
+    return std::to_string(WSAGetLastError());
+}
+
+void closeNative(NativeSocket socket) {
+    closesocket(socket);
+}
+#else
+using NativeSocket = int;
+constexpr std::intptr_t InvalidHandle = -1;
+
+bool startNetworking() {
+    return true;
+}
+
+std::string lastError() {
+    return std::strerror(errno);
+}
+
+void closeNative(NativeSocket socket) {
+    ::close(socket);
+}
+#endif
+
+NativeSocket native(std::intptr_t handle) {
+    return static_cast<NativeSocket>(handle);
+}
+
+/// Sends small messages right away instead of waiting to fill a packet.
+void disableNagle(NativeSocket socket) {
+    int enable = 1;
+    setsockopt(
+        socket, IPPROTO_TCP, TCP_NODELAY,
+        reinterpret_cast<const char*>(&enable), sizeof(enable));
+}
+
+} // namespace
+
+Socket::~Socket() {
+    close();
+}
+
+Socket::Socket(Socket&& other) noexcept {
+    *this = std::move(other);
+}
+
+Socket& Socket::operator=(Socket&& other) noexcept {
+    if (this != &other) {
+        close();
+        _handle = std::exchange(other._handle, InvalidHandle);
+    }
+    return *this;
+}
+
+std::optional<Socket> Socket::connect(const std::string& host, std::uint16_t port) {
+    if (!startNetworking()) {
+        std::println(stderr, "Failed to start networking");
+        return std::nullopt;
+    }
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    const std::string service = std::to_string(port);
+    if (const int error = getaddrinfo(host.c_str(), service.c_str(), &hints, &addresses)) {
+        std::println(stderr, "Failed to resolve {}: {}", host, gai_strerror(error));
+        return std::nullopt;
+    }
+    Socket socket;
+    for (const addrinfo* address = addresses; address; address = address->ai_next) {
+        const NativeSocket handle = ::socket(
+            address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (static_cast<std::intptr_t>(handle) == InvalidHandle)
+            continue;
+        if (::connect(handle, address->ai_addr, static_cast<int>(address->ai_addrlen)) == 0) {
+            socket._handle = static_cast<std::intptr_t>(handle);
+            break;
+        }
+        closeNative(handle);
+    }
+    freeaddrinfo(addresses);
+    if (!socket.isOpen()) {
+        std::println(stderr, "Failed to connect to {}:{}: {}", host, port, lastError());
+        return std::nullopt;
+    }
+    disableNagle(native(socket._handle));
+    return socket;
+}
+
+std::optional<Socket> Socket::listen(std::uint16_t port) {
+    if (!startNetworking()) {
+        std::println(stderr, "Failed to start networking");
+        return std::nullopt;
+    }
+    Socket socket;
+    socket._handle = static_cast<std::intptr_t>(::socket(AF_INET, SOCK_STREAM, 0));
+    if (!socket.isOpen()) {
+        std::println(stderr, "Failed to create a socket: {}", lastError());
+        return std::nullopt;
+    }
+    // Lets a restarted coordinator take the port over right away.
+    int enable = 1;
+    setsockopt(
+        native(socket._handle), SOL_SOCKET, SO_REUSEADDR,
+        reinterpret_cast<const char*>(&enable), sizeof(enable));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (::bind(native(socket._handle), reinterpret_cast<const sockaddr*>(&address),
+            sizeof(address)) != 0 ||
+            ::listen(native(socket._handle), SOMAXCONN) != 0) {
+        std::println(stderr, "Failed to listen on port {}: {}", port, lastError());
+        return std::nullopt;
+    }
+    return socket;
+}
+
+std::optional<Socket> Socket::accept(
+        std::optional<std::chrono::milliseconds> timeout) {
+    if (timeout) {
+        fd_set handles;
+        FD_ZERO(&handles);
+        FD_SET(native(_handle), &handles);
+        const auto seconds = std::chrono::floor<std::chrono::seconds>(*timeout);
+        timeval time{};
+        time.tv_sec = static_cast<decltype(time.tv_sec)>(seconds.count());
+        time.tv_usec = static_cast<decltype(time.tv_usec)>(
+            std::chrono::microseconds(*timeout - seconds).count());
+        const int numReady = ::select(
+            static_cast<int>(native(_handle)) + 1, &handles, nullptr, nullptr, &time);
+        if (numReady == 0) {
+            std::println(stderr, "No connection within {}s",
+                std::chrono::duration<double>(*timeout).count());
+            return std::nullopt;
+        }
+        if (numReady < 0) {
+            std::println(stderr, "Failed to accept a connection: {}", lastError());
+            return std::nullopt;
+        }
+    }
+    const NativeSocket handle = ::accept(native(_handle), nullptr, nullptr);
+    if (static_cast<std::intptr_t>(handle) == InvalidHandle) {
+        std::println(stderr, "Failed to accept a connection: {}", lastError());
+        return std::nullopt;
+    }
+    Socket socket;
+    socket._handle = static_cast<std::intptr_t>(handle);
+    disableNagle(handle);
+    return socket;
+}
+
+bool Socket::sendAll(std::span<const std::byte> bytes) {
+#if defined(_WIN32)
+    constexpr int Flags = 0;
+#else
+    // A closed peer should fail the call, not raise SIGPIPE.
+    constexpr int Flags = MSG_NOSIGNAL;
+#endif
+    while (!bytes.empty()) {
+        const auto size = static_cast<int>(std::min<std::size_t>(bytes.size(), 1 << 30));
+        const auto numSent = ::send(
+            native(_handle), reinterpret_cast<const char*>(bytes.data()), size, Flags);
+        if (numSent <= 0)
+            return false;
+        bytes = bytes.subspan(static_cast<std::size_t>(numSent));
+    }
+    return true;
+}
+
+bool Socket::receiveAll(std::span<std::byte> bytes) {
+    while (!bytes.empty()) {
+        const auto size = static_cast<int>(std::min<std::size_t>(bytes.size(), 1 << 30));
+        const auto numReceived = ::recv(
+            native(_handle), reinterpret_cast<char*>(bytes.data()), size, 0);
+        if (numReceived <= 0)
+            return false;
+        bytes = bytes.subspan(static_cast<std::size_t>(numReceived));
+    }
+    return true;
+}
+
+bool Socket::setReceiveTimeout(std::chrono::milliseconds timeout) {
+#if defined(_WIN32)
+    const DWORD time = static_cast<DWORD>(timeout.count());
+#else
+    const auto seconds = std::chrono::floor<std::chrono::seconds>(timeout);
+    timeval time{};
+    time.tv_sec = static_cast<decltype(time.tv_sec)>(seconds.count());
+    time.tv_usec = static_cast<decltype(time.tv_usec)>(
+        std::chrono::microseconds(timeout - seconds).count());
+#endif
+    if (setsockopt(
+            native(_handle), SOL_SOCKET, SO_RCVTIMEO,
+            reinterpret_cast<const char*>(&time), sizeof(time)) != 0) {
+        std::println(stderr, "Failed to set a receive timeout: {}", lastError());
+        return false;
+    }
+    return true;
+}
+
+void Socket::close() {
+    if (!isOpen())
+        return;
+    closeNative(native(_handle));
+    _handle = InvalidHandle;
+}
+
+bool Socket::isOpen() const {
+    return _handle != InvalidHandle;
+}
+
+std::uint16_t Socket::localPort() const {
+    sockaddr_in address{};
+    socklen_t size = sizeof(address);
+    if (getsockname(native(_handle), reinterpret_cast<sockaddr*>(&address), &size) != 0)
+        return 0;
+    return ntohs(address.sin_port);
+}
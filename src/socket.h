@@ -0,0 +1,54 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+
+/// A blocking TCP connection, or a socket listening for them.
+class Socket {
+public:
+    Socket() = default;
+    ~Socket();
+
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+    Socket(Socket&& other) noexcept;
+    Socket& operator=(Socket&& other) noexcept;
+
+    /// Connects to `port` of `host`, a name or address. Prints the reason
+    /// and returns nothing if that fails.
+    static std::optional<Socket> connect(const std::string& host, std::uint16_t port);
+    /// Listens on `port` of every interface, or on a free port if it is 0.
+    /// Prints the reason and returns nothing if that fails.
+    static std::optional<Socket> listen(std::uint16_t port);
+
+    /// Waits for the next connection to a listening socket, for at most
+    /// `timeout` if given. Prints the reason and returns nothing if none
+    /// came.
+    std::optional<Socket> accept(
+        std::optional<std::chrono::milliseconds> timeout = std::nullopt);
+
+    /// Sends or receives exactly `bytes`. Return false if the connection
+    /// closed or failed first.
+    bool sendAll(std::span<const std::byte> bytes);
+    bool receiveAll(std::span<std::byte> bytes);
+    /// Makes `receiveAll` fail once nothing arrived for `timeout`.
+    bool setReceiveTimeout(std::chrono::milliseconds timeout);
+
+    void close();
+
+    [[nodiscard]] bool isOpen() const;
+    /// The port the socket is bound to.
+    [[nodiscard]] std::uint16_t localPort() const;
+
+private:
+    /// A SOCKET on Windows and a file descriptor elsewhere.
+    std::intptr_t _handle = -1;
+};
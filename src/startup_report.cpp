@@ -0,0 +1,135 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#include "startup_report.h"
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <print>
+#include <sstream>
+
+#include "json.h"
+
+namespace {
+
+constexpr double BytesPerMiB = 1024.0 * 1024.0;
+
+} // namespace
+
+void StartupReport::addPhase(std::string_view name, const double seconds) {
+    std::lock_guard lock(_mutex);
+    auto it = std::ranges::find(_phases, name, &Phase::name);
+    if (it == _phases.end())
+        it = _phases.insert(it, Phase{.name = std::string(name)});
+    it->seconds += seconds;
+    ++it->count;
+}
+
+void StartupReport::addMemory(std::string_view subsystem, const std::size_t bytes) {
+    std::lock_guard lock(_mutex);
+    auto it = std::ranges::find(_memory, subsystem, &Memory::subsystem);
+    if (it == _memory.end())
+        it = _memory.insert(it, Memory{.subsystem = std::string(subsystem)});
+    it->bytes += bytes;
+}
+
+double StartupReport::phaseSeconds(std::string_view name) const {
+    std::lock_guard lock(_mutex);
+    const auto it = std::ranges::find(_phases, name, &Phase::name);
+    return it != _phases.end() ? it->seconds : 0.0;
+}
+
+void StartupReport::print() const {
+    std::lock_guard lock(_mutex);
+    std::println("Startup phases:");
+    for (const Phase& phase : _phases) {
+        if (phase.count > 1) {
+            std::println(
+                "  {:<24}{:9.3f}s in {} parts", phase.name, phase.seconds, phase.count);
+        } else {
+            std::println("  {:<24}{:9.3f}s", phase.name, phase.seconds);
+        }
+    }
+    std::println("Memory:");
+    for (const Memory& memory : _memory)
+        std::println("  {:<24}{:9.1f} MiB", memory.subsystem, memory.bytes / BytesPerMiB);
+    if (const std::optional<ProcessMemory> process = processMemory()) {
+        std::println(
+            "  {:<24}{:9.1f} MiB, peak {:.1f} MiB", "process resident",
+            process->residentBytes / BytesPerMiB,
+            process->peakResidentBytes / BytesPerMiB);
+    }
+}
+
+bool StartupReport::writeJson(const std::filesystem::path& fileName) const {
+    std::lock_guard lock(_mutex);
+    std::ofstream file(fileName);
+    if (!file) {
+        std::println(stderr, "Failed to write startup report: {}", fileName.string());
+        return false;
+    }
+
+    file << "{\n  \"phases\": [";
+    for (std::size_t i = 0; i < _phases.size(); ++i) {
+        file << std::format(
+            "{}\n    {{\"name\": {}, \"seconds\": {:.6f}, \"count\": {}}}",
+            i > 0 ? "," : "", jsonString(_phases[i].name),
+            _phases[i].seconds, _phases[i].count);
+    }
+    file << "\n  ],\n  \"memoryBytes\": {";
+    for (std::size_t i = 0; i < _memory.size(); ++i) {
+        file << std::format(
+            "{}\n    {}: {}", i > 0 ? "," : "",
+            jsonString(_memory[i].subsystem), _memory[i].bytes);
+    }
+    file << "\n  }";
+    if (const std::optional<ProcessMemory> process = processMemory()) {
+        file << std::format(
+            ",\n  \"process\": {{\"residentBytes\": {}, \"peakResidentBytes\": {}}}",
+            process->residentBytes, process->peakResidentBytes);
+    }
+    file << "\n}\n";
+
+    if (!file) {
+        std::println(stderr, "Failed to write startup report: {}", fileName.string());
+        return false;
+    }
+    return true;
+}
+
+std::optional<StartupReport::ProcessMemory> StartupReport::processMemory() {
+#if defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    std::optional<std::size_t> residentKiB;
+    std::optional<std::size_t> peakResidentKiB;
+    std::string line;
+    while (std::getline(status, line)) {
+        std::istringstream words(line);
+        std::string key;
+        std::size_t value = 0;
+        if (!(words >> key >> value))
+            continue;
+        if (key == "VmRSS:")
+            residentKiB = value;
+        else if (key == "VmHWM:")
+            peakResidentKiB = value;
+    }
+    if (!residentKiB || !peakResidentKiB)
+        return std::nullopt;
+    return ProcessMemory{
+        .residentBytes = *residentKiB * 1024,
+        .peakResidentBytes = *peakResidentKiB * 1024};
+#else
+    return std::nullopt;
+#endif
+}
+
+void StartupReport::resetPeakResident() {
+#if defined(__linux__)
+    // Writing 5 to clear_refs resets VmHWM to VmRSS.
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+#endif
+}
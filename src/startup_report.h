@@ -0,0 +1,94 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// Where startup time and memory went: the wall time of each loading phase,
+/// the bytes held by each subsystem, and the resident and peak resident size
+/// of the process. All methods are thread-safe.
+class StartupReport {
+public:
+    struct ProcessMemory {
+        std::size_t residentBytes;
+        std::size_t peakResidentBytes;
+    };
+
+    /// Adds `seconds` to the phase called `name`. Phases that run as pool
+    /// tasks, like BVH builds, add up the time of every task, so they can
+    /// exceed the wall time of loading.
+    void addPhase(std::string_view name, double seconds);
+
+    /// Adds `bytes` to the memory held by `subsystem`.
+    void addMemory(std::string_view subsystem, std::size_t bytes);
+
+    /// Total time recorded for the phase called `name`, or zero.
+    [[nodiscard]] double phaseSeconds(std::string_view name) const;
+
+    /// Prints the phases and memory in the order they were first added.
+    void print() const;
+
+    /// Writes the report as JSON. Returns false, after printing the reason,
+    /// if the file cannot be written.
+    bool writeJson(const std::filesystem::path& fileName) const;
+
+    /// Current and peak resident set size. Only available on Linux, where it
+    /// is read from /proc/self/status.
+    static std::optional<ProcessMemory> processMemory();
+
+    /// Restarts tracking the peak resident size from the current one, so
+    /// the peaks of consecutive runs can be told apart. Linux only.
+    static void resetPeakResident();
+
+private:
+    struct Phase {
+        std::string name;
+        double seconds = 0.0;
+        std::size_t count = 0;
+    };
+
+    struct Memory {
+        std::string subsystem;
+        std::size_t bytes = 0;
+    };
+
+    mutable std::mutex _mutex;
+    std::vector<Phase> _phases;
+    std::vector<Memory> _memory;
+};
+
+/// Adds the time between its construction and destruction to a phase of
+/// `report`. Does nothing if `report` is null.
+class PhaseTimer {
+public:
+    PhaseTimer(StartupReport* report, std::string_view name)
+        : _report(report), _name(name), _start(std::chrono::steady_clock::now()) {}
+    ~PhaseTimer() { stop(); }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    /// Ends the phase early.
+    void stop() {
+        if (!_report)
+            return;
+        const std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - _start;
+        _report->addPhase(_name, elapsed.count());
+        _report = nullptr;
+    }
+
+private:
+    StartupReport* _report;
+    std::string_view _name;
+    std::chrono::steady_clock::time_point _start;
+};
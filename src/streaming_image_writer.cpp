@@ -0,0 +1,213 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#include "streaming_image_writer.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <print>
+#include <vector>
+
+#include "tracy/Tracy.hpp"
+
+namespace {
+
+constexpr int NumChannels = 3;
+/// Largest payload of a stored deflate block.
+constexpr std::size_t MaxStoredBlockSize = 65535;
+
+std::uint32_t crc32(const std::uint8_t* data, std::size_t size, std::uint32_t crc = 0) {
+    static const std::array<std::uint32_t, 256> table = [] {
+        std::array<std::uint32_t, 256> result;
+        for (std::uint32_t i = 0; i < 256; ++i) {
+            std::uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit)
+                value = (value & 1) ? 0xedb88320u ^ (value >> 1) : value >> 1;
+            result[i] = value;
+        }
+        return result;
+    }();
+    crc = ~crc;
+    for (std::size_t i = 0; i < size; ++i)
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+std::uint32_t adler32(const std::uint8_t* data, std::size_t size, std::uint32_t adler) {
+    constexpr std::uint32_t Modulus = 65521;
+    // The sums cannot overflow within this many bytes.
+    constexpr std::size_t MaxRun = 5552;
+    std::uint32_t a = adler & 0xffff;
+    std::uint32_t b = adler >> 16;
+    while (size > 0) {
+        const std::size_t run = std::min(size, MaxRun);
+        for (std::size_t i = 0; i < run; ++i) {
+            a += data[i];
+            b += a;
+        }
+        a %= Modulus;
+        b %= Modulus;
+        data += run;
+        size -= run;
+    }
+    return (b << 16) | a;
+}
+
+void appendBigEndian(std::vector<std::uint8_t>& bytes, std::uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8)
+        bytes.push_back(static_cast<std::uint8_t>(value >> shift));
+}
+
+} // namespace
+
+StreamingImageWriter::~StreamingImageWriter() {
+    if (_file.is_open())
+        close();
+}
+
+bool StreamingImageWriter::open(
+        const std::filesystem::path& fileName, std::size_t width, std::size_t height) {
+    const std::filesystem::path extension = fileName.extension();
+    if (extension == ".png") {
+        _format = Format::Png;
+    } else if (extension == ".pfm") {
+        _format = Format::Pfm;
+    } else {
+        std::println(stderr, "Can only stream .png and .pfm files: {}", fileName.string());
+        return false;
+    }
+    _file.open(fileName, std::ios::binary | std::ios::trunc);
+    if (!_file) {
+        std::println(stderr, "Failed to create {}", fileName.string());
+        return false;
+    }
+    _fileName = fileName;
+    _width = width;
+    _height = height;
+    _numRowsWritten = 0;
+    _adler = 1;
+
+    if (_format == Format::Pfm) {
+        // A negative scale marks little-endian data.
+        const bool isLittleEndian = std::endian::native == std::endian::little;
+        _file << "PF\n" << width << ' ' << height << '\n'
+              << (isLittleEndian ? "-1.0" : "1.0") << '\n';
+        _dataOffset = _file.tellp();
+    } else {
+        constexpr std::array<std::uint8_t, 8> Signature{
+            0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+        _file.write(reinterpret_cast<const char*>(Signature.data()), Signature.size());
+        std::vector<std::uint8_t> header;
+        appendBigEndian(header, static_cast<std::uint32_t>(width));
+        appendBigEndian(header, static_cast<std::uint32_t>(height));
+        header.push_back(8); // Bit depth
+        header.push_back(2); // RGB
+        header.push_back(0); // Deflate
+        header.push_back(0); // Adaptive filtering
+        header.push_back(0); // Not interlaced
+        writePngChunk("IHDR", header.data(), header.size());
+    }
+    return static_cast<bool>(_file);
+}
+
+bool StreamingImageWriter::writeBand(const Image& band) {
+    ZoneScoped;
+    if (!_file.is_open() || band.width() != _width || band.channels() != NumChannels ||
+            _numRowsWritten + band.height() > _height) {
+        std::println(stderr, "Band does not fit in {}", _fileName.string());
+        return false;
+    }
+    if (_format == Format::Png) {
+        if (!writePngBand(band))
+            return false;
+    } else {
+        // The band's rows, bottom up like the file, end where the rows
+        // written so far start.
+        const std::size_t firstRow = _height - _numRowsWritten - band.height();
+        const std::size_t rowSize = _width * NumChannels * sizeof(float);
+        _file.seekp(_dataOffset + static_cast<std::streamoff>(firstRow * rowSize));
+        _file.write(
+            reinterpret_cast<const char*>(band.pixels()),
+            static_cast<std::streamsize>(band.height() * rowSize));
+    }
+    _numRowsWritten += band.height();
+    if (!_file) {
+        std::println(stderr, "Failed to write {}", _fileName.string());
+        return false;
+    }
+    return true;
+}
+
+bool StreamingImageWriter::writePngBand(const Image& band) {
+    // Each row is a filter type byte, none, followed by the pixels.
+    const std::size_t rowSize = 1 + _width * NumChannels;
+    std::vector<std::uint8_t> pixels(band.width() * band.height() * NumChannels);
+    band.convertToBytes(pixels, true);
+    std::vector<std::uint8_t> rows(band.height() * rowSize);
+    for (std::size_t y = 0; y < band.height(); ++y) {
+        rows[y * rowSize] = 0;
+        std::copy_n(
+            pixels.data() + y * _width * NumChannels, _width * NumChannels,
+            rows.data() + y * rowSize + 1);
+    }
+    _adler = adler32(rows.data(), rows.size(), _adler);
+
+    // One IDAT chunk per band, holding the next piece of a single zlib
+    // stream.
+    std::vector<std::uint8_t> data;
+    data.reserve(rows.size() + rows.size() / MaxStoredBlockSize * 5 + 16);
+    if (_numRowsWritten == 0) {
+        data.push_back(0x78); // Deflate with a 32 KiB window
+        data.push_back(0x01); // No preset dictionary, fastest compression
+    }
+    const bool isLastBand = _numRowsWritten + band.height() == _height;
+    for (std::size_t offset = 0; offset < rows.size(); offset += MaxStoredBlockSize) {
+        const std::size_t size = std::min(MaxStoredBlockSize, rows.size() - offset);
+        const bool isFinal = isLastBand && offset + size == rows.size();
+        data.push_back(isFinal ? 1 : 0); // Stored block, byte aligned
+        data.push_back(static_cast<std::uint8_t>(size));
+        data.push_back(static_cast<std::uint8_t>(size >> 8));
+        data.push_back(static_cast<std::uint8_t>(~size));
+        data.push_back(static_cast<std::uint8_t>(~size >> 8));
+        data.insert(data.end(), rows.begin() + offset, rows.begin() + offset + size);
+    }
+    if (isLastBand)
+        appendBigEndian(data, _adler);
+    writePngChunk("IDAT", data.data(), data.size());
+    return true;
+}
+
+void StreamingImageWriter::writePngChunk(
+        const char* type, const std::uint8_t* data, std::size_t size) {
+    std::vector<std::uint8_t> header;
+    appendBigEndian(header, static_cast<std::uint32_t>(size));
+    header.insert(header.end(), type, type + 4);
+    _file.write(reinterpret_cast<const char*>(header.data()), header.size());
+    _file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+    std::vector<std::uint8_t> crc;
+    appendBigEndian(crc, crc32(data, size, crc32(header.data() + 4, 4)));
+    _file.write(reinterpret_cast<const char*>(crc.data()), crc.size());
+}
+
+bool StreamingImageWriter::close() {
+    if (!_file.is_open())
+        return false;
+    const bool isComplete = _numRowsWritten == _height;
+    if (isComplete && _format == Format::Png)
+        writePngChunk("IEND", nullptr, 0);
+    _file.close();
+    if (!isComplete) {
+        std::println(
+            stderr, "Only {} of {} rows were written to {}",
+            _numRowsWritten, _height, _fileName.string());
+        return false;
+    }
+    if (!_file) {
+        std::println(stderr, "Failed to write {}", _fileName.string());
+        return false;
+    }
+    std::println("Saved \"{}\".", _fileName.string());
+    return true;
+}
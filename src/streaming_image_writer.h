@@ -0,0 +1,60 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+
+#include "image.h"
+
+/// Writes an image a band of rows at a time, from the top down, so only one
+/// band has to be in memory however large the image is.
+///
+/// PNG files are written with stored deflate blocks, since compressing
+/// would need a deflate encoder that can be fed in pieces; they are about
+/// as large as the raw 8-bit pixels. PFM files keep their rows bottom up,
+/// so bands are written straight to their place in the file.
+class StreamingImageWriter {
+public:
+    StreamingImageWriter() = default;
+    ~StreamingImageWriter();
+
+    StreamingImageWriter(const StreamingImageWriter&) = delete;
+    StreamingImageWriter& operator=(const StreamingImageWriter&) = delete;
+
+    /// Starts a `.png` or `.pfm` file of the given size. Returns false if
+    /// the extension is neither or the file cannot be created.
+    bool open(const std::filesystem::path& fileName, std::size_t width, std::size_t height);
+
+    /// Appends the rows of `band`, an RGB image as wide as the file, below
+    /// those written before. PNG files take display values, as written by
+    /// `IRenderer::updateFrameBuffer`, and PFM files linear radiance.
+    bool writeBand(const Image& band);
+
+    /// Finishes the file, which must have received every row.
+    bool close();
+
+    [[nodiscard]] bool isOpen() const { return _file.is_open(); }
+
+private:
+    enum class Format { Png, Pfm };
+
+    bool writePngBand(const Image& band);
+    void writePngChunk(const char* type, const std::uint8_t* data, std::size_t size);
+
+    std::ofstream _file;
+    std::filesystem::path _fileName;
+    Format _format = Format::Png;
+    std::size_t _width = 0;
+    std::size_t _height = 0;
+    /// Rows written so far, counted from the top.
+    std::size_t _numRowsWritten = 0;
+    /// Where the pixels of a PFM file start.
+    std::streamoff _dataOffset = 0;
+    /// Adler-32 checksum of the uncompressed PNG data so far.
+    std::uint32_t _adler = 1;
+};
@@ -0,0 +1,343 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#include "texture.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <print>
+#include <type_traits>
+
+#include "tracy/Tracy.hpp"
+
+#include "stb_image.h"
+
+namespace {
+
+float srgbToLinear(float value) {
+    return value <= 0.04045f
+        ? value / 12.92f
+        : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+std::uint8_t linearToSrgb(float value) {
+    value = std::clamp(value, 0.0f, 1.0f);
+    const float encoded = value <= 0.0031308f
+        ? value * 12.92f
+        : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    return static_cast<std::uint8_t>(encoded * 255.0f + 0.5f);
+}
+
+const std::array<float, 256>& srgbLookupTable() {
+    static const std::array<float, 256> table = [] {
+        std::array<float, 256> result;
+        for (int i = 0; i < 256; ++i)
+            result[i] = srgbToLinear(i / 255.0f);
+        return result;
+    }();
+    return table;
+}
+
+/// Spreads the three low bits of a coordinate to every other bit.
+constexpr std::array<std::uint8_t, TextureImage::TileSize> MortonSpread = {
+    0b000000, 0b000001, 0b000100, 0b000101,
+    0b010000, 0b010001, 0b010100, 0b010101};
+
+std::size_t mortonIndex(std::size_t x, std::size_t y) {
+    return MortonSpread[x] | (MortonSpread[y] << 1);
+}
+
+/// Direct-mapped cache of decoded tiles, one per thread.
+struct TileCache {
+    static constexpr std::size_t NumEntries = 64;
+
+    struct Entry {
+        /// Zero marks an empty entry; texture ids start at one.
+        std::uint64_t textureId = 0;
+        int level = 0;
+        std::size_t tileIdx = 0;
+        std::array<Vec3, TextureImage::TexelsPerTile> texels;
+    };
+
+    std::array<Entry, NumEntries> entries;
+
+    static TileCache& get() {
+        thread_local std::unique_ptr<TileCache> cache =
+            std::make_unique<TileCache>();
+        return *cache;
+    }
+};
+
+std::ptrdiff_t wrap(std::ptrdiff_t x, std::size_t size) {
+    const std::ptrdiff_t result = x % static_cast<std::ptrdiff_t>(size);
+    return result < 0 ? result + static_cast<std::ptrdiff_t>(size) : result;
+}
+
+} // namespace
+
+bool TextureImage::load(const std::filesystem::path& fileName) {
+    ZoneScoped;
+    ZoneTextF("fileName=%s", fileName.string().c_str());
+    const std::string name = fileName.string();
+    int width, height, numChannels;
+    if (stbi_is_hdr(name.c_str())) {
+        float* buffer = stbi_loadf(name.c_str(), &width, &height, &numChannels, 0);
+        if (!buffer) {
+            std::println(stderr, "Unable to load {}", name);
+            return false;
+        }
+        _format = Format::Float32;
+        setLevel0(buffer, width, height, numChannels);
+        stbi_image_free(buffer);
+    } else {
+        stbi_uc* buffer = stbi_load(name.c_str(), &width, &height, &numChannels, 0);
+        if (!buffer) {
+            std::println(stderr, "Unable to load {}", name);
+            return false;
+        }
+        _format = Format::SRGB8;
+        setLevel0(buffer, width, height, numChannels);
+        stbi_image_free(buffer);
+    }
+    std::println("Loaded {}", name);
+    return true;
+}
+
+bool TextureImage::load(const std::span<const std::byte> bytes) {
+    ZoneScoped;
+    ZoneTextF("bytes.size()=%zu", bytes.size());
+    const auto* data = reinterpret_cast<const stbi_uc*>(bytes.data());
+    const int size = static_cast<int>(bytes.size());
+    int width, height, numChannels;
+    if (stbi_is_hdr_from_memory(data, size)) {
+        float* buffer = stbi_loadf_from_memory(
+            data, size, &width, &height, &numChannels, 0);
+        if (!buffer) {
+            std::println(stderr, "Unable to load from memory");
+            return false;
+        }
+        _format = Format::Float32;
+        setLevel0(buffer, width, height, numChannels);
+        stbi_image_free(buffer);
+    } else {
+        stbi_uc* buffer = stbi_load_from_memory(
+            data, size, &width, &height, &numChannels, 0);
+        if (!buffer) {
+            std::println(stderr, "Unable to load from memory");
+            return false;
+        }
+        _format = Format::SRGB8;
+        setLevel0(buffer, width, height, numChannels);
+        stbi_image_free(buffer);
+    }
+    std::println("Loaded from memory");
+    return true;
+}
+
+void TextureImage::defer(Source source) {
+    _deferred = std::make_unique<Deferred>();
+    _deferred->source = std::move(source);
+}
+
+void TextureImage::decodeDeferred() const {
+    if (!_deferred || _deferred->isDecoded.load(std::memory_order_acquire))
+        return;
+    std::call_once(_deferred->decodeFlag, [this] {
+        ZoneScoped;
+        // The texels are only ever written here, before any reader can
+        // observe them through `isDecoded`.
+        auto& self = const_cast<TextureImage&>(*this);
+        std::visit([&self](const auto& source) {
+            self.load(source);
+        }, _deferred->source);
+        self.buildMipMaps();
+        _deferred->source = {};
+        _deferred->isDecoded.store(true, std::memory_order_release);
+    });
+}
+
+TextureImage::Level TextureImage::makeLevel(
+        std::size_t width, std::size_t height, std::size_t offset) {
+    const std::size_t tilesPerRow = (width + TileSize - 1) / TileSize;
+    const std::size_t tilesPerColumn = (height + TileSize - 1) / TileSize;
+    return Level{width, height, offset, tilesPerRow, tilesPerRow * tilesPerColumn};
+}
+
+std::size_t TextureImage::texelIndex(
+        const Level& level, std::size_t x, std::size_t y) {
+    const std::size_t tileIdx = x / TileSize + (y / TileSize) * level.tilesPerRow;
+    return level.offset + tileIdx * TexelsPerTile +
+        mortonIndex(x % TileSize, y % TileSize);
+}
+
+template<typename T>
+void TextureImage::setLevel0(
+        const T* rows, std::size_t width, std::size_t height, int channels) {
+    _id = NextId++;
+    _channels = channels;
+    _levels = {makeLevel(width, height, 0)};
+    std::vector<T>& storage = [&]() -> std::vector<T>& {
+        if constexpr (std::is_same_v<T, float>)
+            return _floats;
+        else
+            return _bytes;
+    }();
+    _floats.clear();
+    _bytes.clear();
+    storage.resize(_levels[0].numTiles * TexelsPerTile * channels);
+
+    // Swizzle the decoded rows into tiles.
+    for (std::size_t y = 0; y < height; ++y) {
+        for (std::size_t x = 0; x < width; ++x) {
+            const std::size_t idx = texelIndex(_levels[0], x, y);
+            for (int c = 0; c < channels; ++c)
+                storage[idx * channels + c] = rows[(x + y * width) * channels + c];
+        }
+    }
+}
+
+void TextureImage::buildMipMaps() {
+    ZoneScoped;
+    if (empty())
+        return;
+    _levels.resize(1);
+
+    // Lay out every level after the previous one.
+    std::size_t numTexels = _levels[0].numTiles * TexelsPerTile;
+    while (_levels.back().width > 1 || _levels.back().height > 1) {
+        const Level& previous = _levels.back();
+        const Level level = makeLevel(
+            std::max<std::size_t>(1, previous.width / 2),
+            std::max<std::size_t>(1, previous.height / 2),
+            numTexels);
+        numTexels += level.numTiles * TexelsPerTile;
+        _levels.push_back(level);
+    }
+    if (_format == Format::SRGB8)
+        _bytes.resize(numTexels * _channels);
+    else
+        _floats.resize(numTexels * _channels);
+
+    for (std::size_t i = 1; i < _levels.size(); ++i) {
+        const Level& source = _levels[i - 1];
+        const Level& target = _levels[i];
+        for (std::size_t y = 0; y < target.height; ++y) {
+            for (std::size_t x = 0; x < target.width; ++x) {
+                // Average the 2x2 footprint, clamped for odd sizes.
+                Vec4 sum(0.0f);
+                for (std::size_t dy = 0; dy < 2; ++dy) {
+                    for (std::size_t dx = 0; dx < 2; ++dx) {
+                        const std::size_t sourceX = std::min(2 * x + dx, source.width - 1);
+                        const std::size_t sourceY = std::min(2 * y + dy, source.height - 1);
+                        sum += loadTexel(texelIndex(source, sourceX, sourceY));
+                    }
+                }
+                storeTexel(texelIndex(target, x, y), sum * 0.25f);
+            }
+        }
+    }
+    // Any tiles cached from before are stale.
+    _id = NextId++;
+}
+
+std::size_t TextureImage::memoryUsage() const {
+    return _bytes.size() * sizeof(std::uint8_t) + _floats.size() * sizeof(float);
+}
+
+Vec4 TextureImage::loadTexel(std::size_t idx) const {
+    Vec4 result(0.0f, 0.0f, 0.0f, 1.0f);
+    const std::size_t first = idx * _channels;
+    if (_format == Format::SRGB8) {
+        // Alpha is stored linearly.
+        const std::array<float, 256>& table = srgbLookupTable();
+        for (int c = 0; c < _channels; ++c)
+            result[c] = c == 3 ? _bytes[first + c] / 255.0f : table[_bytes[first + c]];
+    } else {
+        for (int c = 0; c < _channels; ++c)
+            result[c] = _floats[first + c];
+    }
+    return result;
+}
+
+void TextureImage::storeTexel(std::size_t idx, const Vec4 value) {
+    const std::size_t first = idx * _channels;
+    if (_format == Format::SRGB8) {
+        for (int c = 0; c < _channels; ++c) {
+            _bytes[first + c] = c == 3
+                ? static_cast<std::uint8_t>(std::clamp(value[c], 0.0f, 1.0f) * 255.0f + 0.5f)
+                : linearToSrgb(value[c]);
+        }
+    } else {
+        for (int c = 0; c < _channels; ++c)
+            _floats[first + c] = value[c];
+    }
+}
+
+void TextureImage::decodeTile(
+        int level, std::size_t tileIdx,
+        std::span<Vec3, TexelsPerTile> texels) const {
+    const std::size_t first = _levels[level].offset + tileIdx * TexelsPerTile;
+    for (std::size_t i = 0; i < TexelsPerTile; ++i) {
+        const Vec4 value = loadTexel(first + i);
+        // Grayscale images, with or without alpha.
+        texels[i] = _channels < 3 ? Vec3(value.x) : Vec3(value);
+    }
+}
+
+Vec3 TextureImage::texel(int level, std::ptrdiff_t x, std::ptrdiff_t y) const {
+    const Level& info = _levels[level];
+    const std::size_t wrappedX = wrap(x, info.width);
+    const std::size_t wrappedY = wrap(y, info.height);
+    const std::size_t tileIdx =
+        wrappedX / TileSize + (wrappedY / TileSize) * info.tilesPerRow;
+
+    TileCache& cache = TileCache::get();
+    const std::size_t slot =
+        (_id * 0x9e3779b97f4a7c15u + level * 0x85ebca6bu + tileIdx) %
+        TileCache::NumEntries;
+    TileCache::Entry& entry = cache.entries[slot];
+    if (entry.textureId != _id || entry.level != level || entry.tileIdx != tileIdx) {
+        decodeTile(level, tileIdx, entry.texels);
+        entry.textureId = _id;
+        entry.level = level;
+        entry.tileIdx = tileIdx;
+    }
+    return entry.texels[mortonIndex(wrappedX % TileSize, wrappedY % TileSize)];
+}
+
+Vec3 TextureImage::sampleBilinear(int level, const Vec2 textureCoord) const {
+    const Level& info = _levels[level];
+    const float x = textureCoord.x * info.width - 0.5f;
+    const float y = textureCoord.y * info.height - 0.5f;
+    const float floorX = std::floor(x);
+    const float floorY = std::floor(y);
+    const float fracX = x - floorX;
+    const float fracY = y - floorY;
+    const auto x0 = static_cast<std::ptrdiff_t>(floorX);
+    const auto y0 = static_cast<std::ptrdiff_t>(floorY);
+    return
+        (texel(level, x0, y0) * (1.0f - fracX) + texel(level, x0 + 1, y0) * fracX) * (1.0f - fracY) +
+        (texel(level, x0, y0 + 1) * (1.0f - fracX) + texel(level, x0 + 1, y0 + 1) * fracX) * fracY;
+}
+
+Vec3 TextureImage::sample(const Vec2 textureCoord, const float footprint) const {
+    decodeDeferred();
+    if (empty())
+        return Vec3(1.0f);
+    // Pick the level where one texel covers the footprint.
+    const float footprintInTexels =
+        footprint * static_cast<float>(std::max(width(), height()));
+    const float lod = std::clamp(
+        std::log2(std::max(footprintInTexels, 1.0f)),
+        0.0f, static_cast<float>(numLevels() - 1));
+    const int level = static_cast<int>(lod);
+    const float blend = lod - level;
+    if (blend == 0.0f || level + 1 >= numLevels())
+        return sampleBilinear(level, textureCoord);
+    return sampleBilinear(level, textureCoord) * (1.0f - blend) +
+        sampleBilinear(level + 1, textureCoord) * blend;
+}
@@ -0,0 +1,121 @@
+// Copyright (c) Maxwell Hunt and Alexander Kaminsky 2025. All rights reserved.
+// Licensed under the MIT License. See LICENSE in the project root for license
+// information.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <variant>
+#include <vector>
+
+#include "types.h"
+
+/// Mip-mapped image used for texturing. Low dynamic range images are stored
+/// as 8-bit sRGB and decoded through a lookup table when sampled, while high
+/// dynamic range images keep 32-bit floats.
+///
+/// Each level is stored as 8x8 tiles with the texels of a tile in Morton
+/// order, so texels that are close in the image are close in memory. Lookups
+/// go through a small per-thread cache of decoded tiles.
+///
+/// An image can also be deferred, in which case the encoded file is kept and
+/// only decoded, along with its mip chain, the first time it is sampled.
+class TextureImage {
+public:
+    enum class Format {
+        SRGB8,
+        Float32
+    };
+
+    static constexpr std::size_t TileSize = 8;
+    static constexpr std::size_t TexelsPerTile = TileSize * TileSize;
+
+    struct Level {
+        std::size_t width;
+        std::size_t height;
+        /// Index of the level's first texel in the storage.
+        std::size_t offset;
+        /// Number of tiles in each row, including partially covered tiles.
+        std::size_t tilesPerRow;
+        std::size_t numTiles;
+    };
+
+    /// Encoded image, either a file or a copy of its contents.
+    using Source = std::variant<std::filesystem::path, std::vector<std::byte>>;
+
+    TextureImage() = default;
+
+    bool load(const std::filesystem::path& fileName);
+    bool load(std::span<const std::byte> bytes);
+
+    /// Keeps `source` to be decoded on first use. Decoding is done at most
+    /// once and published to every thread that samples the image.
+    void defer(Source source);
+
+    /// Decodes a deferred image now. Does nothing otherwise.
+    void decodeDeferred() const;
+    [[nodiscard]] bool isDeferred() const { return _deferred != nullptr; }
+
+    /// Builds the full mip chain down to 1x1 by box filtering in linear space.
+    void buildMipMaps();
+
+    [[nodiscard]] bool empty() const { return _levels.empty(); }
+    [[nodiscard]] Format format() const { return _format; }
+    [[nodiscard]] int channels() const { return _channels; }
+    [[nodiscard]] std::size_t width() const { return empty() ? 0 : _levels[0].width; }
+    [[nodiscard]] std::size_t height() const { return empty() ? 0 : _levels[0].height; }
+    [[nodiscard]] int numLevels() const { return static_cast<int>(_levels.size()); }
+
+    /// Number of bytes used to store all mip levels.
+    [[nodiscard]] std::size_t memoryUsage() const;
+
+    /// Linear RGB value of a texel, with repeating coordinates. Deferred
+    /// images must already be decoded.
+    [[nodiscard]] Vec3 texel(int level, std::ptrdiff_t x, std::ptrdiff_t y) const;
+
+    /// Decodes all texels of a tile to linear RGB, in Morton order.
+    void decodeTile(
+        int level, std::size_t tileIdx,
+        std::span<Vec3, TexelsPerTile> texels) const;
+
+    /// Filtered lookup with repeating coordinates. The mip level is chosen so
+    /// a texel roughly matches `footprint`, the width of the area being
+    /// shaded in texture coordinates, and blended trilinearly.
+    [[nodiscard]] Vec3 sample(Vec2 textureCoord, float footprint) const;
+
+private:
+    friend class SceneCache;
+
+    static Level makeLevel(std::size_t width, std::size_t height, std::size_t offset);
+    static std::size_t texelIndex(const Level& level, std::size_t x, std::size_t y);
+    template<typename T>
+    void setLevel0(
+        const T* rows, std::size_t width, std::size_t height, int channels);
+    Vec3 sampleBilinear(int level, Vec2 textureCoord) const;
+    Vec4 loadTexel(std::size_t idx) const;
+    void storeTexel(std::size_t idx, Vec4 value);
+
+    struct Deferred {
+        Source source;
+        std::once_flag decodeFlag;
+        std::atomic<bool> isDecoded = false;
+    };
+    std::unique_ptr<Deferred> _deferred;
+
+    /// Identifies the contents of the texture in the tile cache. Changes
+    /// whenever the texels do.
+    std::uint64_t _id = 0;
+    static inline std::atomic<std::uint64_t> NextId = 1;
+
+    Format _format = Format::SRGB8;
+    int _channels = 0;
+    std::vector<Level> _levels;
+    std::vector<std::uint8_t> _bytes;
+    std::vector<float> _floats;
+};